@@ -0,0 +1,699 @@
+#include "analyzer.h"
+
+#include <iterator>
+#include <unordered_map>
+
+#include "scheduler.h"
+
+class ConstantExecutor : public Executor {
+public:
+    explicit ConstantExecutor(std::shared_ptr<Object> value) : value_(std::move(value)){};
+
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>&) override {
+        return value_;
+    }
+
+protected:
+    std::shared_ptr<Object> value_;
+};
+
+/// () и прочее, что нельзя вычислить; ошибка откладывается до исполнения, как и раньше
+class InvalidFormExecutor : public Executor {
+public:
+    explicit InvalidFormExecutor(std::string message) : message_(std::move(message)){};
+
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>&) override {
+        throw RuntimeError(message_);
+    }
+
+protected:
+    std::string message_;
+};
+
+class GlobalVariableExecutor : public Executor {
+public:
+    explicit GlobalVariableExecutor(Binding* binding) : binding_(binding){};
+
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>&) override {
+        const auto* value = ReadGlobal(binding_);
+        if (value == nullptr) {
+            throw NameError("wrong variable name");
+        }
+        return *value;
+    }
+
+protected:
+    Binding* binding_;
+};
+
+class LocalVariableExecutor : public Executor {
+public:
+    LocalVariableExecutor(uint16_t depth, uint32_t slot) : depth_(depth), slot_(slot){};
+
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>& frame) override {
+        const Binding& binding = frame->Lookup(depth_, slot_);
+        if (!binding.is_defined) {
+            throw NameError("wrong variable name");
+        }
+        return binding.value;
+    }
+
+protected:
+    uint16_t depth_;
+    uint32_t slot_;
+};
+
+/// Стек аргументов для вызовов builtin-ов с нефиксированным числом аргументов: Apply
+/// получает Arguments прямо на его верхушку. Вложенные вызовы кладут свои аргументы выше и
+/// могут перевыделить буфер: builtin, который сам исполняет код (par-map, touch), должен
+/// скопировать из Arguments всё нужное до первого такого вызова.
+class ArgumentStack {
+public:
+    ArgumentStack() : base_(stack.size()) {
+    }
+    ArgumentStack(const ArgumentStack&) = delete;
+    ArgumentStack& operator=(const ArgumentStack&) = delete;
+    ~ArgumentStack() {
+        stack.resize(base_);
+    }
+
+    void Push(std::shared_ptr<Object> value) {
+        stack.push_back(std::move(value));
+    }
+    Arguments Get() const {
+        return Arguments(stack).subspan(base_);
+    }
+
+protected:
+    static thread_local std::vector<std::shared_ptr<Object>> stack;
+    size_t base_;
+};
+
+thread_local std::vector<std::shared_ptr<Object>> ArgumentStack::stack;
+
+class CallExecutor : public TailExecutor {
+public:
+    CallExecutor(ExecutorPtr function, std::vector<ExecutorPtr> arguments)
+        : function_(std::move(function)), arguments_(std::move(arguments)){};
+
+    std::shared_ptr<Object> ExecuteTail(const std::shared_ptr<Frame>& frame,
+                                        TailCall* tail_call) override {
+        auto value = function_->Execute(frame);
+        auto function = As<Function>(value);
+        if (function == nullptr) {
+            throw RuntimeError("not a function in eval");
+        }
+        if (Is<Closure>(value)) {
+            // аргументы вычисляются сразу в слоты кадра вызываемого
+            auto closure = std::static_pointer_cast<Closure>(std::move(value));
+            auto callee_frame = closure->MakeFrame(arguments_.size());
+            for (size_t i = 0; i < arguments_.size(); ++i) {
+                callee_frame->slots[i] = Binding{arguments_[i]->Execute(frame), true};
+            }
+            tail_call->closure = std::move(closure);
+            tail_call->frame = std::move(callee_frame);
+            return nullptr;
+        }
+        switch (arguments_.size()) {
+            case 1:
+                return function->Apply1(arguments_[0]->Execute(frame));
+            case 2: {
+                auto first = arguments_[0]->Execute(frame);
+                return function->Apply2(first, arguments_[1]->Execute(frame));
+            }
+            default: {
+                ArgumentStack arg_stack;
+                for (const auto& argument : arguments_) {
+                    arg_stack.Push(argument->Execute(frame));
+                }
+                return function->Apply(arg_stack.Get());
+            }
+        }
+    }
+
+protected:
+    ExecutorPtr function_;
+    std::vector<ExecutorPtr> arguments_;
+};
+
+class IfExecutor : public TailExecutor {
+public:
+    IfExecutor(ExecutorPtr condition, ExecutorPtr then_branch, ExecutorPtr else_branch)
+        : condition_(std::move(condition)),
+          then_branch_(std::move(then_branch)),
+          else_branch_(std::move(else_branch)){};
+
+    std::shared_ptr<Object> ExecuteTail(const std::shared_ptr<Frame>& frame,
+                                        TailCall* tail_call) override {
+        if (GetBoolValueFromAnyType(condition_->Execute(frame))) {
+            return then_branch_->ExecuteTail(frame, tail_call);
+        }
+        if (else_branch_ == nullptr) {
+            return nullptr;
+        }
+        return else_branch_->ExecuteTail(frame, tail_call);
+    }
+
+protected:
+    ExecutorPtr condition_;
+    ExecutorPtr then_branch_;
+    ExecutorPtr else_branch_;
+};
+
+class DefineGlobalExecutor : public Executor {
+public:
+    DefineGlobalExecutor(Scope* scope, Binding* binding, ExecutorPtr value)
+        : scope_(scope), binding_(binding), value_(std::move(value)){};
+
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>& frame) override {
+        auto value = value_->Execute(frame);
+        // глобальное окружение параллельные задачи только читают
+        if (WorkStealingPool::IsInsideTask()) {
+            throw RuntimeError("cannot change a global variable inside a parallel task");
+        }
+        binding_->value = std::move(value);
+        binding_->is_defined = true;
+        scope_->MarkChanged(*binding_);
+        return result_;
+    }
+
+protected:
+    Scope* scope_;
+    Binding* binding_;
+    ExecutorPtr value_;
+    std::shared_ptr<Object> result_ = Symbol::Intern("defined!");
+};
+
+class DefineLocalExecutor : public Executor {
+public:
+    DefineLocalExecutor(uint32_t slot, ExecutorPtr value) : slot_(slot), value_(std::move(value)){};
+
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>& frame) override {
+        auto value = value_->Execute(frame);
+        frame->slots[slot_] = Binding{std::move(value), true};
+        return result_;
+    }
+
+protected:
+    uint32_t slot_;
+    ExecutorPtr value_;
+    std::shared_ptr<Object> result_ = Symbol::Intern("defined!");
+};
+
+class SetGlobalExecutor : public Executor {
+public:
+    SetGlobalExecutor(Scope* scope, Binding* binding, ExecutorPtr value)
+        : scope_(scope), binding_(binding), value_(std::move(value)){};
+
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>& frame) override {
+        auto value = value_->Execute(frame);
+        // задача не трогает binding-и даже для проверки: есть ли имя, знает её снимок
+        if (WorkStealingPool::IsInsideTask()) {
+            if (ReadGlobal(binding_) == nullptr) {
+                throw NameError("invalid symbol to set");
+            }
+            throw RuntimeError("cannot change a global variable inside a parallel task");
+        }
+        if (!binding_->is_defined) {
+            throw NameError("invalid symbol to set");
+        }
+        binding_->value = std::move(value);
+        scope_->MarkChanged(*binding_);
+        return result_;
+    }
+
+protected:
+    Scope* scope_;
+    Binding* binding_;
+    ExecutorPtr value_;
+    std::shared_ptr<Object> result_ = Symbol::Intern("set!");
+};
+
+class SetLocalExecutor : public Executor {
+public:
+    SetLocalExecutor(uint16_t depth, uint32_t slot, ExecutorPtr value)
+        : depth_(depth), slot_(slot), value_(std::move(value)){};
+
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>& frame) override {
+        auto value = value_->Execute(frame);
+        Frame* target = frame->GetAncestor(depth_);
+        CheckFrameWritable(*target);
+        Binding& binding = target->slots[slot_];
+        if (!binding.is_defined) {
+            throw NameError("cannot find this name in any namespace");
+        }
+        binding.value = std::move(value);
+        return result_;
+    }
+
+protected:
+    uint16_t depth_;
+    uint32_t slot_;
+    ExecutorPtr value_;
+    std::shared_ptr<Object> result_ = Symbol::Intern("set!");
+};
+
+class LambdaExecutor : public Executor {
+public:
+    explicit LambdaExecutor(std::shared_ptr<LambdaInfo> lambda) : lambda_(std::move(lambda)){};
+
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>& frame) override {
+        auto closure = std::make_shared<Closure>(lambda_, frame);
+        lambda_->collector->Track(closure);
+        return closure;
+    }
+
+protected:
+    std::shared_ptr<LambdaInfo> lambda_;
+};
+
+class BeginExecutor : public TailExecutor {
+public:
+    explicit BeginExecutor(std::vector<ExecutorPtr> forms) : forms_(std::move(forms)){};
+
+    std::shared_ptr<Object> ExecuteTail(const std::shared_ptr<Frame>& frame,
+                                        TailCall* tail_call) override {
+        for (size_t i = 0; i + 1 < forms_.size(); ++i) {
+            forms_[i]->Execute(frame);
+        }
+        return forms_.back()->ExecuteTail(frame, tail_call);
+    }
+
+protected:
+    std::vector<ExecutorPtr> forms_;
+};
+
+class AndExecutor : public TailExecutor {
+public:
+    explicit AndExecutor(std::vector<ExecutorPtr> forms) : forms_(std::move(forms)){};
+
+    std::shared_ptr<Object> ExecuteTail(const std::shared_ptr<Frame>& frame,
+                                        TailCall* tail_call) override {
+        if (forms_.empty()) {
+            return Bool::Make(true);
+        }
+        for (size_t i = 0; i + 1 < forms_.size(); ++i) {
+            auto result = forms_[i]->Execute(frame);
+            if (!GetBoolValueFromAnyType(result)) {
+                return result;
+            }
+        }
+        return forms_.back()->ExecuteTail(frame, tail_call);
+    }
+
+protected:
+    std::vector<ExecutorPtr> forms_;
+};
+
+class OrExecutor : public TailExecutor {
+public:
+    explicit OrExecutor(std::vector<ExecutorPtr> forms) : forms_(std::move(forms)){};
+
+    std::shared_ptr<Object> ExecuteTail(const std::shared_ptr<Frame>& frame,
+                                        TailCall* tail_call) override {
+        if (forms_.empty()) {
+            return Bool::Make(false);
+        }
+        for (size_t i = 0; i + 1 < forms_.size(); ++i) {
+            auto result = forms_[i]->Execute(frame);
+            if (GetBoolValueFromAnyType(result)) {
+                return result;
+            }
+        }
+        return forms_.back()->ExecuteTail(frame, tail_call);
+    }
+
+protected:
+    std::vector<ExecutorPtr> forms_;
+};
+
+class CondExecutor : public TailExecutor {
+public:
+    struct Clause {
+        /// nullptr у else
+        ExecutorPtr test;
+        /// nullptr, если после условия ничего нет
+        ExecutorPtr body;
+    };
+
+    explicit CondExecutor(std::vector<Clause> clauses) : clauses_(std::move(clauses)){};
+
+    std::shared_ptr<Object> ExecuteTail(const std::shared_ptr<Frame>& frame,
+                                        TailCall* tail_call) override {
+        for (const auto& clause : clauses_) {
+            std::shared_ptr<Object> value;
+            if (clause.test != nullptr) {
+                value = clause.test->Execute(frame);
+                if (!GetBoolValueFromAnyType(value)) {
+                    continue;
+                }
+            }
+            if (clause.body == nullptr) {
+                return value;
+            }
+            return clause.body->ExecuteTail(frame, tail_call);
+        }
+        return nullptr;
+    }
+
+protected:
+    std::vector<Clause> clauses_;
+};
+
+std::shared_ptr<Object> TailExecutor::Execute(const std::shared_ptr<Frame>& frame) {
+    TailCall tail_call;
+    auto result = ExecuteTail(frame, &tail_call);
+    if (tail_call.closure != nullptr) {
+        return tail_call.closure->Run(std::move(tail_call.frame));
+    }
+    return result;
+}
+
+std::shared_ptr<Frame> Closure::MakeFrame(size_t argc) const {
+    if (argc != lambda_->parameter_count) {
+        throw RuntimeError("wrong number of arguments in lambda call");
+    }
+    auto frame = std::make_shared<Frame>(lambda_->frame_size, frame_);
+    lambda_->collector->Track(frame);
+    return frame;
+}
+
+std::shared_ptr<Object> Closure::Apply(Arguments arg_vector) {
+    auto frame = MakeFrame(arg_vector.size());
+    for (size_t i = 0; i < arg_vector.size(); ++i) {
+        frame->slots[i] = Binding{arg_vector[i], true};
+    }
+    return Run(std::move(frame));
+}
+
+std::shared_ptr<Object> Closure::Run(std::shared_ptr<Frame> frame) {
+    TailCall tail_call;
+    auto result = lambda_->body->ExecuteTail(frame, &tail_call);
+    // хвостовые вызовы крутятся в этом цикле, стек C++ не растёт
+    std::shared_ptr<Closure> current;
+    while (tail_call.closure != nullptr) {
+        current = std::move(tail_call.closure);
+        frame = std::move(tail_call.frame);
+        result = current->lambda_->body->ExecuteTail(frame, &tail_call);
+    }
+    return result;
+}
+
+/// (a b . c) не подходит ни одной форме, поэтому сразу SyntaxError
+std::vector<std::shared_ptr<Object>> ListToVector(std::shared_ptr<Object> list) {
+    std::vector<std::shared_ptr<Object>> elements;
+    while (list != nullptr) {
+        auto cell = As<Cell>(list);
+        if (cell == nullptr) {
+            throw SyntaxError("form should be a proper list");
+        }
+        elements.push_back(cell->GetFirst());
+        list = cell->GetSecond();
+    }
+    return elements;
+}
+
+/// имя, которое вводит (define name ...) или (define (name ...) ...), иначе nullptr
+std::shared_ptr<Symbol> GetDefinedSymbol(const std::shared_ptr<Object>& form) {
+    static const auto define = Symbol::Intern("define");
+    auto cell = As<Cell>(form);
+    if (cell == nullptr || cell->GetFirst() != define || !Is<Cell>(cell->GetSecond())) {
+        return nullptr;
+    }
+    auto target = As<Cell>(cell->GetSecond())->GetFirst();
+    if (Is<Cell>(target)) {
+        target = As<Cell>(target)->GetFirst();
+    }
+    return AsShared<Symbol>(target);
+}
+
+std::vector<CondClause> ParseCondClauses(const std::vector<std::shared_ptr<Object>>& args) {
+    static const auto else_symbol = Symbol::Intern("else");
+    std::vector<CondClause> clauses;
+    for (size_t i = 0; i < args.size(); ++i) {
+        auto clause = ListToVector(args[i]);
+        if (clause.empty()) {
+            throw SyntaxError("cond clause should not be empty");
+        }
+        CondClause result;
+        result.is_else = clause[0] == else_symbol;
+        if (result.is_else && (i + 1 != args.size() || clause.size() == 1)) {
+            throw SyntaxError("else should be the last cond clause and have a body");
+        }
+        result.test = std::move(clause[0]);
+        result.body.assign(std::make_move_iterator(clause.begin() + 1),
+                           std::make_move_iterator(clause.end()));
+        clauses.push_back(std::move(result));
+    }
+    return clauses;
+}
+
+std::shared_ptr<Object> ExpandFuture(const std::vector<std::shared_ptr<Object>>& args) {
+    static const auto quote = Symbol::Intern("quote");
+    static const auto lambda = Symbol::Intern("lambda");
+    if (args.size() != 1) {
+        throw SyntaxError("future needs exactly one expression");
+    }
+    auto make_future = Cell::Make(quote, Cell::Make(name_to_function.at("make-future"), nullptr));
+    auto thunk = Cell::Make(lambda, Cell::Make(nullptr, Cell::Make(args[0], nullptr)));
+    return Cell::Make(make_future, Cell::Make(thunk, nullptr));
+}
+
+ExecutorPtr Analyzer::Analyze(const std::shared_ptr<Object>& form) {
+    scopes_.clear();
+    return AnalyzeForm(form);
+}
+
+ExecutorPtr Analyzer::AnalyzeForm(const std::shared_ptr<Object>& form) {
+    if (form == nullptr) {
+        return std::make_shared<InvalidFormExecutor>("cannot evaluate empty list");
+    }
+    if (Is<Symbol>(form)) {
+        return AnalyzeSymbol(As<Symbol>(form)->GetId());
+    }
+    if (Is<Cell>(form)) {
+        return AnalyzeCell(As<Cell>(form));
+    }
+    return std::make_shared<ConstantExecutor>(form);
+}
+
+ExecutorPtr Analyzer::AnalyzeSymbol(uint32_t name) {
+    uint16_t depth;
+    uint32_t slot;
+    if (ResolveLocal(name, &depth, &slot)) {
+        return std::make_shared<LocalVariableExecutor>(depth, slot);
+    }
+    return std::make_shared<GlobalVariableExecutor>(global_scope_->GetBinding(name));
+}
+
+ExecutorPtr Analyzer::AnalyzeCell(const Cell* form) {
+    using SpecialFormAnalyzer = ExecutorPtr (Analyzer::*)(const FormArguments&);
+    static const std::unordered_map<uint32_t, SpecialFormAnalyzer> special_forms = {
+        {Symbol::Intern("quote")->GetId(), &Analyzer::AnalyzeQuote},
+        {Symbol::Intern("if")->GetId(), &Analyzer::AnalyzeIf},
+        {Symbol::Intern("cond")->GetId(), &Analyzer::AnalyzeCond},
+        {Symbol::Intern("define")->GetId(), &Analyzer::AnalyzeDefine},
+        {Symbol::Intern("set!")->GetId(), &Analyzer::AnalyzeSet},
+        {Symbol::Intern("lambda")->GetId(), &Analyzer::AnalyzeLambda},
+        {Symbol::Intern("begin")->GetId(), &Analyzer::AnalyzeBegin},
+        {Symbol::Intern("and")->GetId(), &Analyzer::AnalyzeAnd},
+        {Symbol::Intern("or")->GetId(), &Analyzer::AnalyzeOr},
+        {Symbol::Intern("future")->GetId(), &Analyzer::AnalyzeFuture}};
+
+    auto args = ListToVector(form->GetSecond());
+    if (auto head = As<Symbol>(form->GetFirst()); head != nullptr && !IsLocal(head->GetId())) {
+        auto it = special_forms.find(head->GetId());
+        if (it != special_forms.end()) {
+            return (this->*(it->second))(args);
+        }
+    }
+
+    auto function = AnalyzeForm(form->GetFirst());
+    std::vector<ExecutorPtr> arguments;
+    arguments.reserve(args.size());
+    for (const auto& arg : args) {
+        arguments.push_back(AnalyzeForm(arg));
+    }
+    return std::make_shared<CallExecutor>(std::move(function), std::move(arguments));
+}
+
+ExecutorPtr Analyzer::AnalyzeQuote(const FormArguments& args) {
+    if (args.size() != 1) {
+        throw SyntaxError("quote needs exactly one argument");
+    }
+    return std::make_shared<ConstantExecutor>(args[0]);
+}
+
+ExecutorPtr Analyzer::AnalyzeIf(const FormArguments& args) {
+    if (args.size() != 2 && args.size() != 3) {
+        throw SyntaxError("if needs condition and one or two branches");
+    }
+    ExecutorPtr else_branch = args.size() == 3 ? AnalyzeForm(args[2]) : nullptr;
+    return std::make_shared<IfExecutor>(AnalyzeForm(args[0]), AnalyzeForm(args[1]),
+                                        std::move(else_branch));
+}
+
+ExecutorPtr Analyzer::AnalyzeCond(const FormArguments& args) {
+    std::vector<CondExecutor::Clause> clauses;
+    for (const auto& clause : ParseCondClauses(args)) {
+        ExecutorPtr test = clause.is_else ? nullptr : AnalyzeForm(clause.test);
+        ExecutorPtr body;
+        if (!clause.body.empty()) {
+            body = std::make_shared<BeginExecutor>(AnalyzeSequence(clause.body, 0));
+        }
+        clauses.push_back(CondExecutor::Clause{std::move(test), std::move(body)});
+    }
+    return std::make_shared<CondExecutor>(std::move(clauses));
+}
+
+ExecutorPtr Analyzer::AnalyzeDefine(const FormArguments& args) {
+    if (args.empty()) {
+        throw SyntaxError("argument is nullptr in define");
+    }
+    uint32_t name;
+    uint32_t slot = 0;
+    ExecutorPtr value;
+    if (auto signature = As<Cell>(args[0])) {
+        // (define (name params...) body...)
+        if (!Is<Symbol>(signature->GetFirst()) || args.size() < 2) {
+            throw SyntaxError("define error");
+        }
+        name = As<Symbol>(signature->GetFirst())->GetId();
+        if (!scopes_.empty()) {
+            slot = DeclareLocal(name);
+        }
+        value = std::make_shared<LambdaExecutor>(MakeLambda(signature->GetSecond(), args, 1));
+    } else {
+        if (!Is<Symbol>(args[0]) || args.size() != 2) {
+            throw SyntaxError("define error");
+        }
+        name = As<Symbol>(args[0])->GetId();
+        if (!scopes_.empty()) {
+            slot = DeclareLocal(name);
+        }
+        value = AnalyzeForm(args[1]);
+    }
+    if (scopes_.empty()) {
+        return std::make_shared<DefineGlobalExecutor>(
+            global_scope_, global_scope_->GetBinding(name), std::move(value));
+    }
+    return std::make_shared<DefineLocalExecutor>(slot, std::move(value));
+}
+
+ExecutorPtr Analyzer::AnalyzeSet(const FormArguments& args) {
+    if (args.size() != 2 || !Is<Symbol>(args[0])) {
+        throw SyntaxError("set! needs a name and a value");
+    }
+    uint32_t name = As<Symbol>(args[0])->GetId();
+    auto value = AnalyzeForm(args[1]);
+    uint16_t depth;
+    uint32_t slot;
+    if (ResolveLocal(name, &depth, &slot)) {
+        return std::make_shared<SetLocalExecutor>(depth, slot, std::move(value));
+    }
+    return std::make_shared<SetGlobalExecutor>(global_scope_, global_scope_->GetBinding(name),
+                                               std::move(value));
+}
+
+ExecutorPtr Analyzer::AnalyzeLambda(const FormArguments& args) {
+    if (args.size() < 2) {
+        throw SyntaxError("lambda needs parameters and body");
+    }
+    return std::make_shared<LambdaExecutor>(MakeLambda(args[0], args, 1));
+}
+
+ExecutorPtr Analyzer::AnalyzeBegin(const FormArguments& args) {
+    if (args.empty()) {
+        throw SyntaxError("begin needs at least one form");
+    }
+    return std::make_shared<BeginExecutor>(AnalyzeSequence(args, 0));
+}
+
+ExecutorPtr Analyzer::AnalyzeAnd(const FormArguments& args) {
+    return std::make_shared<AndExecutor>(AnalyzeSequence(args, 0));
+}
+
+ExecutorPtr Analyzer::AnalyzeOr(const FormArguments& args) {
+    return std::make_shared<OrExecutor>(AnalyzeSequence(args, 0));
+}
+
+ExecutorPtr Analyzer::AnalyzeFuture(const FormArguments& args) {
+    return AnalyzeForm(ExpandFuture(args));
+}
+
+void Analyzer::RestoreLambda(LambdaInfo* lambda) {
+    scopes_ = lambda->enclosing_scopes;
+    auto restored = MakeLambda(lambda->parameters, lambda->source, 0);
+    scopes_.clear();
+    *lambda = std::move(*restored);
+}
+
+std::shared_ptr<LambdaInfo> Analyzer::MakeLambda(const std::shared_ptr<Object>& parameters,
+                                                 const FormArguments& body, size_t body_start) {
+    auto lambda = std::make_shared<LambdaInfo>();
+    lambda->collector = collector_;
+    lambda->global_scope = global_scope_;
+    lambda->parameters = parameters;
+    lambda->source.assign(body.begin() + body_start, body.end());
+    lambda->enclosing_scopes = scopes_;
+    std::vector<uint32_t> names;
+    for (const auto& parameter : ListToVector(parameters)) {
+        if (!Is<Symbol>(parameter)) {
+            throw SyntaxError("lambda parameter should be a symbol");
+        }
+        names.push_back(As<Symbol>(parameter)->GetId());
+    }
+    lambda->parameter_count = names.size();
+
+    scopes_.push_back(std::move(names));
+    // внутренние define видны во всём теле, даже в формах до них
+    for (size_t i = body_start; i < body.size(); ++i) {
+        if (auto symbol = GetDefinedSymbol(body[i])) {
+            DeclareLocal(symbol->GetId());
+        }
+    }
+    lambda->body = std::make_shared<BeginExecutor>(AnalyzeSequence(body, body_start));
+    lambda->frame_size = scopes_.back().size();
+    scopes_.pop_back();
+    return lambda;
+}
+
+std::vector<ExecutorPtr> Analyzer::AnalyzeSequence(const FormArguments& forms, size_t start) {
+    std::vector<ExecutorPtr> executors;
+    executors.reserve(forms.size() - start);
+    for (size_t i = start; i < forms.size(); ++i) {
+        executors.push_back(AnalyzeForm(forms[i]));
+    }
+    return executors;
+}
+
+bool Analyzer::ResolveLocal(uint32_t name, uint16_t* depth, uint32_t* slot) const {
+    for (size_t i = scopes_.size(); i > 0; --i) {
+        const auto& names = scopes_[i - 1];
+        for (size_t j = 0; j < names.size(); ++j) {
+            if (names[j] == name) {
+                *depth = scopes_.size() - i;
+                *slot = j;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Analyzer::IsLocal(uint32_t name) const {
+    uint16_t depth;
+    uint32_t slot;
+    return ResolveLocal(name, &depth, &slot);
+}
+
+uint32_t Analyzer::DeclareLocal(uint32_t name) {
+    auto& names = scopes_.back();
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (names[i] == name) {
+            return i;
+        }
+    }
+    names.push_back(name);
+    return names.size() - 1;
+}
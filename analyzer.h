@@ -0,0 +1,148 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "collector.h"
+#include "object.h"
+
+class Closure;
+
+/// вызов замыкания из хвостовой позиции, который Closure::Run сделает сам, без рекурсии;
+/// аргументы уже лежат в слотах frame
+struct TailCall {
+    std::shared_ptr<Closure> closure;
+    std::shared_ptr<Frame> frame;
+};
+
+/// Узел дерева, в которое Analyzer один раз переводит форму. Спецформа это или вызов,
+/// глобальное имя или локальное - всё решено заранее, Execute только исполняет.
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    virtual std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>& frame) = 0;
+
+    /// Исполнение в хвостовой позиции тела lambda. Если в итоге надо вызвать замыкание,
+    /// вызов записывается в tail_call, а результат ничего не значит.
+    virtual std::shared_ptr<Object> ExecuteTail(const std::shared_ptr<Frame>& frame,
+                                                TailCall*) {
+        return Execute(frame);
+    }
+};
+
+/// Узел, у которого есть хвостовая позиция: вызов, if, cond, begin, and, or. Достаточно
+/// определить ExecuteTail, обычный Execute доделает отложенный вызов сам.
+class TailExecutor : public Executor {
+public:
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Frame>& frame) final;
+};
+
+using ExecutorPtr = std::shared_ptr<Executor>;
+
+struct LambdaInfo {
+    size_t parameter_count = 0;
+    /// параметры и внутренние define
+    size_t frame_size = 0;
+    ExecutorPtr body;
+    CycleCollector* collector = nullptr;
+    Scope* global_scope = nullptr;
+
+    /// исходник, по которому Analyzer заново строит body при загрузке образа кучи
+    std::shared_ptr<Object> parameters;
+    std::vector<std::shared_ptr<Object>> source;
+    /// имена слотов объемлющих lambda на момент разбора
+    std::vector<std::vector<uint32_t>> enclosing_scopes;
+};
+
+class Closure : public Function {
+public:
+    static constexpr ObjectType kType = ObjectType::CLOSURE;
+
+    Closure(std::shared_ptr<LambdaInfo> lambda, std::shared_ptr<Frame> frame)
+        : Function(kType), lambda_(std::move(lambda)), frame_(std::move(frame)){};
+
+    std::shared_ptr<Object> Apply(Arguments arg_vector) override;
+
+    Frame* GetCapturedFrame() const override {
+        return frame_.get();
+    }
+    Scope* GetGlobalScope() const override {
+        return lambda_->global_scope;
+    }
+    CycleCollector* GetCollector() const override {
+        return lambda_->collector;
+    }
+    const std::shared_ptr<LambdaInfo>& GetLambda() const {
+        return lambda_;
+    }
+    const std::shared_ptr<Frame>& GetFrame() const {
+        return frame_;
+    }
+
+    /// кадр для вызова с argc аргументами; слоты параметров заполняет вызывающий
+    std::shared_ptr<Frame> MakeFrame(size_t argc) const;
+    /// исполняет тело в кадре от MakeFrame вместе со всеми хвостовыми вызовами
+    std::shared_ptr<Object> Run(std::shared_ptr<Frame> frame);
+
+protected:
+    std::shared_ptr<LambdaInfo> lambda_;
+    std::shared_ptr<Frame> frame_;
+};
+
+/// разбор форм, общий для Analyzer и Compiler
+std::vector<std::shared_ptr<Object>> ListToVector(std::shared_ptr<Object> list);
+std::shared_ptr<Symbol> GetDefinedSymbol(const std::shared_ptr<Object>& form);
+
+struct CondClause {
+    bool is_else = false;
+    std::shared_ptr<Object> test;
+    /// формы после условия, может быть пустым - тогда результат это значение условия
+    std::vector<std::shared_ptr<Object>> body;
+};
+std::vector<CondClause> ParseCondClauses(const std::vector<std::shared_ptr<Object>>& args);
+/// (future expr) -> ('make-future (lambda () expr)): builtin подставлен константой, так
+/// что его не подменить через define
+std::shared_ptr<Object> ExpandFuture(const std::vector<std::shared_ptr<Object>>& args);
+
+class Analyzer {
+public:
+    Analyzer(Scope* global_scope, CycleCollector* collector)
+        : global_scope_(global_scope), collector_(collector){};
+
+    ExecutorPtr Analyze(const std::shared_ptr<Object>& form);
+    /// заново разбирает исходник lambda из образа, в тех же объемлющих областях
+    void RestoreLambda(LambdaInfo* lambda);
+
+protected:
+    using FormArguments = std::vector<std::shared_ptr<Object>>;
+
+    ExecutorPtr AnalyzeForm(const std::shared_ptr<Object>& form);
+    ExecutorPtr AnalyzeSymbol(uint32_t name);
+    ExecutorPtr AnalyzeCell(const Cell* form);
+
+    ExecutorPtr AnalyzeQuote(const FormArguments& args);
+    ExecutorPtr AnalyzeIf(const FormArguments& args);
+    ExecutorPtr AnalyzeCond(const FormArguments& args);
+    ExecutorPtr AnalyzeDefine(const FormArguments& args);
+    ExecutorPtr AnalyzeSet(const FormArguments& args);
+    ExecutorPtr AnalyzeLambda(const FormArguments& args);
+    ExecutorPtr AnalyzeBegin(const FormArguments& args);
+    ExecutorPtr AnalyzeAnd(const FormArguments& args);
+    ExecutorPtr AnalyzeOr(const FormArguments& args);
+    ExecutorPtr AnalyzeFuture(const FormArguments& args);
+
+    std::shared_ptr<LambdaInfo> MakeLambda(const std::shared_ptr<Object>& parameters,
+                                           const FormArguments& body, size_t body_start);
+    std::vector<ExecutorPtr> AnalyzeSequence(const FormArguments& forms, size_t start);
+    /// глубина и слот локального имени; false, если имя глобальное
+    bool ResolveLocal(uint32_t name, uint16_t* depth, uint32_t* slot) const;
+    bool IsLocal(uint32_t name) const;
+    uint32_t DeclareLocal(uint32_t name);
+
+protected:
+    Scope* global_scope_;
+    CycleCollector* collector_;
+    /// имена слотов для каждой объемлющей lambda, последняя - самая внутренняя
+    std::vector<std::vector<uint32_t>> scopes_;
+};
@@ -0,0 +1,336 @@
+#include "bignum.h"
+
+#include <algorithm>
+#include <charconv>
+#include <utility>
+
+namespace {
+
+using Digits = std::vector<uint32_t>;
+
+constexpr uint64_t kBase = BigInteger::kBase;
+
+/// ниже этого числа разрядов у меньшего множителя Карацуба проигрывает столбику
+constexpr size_t kKaratsubaThreshold = 40;
+
+void Trim(Digits* digits) {
+    while (!digits->empty() && digits->back() == 0) {
+        digits->pop_back();
+    }
+}
+
+int CompareDigits(const Digits& lhs, const Digits& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return lhs.size() < rhs.size() ? -1 : 1;
+    }
+    for (size_t i = lhs.size(); i > 0; --i) {
+        if (lhs[i - 1] != rhs[i - 1]) {
+            return lhs[i - 1] < rhs[i - 1] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/// dst += src * kBase^shift
+void AddShifted(Digits* dst, const Digits& src, size_t shift) {
+    if (dst->size() < src.size() + shift) {
+        dst->resize(src.size() + shift, 0);
+    }
+    uint32_t carry = 0;
+    size_t i = 0;
+    for (; i < src.size() || carry != 0; ++i) {
+        if (shift + i == dst->size()) {
+            dst->push_back(0);
+        }
+        uint32_t sum = (*dst)[shift + i] + carry + (i < src.size() ? src[i] : 0);
+        carry = sum >= kBase;
+        (*dst)[shift + i] = carry ? sum - kBase : sum;
+    }
+}
+
+Digits AddDigits(const Digits& lhs, const Digits& rhs) {
+    const Digits& longer = lhs.size() >= rhs.size() ? lhs : rhs;
+    const Digits& shorter = lhs.size() >= rhs.size() ? rhs : lhs;
+    Digits result(longer.size() + 1);
+    uint32_t carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i) {
+        uint32_t sum = longer[i] + (i < shorter.size() ? shorter[i] : 0) + carry;
+        carry = sum >= kBase;
+        result[i] = sum - (carry ? kBase : 0);
+    }
+    result.back() = carry;
+    Trim(&result);
+    return result;
+}
+
+/// lhs - rhs при lhs >= rhs
+Digits SubtractDigits(const Digits& lhs, const Digits& rhs) {
+    Digits result = lhs;
+    uint32_t borrow = 0;
+    for (size_t i = 0; i < rhs.size() || borrow != 0; ++i) {
+        uint32_t subtrahend = borrow + (i < rhs.size() ? rhs[i] : 0);
+        borrow = result[i] < subtrahend;
+        result[i] = borrow ? result[i] + kBase - subtrahend : result[i] - subtrahend;
+    }
+    Trim(&result);
+    return result;
+}
+
+Digits MultiplySchoolbook(const Digits& lhs, const Digits& rhs) {
+    if (lhs.empty() || rhs.empty()) {
+        return {};
+    }
+    Digits result(lhs.size() + rhs.size(), 0);
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        uint64_t carry = 0;
+        // произведение разрядов меньше 10^18, так что сумма с переносом влезает в uint64_t
+        for (size_t j = 0; j < rhs.size(); ++j) {
+            uint64_t current = result[i + j] + uint64_t{lhs[i]} * rhs[j] + carry;
+            result[i + j] = current % kBase;
+            carry = current / kBase;
+        }
+        result[i + rhs.size()] = carry;
+    }
+    Trim(&result);
+    return result;
+}
+
+Digits Slice(const Digits& digits, size_t begin, size_t end) {
+    begin = std::min(begin, digits.size());
+    end = std::min(end, digits.size());
+    Digits result(digits.begin() + begin, digits.begin() + end);
+    Trim(&result);
+    return result;
+}
+
+Digits MultiplyDigits(const Digits& lhs, const Digits& rhs);
+
+/// (a1 B^h + a0)(b1 B^h + b0) = z2 B^2h + z1 B^h + z0, z1 = (a1 + a0)(b1 + b0) - z2 - z0
+Digits MultiplyKaratsuba(const Digits& lhs, const Digits& rhs) {
+    size_t half = std::max(lhs.size(), rhs.size()) / 2;
+    Digits lhs_low = Slice(lhs, 0, half);
+    Digits lhs_high = Slice(lhs, half, lhs.size());
+    Digits rhs_low = Slice(rhs, 0, half);
+    Digits rhs_high = Slice(rhs, half, rhs.size());
+
+    Digits low = MultiplyDigits(lhs_low, rhs_low);
+    Digits high = MultiplyDigits(lhs_high, rhs_high);
+    Digits middle = MultiplyDigits(AddDigits(lhs_low, lhs_high), AddDigits(rhs_low, rhs_high));
+    middle = SubtractDigits(SubtractDigits(middle, low), high);
+
+    Digits result = std::move(low);
+    AddShifted(&result, middle, half);
+    AddShifted(&result, high, 2 * half);
+    Trim(&result);
+    return result;
+}
+
+Digits MultiplyDigits(const Digits& lhs, const Digits& rhs) {
+    const Digits& longer = lhs.size() >= rhs.size() ? lhs : rhs;
+    const Digits& shorter = lhs.size() >= rhs.size() ? rhs : lhs;
+    if (shorter.size() < kKaratsubaThreshold) {
+        return MultiplySchoolbook(longer, shorter);
+    }
+    if (longer.size() < 2 * shorter.size()) {
+        return MultiplyKaratsuba(longer, shorter);
+    }
+    // сильно разные длины: длинный множитель режется на куски длины короткого
+    Digits result;
+    for (size_t begin = 0; begin < longer.size(); begin += shorter.size()) {
+        AddShifted(&result,
+                   MultiplyDigits(Slice(longer, begin, begin + shorter.size()), shorter), begin);
+    }
+    Trim(&result);
+    return result;
+}
+
+Digits MultiplySmall(const Digits& digits, uint32_t factor) {
+    Digits result(digits.size() + 1, 0);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < digits.size(); ++i) {
+        uint64_t current = uint64_t{digits[i]} * factor + carry;
+        result[i] = current % kBase;
+        carry = current / kBase;
+    }
+    result[digits.size()] = carry;
+    Trim(&result);
+    return result;
+}
+
+Digits DivideSmall(const Digits& digits, uint32_t divisor) {
+    Digits result(digits.size(), 0);
+    uint64_t remainder = 0;
+    for (size_t i = digits.size(); i > 0; --i) {
+        uint64_t current = remainder * kBase + digits[i - 1];
+        result[i - 1] = current / divisor;
+        remainder = current % divisor;
+    }
+    Trim(&result);
+    return result;
+}
+
+/// Деление столбиком по Кнуту (алгоритм D). После нормализации старший разряд делителя не
+/// меньше kBase / 2, и оценка очередной цифры частного ошибается не больше чем на 2.
+Digits DivideDigits(const Digits& dividend, const Digits& divisor) {
+    if (CompareDigits(dividend, divisor) < 0) {
+        return {};
+    }
+    if (divisor.size() == 1) {
+        return DivideSmall(dividend, divisor[0]);
+    }
+    uint32_t scale = kBase / (uint64_t{divisor.back()} + 1);
+    Digits u = MultiplySmall(dividend, scale);
+    Digits v = MultiplySmall(divisor, scale);
+    size_t n = v.size();
+    u.resize(dividend.size() + 1, 0);
+    Digits quotient(u.size() - n, 0);
+
+    for (size_t j = quotient.size(); j-- > 0;) {
+        uint64_t numerator = uint64_t{u[j + n]} * kBase + u[j + n - 1];
+        uint64_t estimate = numerator / v[n - 1];
+        uint64_t rest = numerator % v[n - 1];
+        while (estimate >= kBase || estimate * v[n - 2] > rest * kBase + u[j + n - 2]) {
+            --estimate;
+            rest += v[n - 1];
+            if (rest >= kBase) {
+                break;
+            }
+        }
+
+        // u[j..j+n] -= estimate * v
+        int64_t borrow = 0;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t product = estimate * v[i] + carry;
+            carry = product / kBase;
+            int64_t difference = int64_t{u[i + j]} - int64_t(product % kBase) - borrow;
+            borrow = difference < 0;
+            u[i + j] = difference + (borrow ? kBase : 0);
+        }
+        int64_t top = int64_t{u[j + n]} - int64_t(carry) - borrow;
+        if (top < 0) {
+            // оценка оказалась на единицу больше: возвращаем один делитель
+            --estimate;
+            carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t sum = uint64_t{u[i + j]} + v[i] + carry;
+                carry = sum >= kBase;
+                u[i + j] = sum - (carry ? kBase : 0);
+            }
+            top += carry;
+        }
+        u[j + n] = top;
+        quotient[j] = estimate;
+    }
+    Trim(&quotient);
+    return quotient;
+}
+
+}  // namespace
+
+BigInteger::BigInteger(int64_t value) : negative_(value < 0) {
+    // модуль INT64_MIN не помещается в int64_t, поэтому считаем в uint64_t
+    uint64_t magnitude = negative_ ? 0 - static_cast<uint64_t>(value) : value;
+    while (magnitude != 0) {
+        digits_.push_back(magnitude % kBase);
+        magnitude /= kBase;
+    }
+}
+
+BigInteger::BigInteger(bool negative, std::vector<uint32_t> digits)
+    : negative_(negative && !digits.empty()), digits_(std::move(digits)) {
+}
+
+BigInteger BigInteger::Parse(std::string_view text) {
+    bool negative = false;
+    if (!text.empty() && (text.front() == '-' || text.front() == '+')) {
+        negative = text.front() == '-';
+        text.remove_prefix(1);
+    }
+    Digits digits;
+    digits.reserve(text.size() / kBaseDigits + 1);
+    for (size_t end = text.size(); end > 0;) {
+        size_t begin = end > kBaseDigits ? end - kBaseDigits : 0;
+        uint32_t digit = 0;
+        std::from_chars(text.data() + begin, text.data() + end, digit);
+        digits.push_back(digit);
+        end = begin;
+    }
+    Trim(&digits);
+    return BigInteger(negative, std::move(digits));
+}
+
+bool BigInteger::FitsInt64() const {
+    if (digits_.size() > 3) {
+        return false;
+    }
+    unsigned __int128 magnitude = 0;
+    for (size_t i = digits_.size(); i > 0; --i) {
+        magnitude = magnitude * kBase + digits_[i - 1];
+    }
+    return magnitude <= static_cast<uint64_t>(INT64_MAX) + (negative_ ? 1 : 0);
+}
+
+int64_t BigInteger::ToInt64() const {
+    uint64_t magnitude = 0;
+    for (size_t i = digits_.size(); i > 0; --i) {
+        magnitude = magnitude * kBase + digits_[i - 1];
+    }
+    return negative_ ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+}
+
+std::string BigInteger::ToString() const {
+    if (digits_.empty()) {
+        return "0";
+    }
+    std::string result(negative_ + digits_.size() * kBaseDigits, '0');
+    char* out = result.data();
+    if (negative_) {
+        *out++ = '-';
+    }
+    out = std::to_chars(out, out + kBaseDigits, digits_.back()).ptr;
+    // остальные разряды ровно по 9 цифр с ведущими нулями
+    for (size_t i = digits_.size() - 1; i > 0; --i) {
+        char* end = out + kBaseDigits;
+        for (uint32_t digit = digits_[i - 1]; digit != 0; digit /= 10) {
+            *--end = '0' + digit % 10;
+        }
+        out += kBaseDigits;
+    }
+    result.resize(out - result.data());
+    return result;
+}
+
+int BigInteger::Compare(const BigInteger& other) const {
+    if (negative_ != other.negative_) {
+        return negative_ ? -1 : 1;
+    }
+    int magnitude = CompareDigits(digits_, other.digits_);
+    return negative_ ? -magnitude : magnitude;
+}
+
+BigInteger BigInteger::operator-() const {
+    return BigInteger(!negative_, digits_);
+}
+
+BigInteger BigInteger::operator+(const BigInteger& other) const {
+    if (negative_ == other.negative_) {
+        return BigInteger(negative_, AddDigits(digits_, other.digits_));
+    }
+    if (CompareDigits(digits_, other.digits_) >= 0) {
+        return BigInteger(negative_, SubtractDigits(digits_, other.digits_));
+    }
+    return BigInteger(other.negative_, SubtractDigits(other.digits_, digits_));
+}
+
+BigInteger BigInteger::operator-(const BigInteger& other) const {
+    return *this + -other;
+}
+
+BigInteger BigInteger::operator*(const BigInteger& other) const {
+    return BigInteger(negative_ != other.negative_, MultiplyDigits(digits_, other.digits_));
+}
+
+BigInteger BigInteger::operator/(const BigInteger& other) const {
+    return BigInteger(negative_ != other.negative_, DivideDigits(digits_, other.digits_));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Целое произвольной длины: знак и модуль по основанию 10^9, младшие разряды первыми.
+/// Основание - степень десяти, поэтому и разбор, и печать идут кусками по 9 цифр без
+/// деления длинного числа. Ноль - пустой вектор разрядов, старший разряд никогда не 0.
+class BigInteger {
+public:
+    static constexpr uint32_t kBase = 1000000000;
+    static constexpr size_t kBaseDigits = 9;
+
+    BigInteger() = default;
+    explicit BigInteger(int64_t value);
+    /// разряды проверяет вызывающий: каждый меньше kBase, старший не 0
+    BigInteger(bool negative, std::vector<uint32_t> digits);
+
+    /// десятичная запись с необязательным знаком, цифры уже проверены токенизатором
+    static BigInteger Parse(std::string_view text);
+
+    bool IsNegative() const {
+        return negative_;
+    }
+    bool IsZero() const {
+        return digits_.empty();
+    }
+    const std::vector<uint32_t>& GetDigits() const {
+        return digits_;
+    }
+
+    bool FitsInt64() const;
+    /// только если FitsInt64
+    int64_t ToInt64() const;
+    std::string ToString() const;
+
+    /// -1, 0 или 1
+    int Compare(const BigInteger& other) const;
+
+    BigInteger operator-() const;
+    BigInteger operator+(const BigInteger& other) const;
+    BigInteger operator-(const BigInteger& other) const;
+    BigInteger operator*(const BigInteger& other) const;
+    /// частное с отбрасыванием дробной части, как у int64_t; делитель не 0
+    BigInteger operator/(const BigInteger& other) const;
+
+protected:
+    bool negative_ = false;
+    std::vector<uint32_t> digits_;
+};
@@ -0,0 +1,710 @@
+#include "bytecode.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "analyzer.h"
+#include "scheduler.h"
+
+std::shared_ptr<Object> BytecodeClosure::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != prototype_->parameter_count) {
+        throw RuntimeError("wrong number of arguments in lambda call");
+    }
+    auto frame = std::make_shared<Frame>(prototype_->frame_size, frame_);
+    prototype_->collector->Track(frame);
+    for (size_t i = 0; i < arg_vector.size(); ++i) {
+        frame->slots[i] = Binding{arg_vector[i], true};
+    }
+    thread_local VirtualMachine vm;
+    return vm.Execute(prototype_, std::move(frame));
+}
+
+std::shared_ptr<Prototype> Compiler::Compile(const std::shared_ptr<Object>& form) {
+    auto prototype = std::make_shared<Prototype>();
+    prototype->global_scope = global_scope_;
+    prototype_ = prototype.get();
+    scopes_.clear();
+    CompileForm(form, true);
+    Emit(Opcode::RETURN);
+    return prototype;
+}
+
+void Compiler::CompileForm(const std::shared_ptr<Object>& form, bool tail) {
+    if (form == nullptr) {
+        Emit(Opcode::FAIL, AddConstant(Symbol::Intern("cannot evaluate empty list")));
+    } else if (Is<Symbol>(form)) {
+        CompileSymbol(As<Symbol>(form)->GetId());
+    } else if (Is<Cell>(form)) {
+        CompileCell(As<Cell>(form), tail);
+    } else {
+        Emit(Opcode::CONST, AddConstant(form));
+    }
+}
+
+void Compiler::CompileSymbol(uint32_t name) {
+    uint16_t depth;
+    uint32_t slot;
+    if (ResolveLocal(name, &depth, &slot)) {
+        Emit(Opcode::LOAD_LOCAL, slot, depth);
+    } else {
+        Emit(Opcode::LOAD_GLOBAL, AddGlobal(name));
+    }
+}
+
+void Compiler::CompileCell(const Cell* form, bool tail) {
+    using SpecialFormCompiler = void (Compiler::*)(const FormArguments&, bool);
+    static const std::unordered_map<uint32_t, SpecialFormCompiler> special_forms = {
+        {Symbol::Intern("quote")->GetId(), &Compiler::CompileQuote},
+        {Symbol::Intern("if")->GetId(), &Compiler::CompileIf},
+        {Symbol::Intern("cond")->GetId(), &Compiler::CompileCond},
+        {Symbol::Intern("define")->GetId(), &Compiler::CompileDefine},
+        {Symbol::Intern("set!")->GetId(), &Compiler::CompileSet},
+        {Symbol::Intern("lambda")->GetId(), &Compiler::CompileLambda},
+        {Symbol::Intern("begin")->GetId(), &Compiler::CompileBegin},
+        {Symbol::Intern("and")->GetId(), &Compiler::CompileAnd},
+        {Symbol::Intern("or")->GetId(), &Compiler::CompileOr},
+        {Symbol::Intern("future")->GetId(), &Compiler::CompileFuture}};
+
+    auto args = ListToVector(form->GetSecond());
+    if (auto head = As<Symbol>(form->GetFirst()); head != nullptr && !IsLocal(head->GetId())) {
+        auto it = special_forms.find(head->GetId());
+        if (it != special_forms.end()) {
+            (this->*(it->second))(args, tail);
+            return;
+        }
+    }
+    CompileCall(form->GetFirst(), args, tail);
+}
+
+void Compiler::CompileCall(const std::shared_ptr<Object>& head, const FormArguments& args,
+                           bool tail) {
+    struct InlineOperation {
+        Opcode opcode;
+        bool (*is_builtin)(const std::shared_ptr<Object>&);
+    };
+    static const std::unordered_map<uint32_t, InlineOperation> inline_operations = {
+        {Symbol::Intern("+")->GetId(),
+         {Opcode::ADD, [](const std::shared_ptr<Object>& f) { return Is<Add>(f); }}},
+        {Symbol::Intern("-")->GetId(),
+         {Opcode::SUBTRACT, [](const std::shared_ptr<Object>& f) { return Is<Subtract>(f); }}},
+        {Symbol::Intern("*")->GetId(),
+         {Opcode::MULTIPLY, [](const std::shared_ptr<Object>& f) { return Is<Multiply>(f); }}},
+        {Symbol::Intern("<")->GetId(),
+         {Opcode::LESS, [](const std::shared_ptr<Object>& f) { return Is<Less>(f); }}},
+        {Symbol::Intern(">")->GetId(),
+         {Opcode::GREATER, [](const std::shared_ptr<Object>& f) { return Is<Greater>(f); }}},
+        {Symbol::Intern("=")->GetId(),
+         {Opcode::EQUALS, [](const std::shared_ptr<Object>& f) { return Is<Equals>(f); }}},
+        {Symbol::Intern("<=")->GetId(),
+         {Opcode::LEQUALS, [](const std::shared_ptr<Object>& f) { return Is<LEquals>(f); }}},
+        {Symbol::Intern(">=")->GetId(),
+         {Opcode::GEQUALS, [](const std::shared_ptr<Object>& f) { return Is<GEquals>(f); }}}};
+
+    // (+ a b) с глобальным + компилируется в одну инструкцию; если + потом переопределят,
+    // guard это заметит и инструкция сделает обычный вызов
+    if (auto name = As<Symbol>(head); name != nullptr && args.size() == 2 &&
+                                      !IsLocal(name->GetId())) {
+        auto it = inline_operations.find(name->GetId());
+        Binding* binding = global_scope_->GetBinding(name->GetId());
+        if (it != inline_operations.end() && binding->is_defined &&
+            it->second.is_builtin(binding->value)) {
+            CompileForm(args[0], false);
+            CompileForm(args[1], false);
+            prototype_->guards.push_back(InlineGuard{binding, binding->value.get()});
+            Emit(it->second.opcode, prototype_->guards.size() - 1);
+            return;
+        }
+    }
+
+    CompileForm(head, false);
+    for (const auto& arg : args) {
+        CompileForm(arg, false);
+    }
+    Emit(tail ? Opcode::TAIL_CALL : Opcode::CALL, args.size());
+}
+
+void Compiler::CompileQuote(const FormArguments& args, bool) {
+    if (args.size() != 1) {
+        throw SyntaxError("quote needs exactly one argument");
+    }
+    Emit(Opcode::CONST, AddConstant(args[0]));
+}
+
+void Compiler::CompileIf(const FormArguments& args, bool tail) {
+    if (args.size() != 2 && args.size() != 3) {
+        throw SyntaxError("if needs condition and one or two branches");
+    }
+    CompileForm(args[0], false);
+    size_t to_else = Emit(Opcode::JUMP_IF_FALSE);
+    CompileForm(args[1], tail);
+    size_t to_end = Emit(Opcode::JUMP);
+    PatchJump(to_else);
+    if (args.size() == 3) {
+        CompileForm(args[2], tail);
+    } else {
+        Emit(Opcode::CONST, AddConstant(nullptr));
+    }
+    PatchJump(to_end);
+}
+
+void Compiler::CompileCond(const FormArguments& args, bool tail) {
+    std::vector<size_t> to_end;
+    bool has_else = false;
+    for (const auto& clause : ParseCondClauses(args)) {
+        if (clause.is_else) {
+            CompileSequence(clause.body, 0, tail);
+            has_else = true;
+            break;
+        }
+        CompileForm(clause.test, false);
+        if (clause.body.empty()) {
+            to_end.push_back(Emit(Opcode::JUMP_IF_TRUE_KEEP));
+            continue;
+        }
+        size_t to_next = Emit(Opcode::JUMP_IF_FALSE);
+        CompileSequence(clause.body, 0, tail);
+        to_end.push_back(Emit(Opcode::JUMP));
+        PatchJump(to_next);
+    }
+    if (!has_else) {
+        Emit(Opcode::CONST, AddConstant(nullptr));
+    }
+    for (size_t position : to_end) {
+        PatchJump(position);
+    }
+}
+
+void Compiler::CompileDefine(const FormArguments& args, bool) {
+    if (args.empty()) {
+        throw SyntaxError("argument is nullptr in define");
+    }
+    uint32_t name;
+    uint32_t slot = 0;
+    if (auto signature = As<Cell>(args[0])) {
+        // (define (name params...) body...)
+        if (!Is<Symbol>(signature->GetFirst()) || args.size() < 2) {
+            throw SyntaxError("define error");
+        }
+        name = As<Symbol>(signature->GetFirst())->GetId();
+        if (!scopes_.empty()) {
+            slot = DeclareLocal(name);
+        }
+        CompileLambdaBody(signature->GetSecond(), args, 1);
+    } else {
+        if (!Is<Symbol>(args[0]) || args.size() != 2) {
+            throw SyntaxError("define error");
+        }
+        name = As<Symbol>(args[0])->GetId();
+        if (!scopes_.empty()) {
+            slot = DeclareLocal(name);
+        }
+        CompileForm(args[1], false);
+    }
+    if (scopes_.empty()) {
+        Emit(Opcode::DEFINE_GLOBAL, AddGlobal(name));
+    } else {
+        Emit(Opcode::DEFINE_LOCAL, slot);
+    }
+    Emit(Opcode::CONST, AddConstant(Symbol::Intern("defined!")));
+}
+
+void Compiler::CompileSet(const FormArguments& args, bool) {
+    if (args.size() != 2 || !Is<Symbol>(args[0])) {
+        throw SyntaxError("set! needs a name and a value");
+    }
+    CompileForm(args[1], false);
+    uint16_t depth;
+    uint32_t slot;
+    if (ResolveLocal(As<Symbol>(args[0])->GetId(), &depth, &slot)) {
+        Emit(Opcode::STORE_LOCAL, slot, depth);
+    } else {
+        Emit(Opcode::STORE_GLOBAL, AddGlobal(As<Symbol>(args[0])->GetId()));
+    }
+    Emit(Opcode::CONST, AddConstant(Symbol::Intern("set!")));
+}
+
+void Compiler::CompileLambda(const FormArguments& args, bool) {
+    if (args.size() < 2) {
+        throw SyntaxError("lambda needs parameters and body");
+    }
+    CompileLambdaBody(args[0], args, 1);
+}
+
+void Compiler::CompileBegin(const FormArguments& args, bool tail) {
+    if (args.empty()) {
+        throw SyntaxError("begin needs at least one form");
+    }
+    CompileSequence(args, 0, tail);
+}
+
+void Compiler::CompileAnd(const FormArguments& args, bool tail) {
+    CompileShortCircuit(args, Opcode::JUMP_IF_FALSE_KEEP, true, tail);
+}
+
+void Compiler::CompileOr(const FormArguments& args, bool tail) {
+    CompileShortCircuit(args, Opcode::JUMP_IF_TRUE_KEEP, false, tail);
+}
+
+void Compiler::CompileFuture(const FormArguments& args, bool tail) {
+    CompileForm(ExpandFuture(args), tail);
+}
+
+void Compiler::CompileLambdaBody(const std::shared_ptr<Object>& parameters,
+                                 const FormArguments& body, size_t body_start) {
+    auto prototype = std::make_shared<Prototype>();
+    prototype->collector = collector_;
+    prototype->global_scope = global_scope_;
+    std::vector<uint32_t> names;
+    for (const auto& parameter : ListToVector(parameters)) {
+        if (!Is<Symbol>(parameter)) {
+            throw SyntaxError("lambda parameter should be a symbol");
+        }
+        names.push_back(As<Symbol>(parameter)->GetId());
+    }
+    prototype->parameter_count = names.size();
+
+    Prototype* enclosing = prototype_;
+    prototype_ = prototype.get();
+    scopes_.push_back(std::move(names));
+    // внутренние define видны во всём теле, даже в формах до них
+    for (size_t i = body_start; i < body.size(); ++i) {
+        if (auto symbol = GetDefinedSymbol(body[i])) {
+            DeclareLocal(symbol->GetId());
+        }
+    }
+    CompileSequence(body, body_start, true);
+    Emit(Opcode::RETURN);
+    prototype->frame_size = scopes_.back().size();
+    scopes_.pop_back();
+    prototype_ = enclosing;
+
+    prototype_->prototypes.push_back(std::move(prototype));
+    Emit(Opcode::MAKE_CLOSURE, prototype_->prototypes.size() - 1);
+}
+
+void Compiler::CompileSequence(const FormArguments& forms, size_t start, bool tail) {
+    for (size_t i = start; i < forms.size(); ++i) {
+        bool is_last = i + 1 == forms.size();
+        CompileForm(forms[i], tail && is_last);
+        if (!is_last) {
+            Emit(Opcode::POP);
+        }
+    }
+}
+
+void Compiler::CompileShortCircuit(const FormArguments& args, Opcode jump, bool empty_value,
+                                   bool tail) {
+    if (args.empty()) {
+        Emit(Opcode::CONST, AddConstant(Bool::Make(empty_value)));
+        return;
+    }
+    std::vector<size_t> jumps;
+    for (size_t i = 0; i < args.size(); ++i) {
+        bool is_last = i + 1 == args.size();
+        CompileForm(args[i], tail && is_last);
+        if (!is_last) {
+            jumps.push_back(Emit(jump));
+        }
+    }
+    for (size_t position : jumps) {
+        PatchJump(position);
+    }
+}
+
+size_t Compiler::Emit(Opcode opcode, uint32_t b, uint16_t a) {
+    prototype_->code.push_back(Instruction{opcode, a, b});
+    return prototype_->code.size() - 1;
+}
+
+void Compiler::PatchJump(size_t position) {
+    prototype_->code[position].b = prototype_->code.size();
+}
+
+uint32_t Compiler::AddConstant(std::shared_ptr<Object> value) {
+    prototype_->constants.push_back(std::move(value));
+    return prototype_->constants.size() - 1;
+}
+
+uint32_t Compiler::AddGlobal(uint32_t name) {
+    Binding* binding = global_scope_->GetBinding(name);
+    auto& globals = prototype_->globals;
+    for (size_t i = 0; i < globals.size(); ++i) {
+        if (globals[i] == binding) {
+            return i;
+        }
+    }
+    globals.push_back(binding);
+    return globals.size() - 1;
+}
+
+bool Compiler::ResolveLocal(uint32_t name, uint16_t* depth, uint32_t* slot) const {
+    for (size_t i = scopes_.size(); i > 0; --i) {
+        const auto& names = scopes_[i - 1];
+        for (size_t j = 0; j < names.size(); ++j) {
+            if (names[j] == name) {
+                *depth = scopes_.size() - i;
+                *slot = j;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Compiler::IsLocal(uint32_t name) const {
+    uint16_t depth;
+    uint32_t slot;
+    return ResolveLocal(name, &depth, &slot);
+}
+
+uint32_t Compiler::DeclareLocal(uint32_t name) {
+    auto& names = scopes_.back();
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (names[i] == name) {
+            return i;
+        }
+    }
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+std::shared_ptr<Object> VirtualMachine::Execute(const std::shared_ptr<Prototype>& prototype,
+                                                std::shared_ptr<Frame> frame) {
+    size_t entry_depth = calls_.size();
+    size_t entry_stack_size = stack_.size();
+    calls_.push_back(CallRecord{prototype, 0, std::move(frame), entry_stack_size});
+    try {
+        return Run(entry_depth);
+    } catch (...) {
+        calls_.resize(entry_depth);
+        stack_.resize(entry_stack_size);
+        throw;
+    }
+}
+
+void VirtualMachine::Start(const std::shared_ptr<Prototype>& prototype) {
+    Clear();
+    calls_.push_back(CallRecord{prototype, 0, nullptr, 0});
+}
+
+bool VirtualMachine::Resume(uint64_t fuel, std::shared_ptr<Object>* result) {
+    if (calls_.empty()) {
+        throw RuntimeError("nothing to resume");
+    }
+    fuel_ = static_cast<int64_t>(std::min<uint64_t>(fuel, std::numeric_limits<int64_t>::max()));
+    try {
+        auto value = Run(0);
+        fuel_ = std::numeric_limits<int64_t>::max();
+        // Run возвращается и тогда, когда топливо кончилось, - стек вызовов при этом не пуст
+        if (!calls_.empty()) {
+            return false;
+        }
+        *result = std::move(value);
+        return true;
+    } catch (...) {
+        fuel_ = std::numeric_limits<int64_t>::max();
+        Clear();
+        throw;
+    }
+}
+
+void VirtualMachine::Clear() {
+    stack_.clear();
+    calls_.clear();
+}
+
+std::shared_ptr<Frame> VirtualMachine::MakeFrame(const BytecodeClosure& closure, size_t argc) {
+    const auto& prototype = closure.GetPrototype();
+    if (argc != prototype->parameter_count) {
+        throw RuntimeError("wrong number of arguments in lambda call");
+    }
+    auto frame = std::make_shared<Frame>(prototype->frame_size, closure.GetFrame());
+    prototype->collector->Track(frame);
+    auto args = stack_.end() - argc;
+    for (size_t i = 0; i < argc; ++i) {
+        frame->slots[i] = Binding{std::move(args[i]), true};
+    }
+    return frame;
+}
+
+void VirtualMachine::CallInlineFallback(const InlineGuard& guard) {
+    const auto* value = ReadGlobal(guard.binding);
+    if (value == nullptr) {
+        throw NameError("wrong variable name");
+    }
+    // Apply может переопределить само имя, поэтому функцию держим сами
+    auto function = AsShared<Function>(*value);
+    if (function == nullptr) {
+        throw RuntimeError("not a function in eval");
+    }
+    auto result = function->Apply2(stack_[stack_.size() - 2], stack_.back());
+    stack_.pop_back();
+    stack_.back() = std::move(result);
+}
+
+void VirtualMachine::CallFunction(size_t base) {
+    auto callee = std::move(stack_[base]);
+    auto function = As<Function>(callee);
+    if (function == nullptr) {
+        throw RuntimeError("not a function in eval");
+    }
+    // аргументы остаются на стеке, builtin читает их прямо оттуда
+    auto result = function->Apply(Arguments(stack_).subspan(base + 1));
+    stack_.resize(base);
+    stack_.push_back(std::move(result));
+}
+
+// GCC и clang умеют брать адрес метки, тогда каждая инструкция прыгает сразу в следующий
+// обработчик; иначе обычный switch в цикле. goto по адресу не вызывает деструкторы
+// локальных переменных блока, из которого уходит, поэтому такие переменные в обработчиках
+// живут во вложенном блоке или в отдельной функции.
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO
+#endif
+
+#ifdef VM_COMPUTED_GOTO
+#define VM_DISPATCH() goto* kLabels[static_cast<size_t>(code[pc].opcode)]
+#define VM_CASE(name) label_##name:
+#define VM_BEGIN() VM_DISPATCH();
+#define VM_END()
+#else
+#define VM_DISPATCH() continue
+#define VM_CASE(name) case Opcode::name:
+#define VM_BEGIN() \
+    for (;;) {     \
+        switch (code[pc].opcode) {
+#define VM_END() \
+    }            \
+    }
+#endif
+
+#define VM_INLINE_ARITHMETIC(name, expression)                                       \
+    VM_CASE(name) {                                                                  \
+        const auto& guard = prototype->guards[code[pc++].b];                         \
+        auto* lhs = As<Number>(stack_[stack_.size() - 2]);                           \
+        auto* rhs = As<Number>(stack_.back());                                       \
+        const auto* current = ReadGlobal(guard.binding);                             \
+        if (current != nullptr && current->get() == guard.builtin && lhs && rhs) {   \
+            {                                                                        \
+                auto result = (expression);                                          \
+                stack_.pop_back();                                                   \
+                stack_.back() = std::move(result);                                   \
+            }                                                                        \
+        } else {                                                                     \
+            CallInlineFallback(guard);                                               \
+        }                                                                            \
+        VM_DISPATCH();                                                               \
+    }
+
+std::shared_ptr<Object> VirtualMachine::Run(size_t entry_depth) {
+#ifdef VM_COMPUTED_GOTO
+    // порядок меток совпадает с порядком Opcode
+    static const void* const kLabels[] = {
+        &&label_CONST,         &&label_LOAD_LOCAL,         &&label_STORE_LOCAL,
+        &&label_DEFINE_LOCAL,  &&label_LOAD_GLOBAL,        &&label_STORE_GLOBAL,
+        &&label_DEFINE_GLOBAL, &&label_POP,                &&label_JUMP,
+        &&label_JUMP_IF_FALSE, &&label_JUMP_IF_FALSE_KEEP, &&label_JUMP_IF_TRUE_KEEP,
+        &&label_MAKE_CLOSURE,  &&label_CALL,               &&label_TAIL_CALL,
+        &&label_RETURN,        &&label_FAIL,               &&label_ADD,
+        &&label_SUBTRACT,      &&label_MULTIPLY,           &&label_LESS,
+        &&label_GREATER,       &&label_EQUALS,             &&label_LEQUALS,
+        &&label_GEQUALS};
+#endif
+
+    // состояние текущего вызова; владеет им calls_.back()
+    const Prototype* prototype = calls_.back().prototype.get();
+    const Instruction* code = prototype->code.data();
+    Frame* frame = calls_.back().frame.get();
+    size_t pc = calls_.back().pc;
+
+    auto enter = [&]() {
+        prototype = calls_.back().prototype.get();
+        code = prototype->code.data();
+        frame = calls_.back().frame.get();
+        pc = calls_.back().pc;
+    };
+
+    VM_BEGIN()
+
+    VM_CASE(CONST) {
+        stack_.push_back(prototype->constants[code[pc++].b]);
+        VM_DISPATCH();
+    }
+    VM_CASE(LOAD_LOCAL) {
+        const auto& instruction = code[pc++];
+        const auto& binding = frame->Lookup(instruction.a, instruction.b);
+        if (!binding.is_defined) {
+            throw NameError("wrong variable name");
+        }
+        stack_.push_back(binding.value);
+        VM_DISPATCH();
+    }
+    VM_CASE(STORE_LOCAL) {
+        const auto& instruction = code[pc++];
+        Frame* target = frame->GetAncestor(instruction.a);
+        CheckFrameWritable(*target);
+        auto& binding = target->slots[instruction.b];
+        if (!binding.is_defined) {
+            throw NameError("cannot find this name in any namespace");
+        }
+        binding.value = std::move(stack_.back());
+        stack_.pop_back();
+        VM_DISPATCH();
+    }
+    VM_CASE(DEFINE_LOCAL) {
+        frame->slots[code[pc++].b] = Binding{std::move(stack_.back()), true};
+        stack_.pop_back();
+        VM_DISPATCH();
+    }
+    VM_CASE(LOAD_GLOBAL) {
+        const auto* value = ReadGlobal(prototype->globals[code[pc++].b]);
+        if (value == nullptr) {
+            throw NameError("wrong variable name");
+        }
+        stack_.push_back(*value);
+        VM_DISPATCH();
+    }
+    VM_CASE(STORE_GLOBAL) {
+        Binding* binding = prototype->globals[code[pc++].b];
+        // задача не трогает binding-и даже для проверки: есть ли имя, знает её снимок
+        if (WorkStealingPool::IsInsideTask()) {
+            if (ReadGlobal(binding) == nullptr) {
+                throw NameError("invalid symbol to set");
+            }
+            throw RuntimeError("cannot change a global variable inside a parallel task");
+        }
+        if (!binding->is_defined) {
+            throw NameError("invalid symbol to set");
+        }
+        binding->value = std::move(stack_.back());
+        stack_.pop_back();
+        prototype->global_scope->MarkChanged(*binding);
+        VM_DISPATCH();
+    }
+    VM_CASE(DEFINE_GLOBAL) {
+        if (WorkStealingPool::IsInsideTask()) {
+            throw RuntimeError("cannot change a global variable inside a parallel task");
+        }
+        Binding* binding = prototype->globals[code[pc++].b];
+        *binding = Binding{std::move(stack_.back()), true};
+        stack_.pop_back();
+        prototype->global_scope->MarkChanged(*binding);
+        VM_DISPATCH();
+    }
+    VM_CASE(POP) {
+        ++pc;
+        stack_.pop_back();
+        VM_DISPATCH();
+    }
+    VM_CASE(JUMP) {
+        pc = code[pc].b;
+        VM_DISPATCH();
+    }
+    VM_CASE(JUMP_IF_FALSE) {
+        bool condition = GetBoolValueFromAnyType(stack_.back());
+        stack_.pop_back();
+        pc = condition ? pc + 1 : code[pc].b;
+        VM_DISPATCH();
+    }
+    VM_CASE(JUMP_IF_FALSE_KEEP) {
+        if (!GetBoolValueFromAnyType(stack_.back())) {
+            pc = code[pc].b;
+        } else {
+            stack_.pop_back();
+            ++pc;
+        }
+        VM_DISPATCH();
+    }
+    VM_CASE(JUMP_IF_TRUE_KEEP) {
+        if (GetBoolValueFromAnyType(stack_.back())) {
+            pc = code[pc].b;
+        } else {
+            stack_.pop_back();
+            ++pc;
+        }
+        VM_DISPATCH();
+    }
+    VM_CASE(MAKE_CLOSURE) {
+        {
+            const auto& lambda = prototype->prototypes[code[pc++].b];
+            auto closure = std::make_shared<BytecodeClosure>(lambda, calls_.back().frame);
+            lambda->collector->Track(closure);
+            stack_.push_back(std::move(closure));
+        }
+        VM_DISPATCH();
+    }
+    VM_CASE(CALL) {
+        if (--fuel_ < 0) {
+            // топливо кончилось: Resume начнёт с этого же вызова
+            calls_.back().pc = pc;
+            return nullptr;
+        }
+        size_t argc = code[pc++].b;
+        size_t base = stack_.size() - argc - 1;
+        if (auto* closure = As<BytecodeClosure>(stack_[base])) {
+            {
+                auto callee_frame = MakeFrame(*closure, argc);
+                auto callee = closure->GetPrototype();
+                stack_.resize(base);
+                calls_.back().pc = pc;
+                calls_.push_back(CallRecord{std::move(callee), 0, std::move(callee_frame), base});
+            }
+            enter();
+            VM_DISPATCH();
+        }
+        CallFunction(base);
+        VM_DISPATCH();
+    }
+    VM_CASE(TAIL_CALL) {
+        if (--fuel_ < 0) {
+            calls_.back().pc = pc;
+            return nullptr;
+        }
+        size_t argc = code[pc++].b;
+        size_t base = stack_.size() - argc - 1;
+        if (auto* closure = As<BytecodeClosure>(stack_[base])) {
+            {
+                auto callee_frame = MakeFrame(*closure, argc);
+                auto callee = closure->GetPrototype();
+                auto& record = calls_.back();
+                stack_.resize(record.stack_base);
+                record.prototype = std::move(callee);
+                record.frame = std::move(callee_frame);
+                record.pc = 0;
+            }
+            enter();
+            VM_DISPATCH();
+        }
+        CallFunction(base);
+        // builtin в хвостовой позиции: дальше сразу RETURN
+        VM_DISPATCH();
+    }
+    VM_CASE(RETURN) {
+        {
+            auto result = std::move(stack_.back());
+            stack_.resize(calls_.back().stack_base);
+            calls_.pop_back();
+            if (calls_.size() == entry_depth) {
+                return result;
+            }
+            stack_.push_back(std::move(result));
+        }
+        enter();
+        VM_DISPATCH();
+    }
+    VM_CASE(FAIL) {
+        throw RuntimeError(prototype->constants[code[pc].b]->ToString());
+    }
+
+    // быстрый путь для маленьких чисел встроен в AddNumbers и остальные
+    VM_INLINE_ARITHMETIC(ADD, AddNumbers(*lhs, *rhs))
+    VM_INLINE_ARITHMETIC(SUBTRACT, SubtractNumbers(*lhs, *rhs))
+    VM_INLINE_ARITHMETIC(MULTIPLY, MultiplyNumbers(*lhs, *rhs))
+    VM_INLINE_ARITHMETIC(LESS, Bool::Make(CompareNumbers(*lhs, *rhs) < 0))
+    VM_INLINE_ARITHMETIC(GREATER, Bool::Make(CompareNumbers(*lhs, *rhs) > 0))
+    VM_INLINE_ARITHMETIC(EQUALS, Bool::Make(CompareNumbers(*lhs, *rhs) == 0))
+    VM_INLINE_ARITHMETIC(LEQUALS, Bool::Make(CompareNumbers(*lhs, *rhs) <= 0))
+    VM_INLINE_ARITHMETIC(GEQUALS, Bool::Make(CompareNumbers(*lhs, *rhs) >= 0))
+
+    VM_END()
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "collector.h"
+#include "object.h"
+
+enum class Opcode : uint8_t {
+    CONST,              // push constants[b]
+    LOAD_LOCAL,         // push frame(a).slots[b]
+    STORE_LOCAL,        // pop -> frame(a).slots[b], имя должно быть определено
+    DEFINE_LOCAL,       // pop -> frame(0).slots[b]
+    LOAD_GLOBAL,        // push globals[b]
+    STORE_GLOBAL,       // pop -> globals[b], имя должно быть определено
+    DEFINE_GLOBAL,      // pop -> globals[b]
+    POP,                // выбросить вершину стека
+    JUMP,               // pc = b
+    JUMP_IF_FALSE,      // pop, если #f - pc = b
+    JUMP_IF_FALSE_KEEP, // если на вершине #f - pc = b, иначе pop (для and)
+    JUMP_IF_TRUE_KEEP,  // если на вершине не #f - pc = b, иначе pop (для or)
+    MAKE_CLOSURE,       // push closure(prototypes[b], текущий frame)
+    CALL,               // вызов функции с b аргументами
+    TAIL_CALL,          // то же, но текущий frame переиспользуется
+    RETURN,
+    FAIL,               // RuntimeError с текстом constants[b]
+    // встроенная арифметика, guards[b] проверяет, что имя всё ещё указывает на builtin
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    LESS,
+    GREATER,
+    EQUALS,
+    LEQUALS,
+    GEQUALS,
+};
+
+struct Instruction {
+    Opcode opcode;
+    uint16_t a = 0;
+    uint32_t b = 0;
+};
+
+struct InlineGuard {
+    Binding* binding;
+    Object* builtin;
+};
+
+/// Скомпилированное тело lambda (или одной формы верхнего уровня)
+struct Prototype {
+    std::vector<Instruction> code;
+    std::vector<std::shared_ptr<Object>> constants;
+    std::vector<Binding*> globals;
+    std::vector<InlineGuard> guards;
+    std::vector<std::shared_ptr<Prototype>> prototypes;
+    size_t parameter_count = 0;
+    size_t frame_size = 0;
+    /// сюда регистрируются кадры и замыкания этого прототипа
+    CycleCollector* collector = nullptr;
+    /// окружение, которому принадлежат globals
+    Scope* global_scope = nullptr;
+};
+
+class BytecodeClosure : public Function {
+public:
+    static constexpr ObjectType kType = ObjectType::BYTECODE_CLOSURE;
+
+    BytecodeClosure(std::shared_ptr<Prototype> prototype, std::shared_ptr<Frame> frame)
+        : Function(kType), prototype_(std::move(prototype)), frame_(std::move(frame)){};
+
+    std::shared_ptr<Object> Apply(Arguments arg_vector) override;
+
+    const std::shared_ptr<Prototype>& GetPrototype() const {
+        return prototype_;
+    }
+    const std::shared_ptr<Frame>& GetFrame() const {
+        return frame_;
+    }
+    Frame* GetCapturedFrame() const override {
+        return frame_.get();
+    }
+    Scope* GetGlobalScope() const override {
+        return prototype_->global_scope;
+    }
+    CycleCollector* GetCollector() const override {
+        return prototype_->collector;
+    }
+
+protected:
+    std::shared_ptr<Prototype> prototype_;
+    std::shared_ptr<Frame> frame_;
+};
+
+class Compiler {
+public:
+    Compiler(Scope* global_scope, CycleCollector* collector)
+        : global_scope_(global_scope), collector_(collector){};
+
+    std::shared_ptr<Prototype> Compile(const std::shared_ptr<Object>& form);
+
+protected:
+    using FormArguments = std::vector<std::shared_ptr<Object>>;
+
+    void CompileForm(const std::shared_ptr<Object>& form, bool tail);
+    void CompileSymbol(uint32_t name);
+    void CompileCell(const Cell* form, bool tail);
+    void CompileCall(const std::shared_ptr<Object>& head, const FormArguments& args, bool tail);
+
+    void CompileQuote(const FormArguments& args, bool tail);
+    void CompileIf(const FormArguments& args, bool tail);
+    void CompileCond(const FormArguments& args, bool tail);
+    void CompileDefine(const FormArguments& args, bool tail);
+    void CompileSet(const FormArguments& args, bool tail);
+    void CompileLambda(const FormArguments& args, bool tail);
+    void CompileBegin(const FormArguments& args, bool tail);
+    void CompileAnd(const FormArguments& args, bool tail);
+    void CompileOr(const FormArguments& args, bool tail);
+    void CompileFuture(const FormArguments& args, bool tail);
+
+    void CompileLambdaBody(const std::shared_ptr<Object>& parameters, const FormArguments& body,
+                           size_t body_start);
+    void CompileSequence(const FormArguments& forms, size_t start, bool tail);
+    void CompileShortCircuit(const FormArguments& args, Opcode jump, bool empty_value, bool tail);
+
+    size_t Emit(Opcode opcode, uint32_t b = 0, uint16_t a = 0);
+    void PatchJump(size_t position);
+    uint32_t AddConstant(std::shared_ptr<Object> value);
+    uint32_t AddGlobal(uint32_t name);
+    /// глубина и слот локального имени; false, если имя глобальное
+    bool ResolveLocal(uint32_t name, uint16_t* depth, uint32_t* slot) const;
+    bool IsLocal(uint32_t name) const;
+    uint32_t DeclareLocal(uint32_t name);
+
+protected:
+    Scope* global_scope_;
+    CycleCollector* collector_;
+    Prototype* prototype_ = nullptr;
+    /// имена слотов для каждой объемлющей lambda, последняя - самая внутренняя
+    std::vector<std::vector<uint32_t>> scopes_;
+};
+
+class VirtualMachine {
+public:
+    std::shared_ptr<Object> Execute(const std::shared_ptr<Prototype>& prototype,
+                                    std::shared_ptr<Frame> frame);
+
+    /// Исполнение по частям. Start только кладёт код на пустой стек вызовов, Resume
+    /// исполняет его, пока не кончится fuel: каждый вызов процедуры стоит единицу. Тогда VM
+    /// останавливается перед этим вызовом, и следующий Resume начинает с него. Процедуры,
+    /// которые вызывают builtin-ы (par-map, touch), исполняются в другой VM целиком.
+    void Start(const std::shared_ptr<Prototype>& prototype);
+    /// true и результат в *result, если код исполнен; после исключения VM пуста
+    bool Resume(uint64_t fuel, std::shared_ptr<Object>* result);
+    /// выбрасывает недоисполненный код
+    void Clear();
+
+protected:
+    /// запись держит прототип, чтобы он пережил замыкание, которое уже могли переопределить
+    struct CallRecord {
+        std::shared_ptr<Prototype> prototype;
+        size_t pc;
+        std::shared_ptr<Frame> frame;
+        size_t stack_base;
+    };
+
+    std::shared_ptr<Object> Run(size_t entry_depth);
+    std::shared_ptr<Frame> MakeFrame(const BytecodeClosure& closure, size_t argc);
+    void CallInlineFallback(const InlineGuard& guard);
+    /// вызов функции, которая не BytecodeClosure: stack_[base] и аргументы над ней
+    void CallFunction(size_t base);
+
+protected:
+    std::vector<std::shared_ptr<Object>> stack_;
+    std::vector<CallRecord> calls_;
+    /// вне Resume топлива столько, что оно не кончится
+    int64_t fuel_ = std::numeric_limits<int64_t>::max();
+};
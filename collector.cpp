@@ -0,0 +1,201 @@
+#include "collector.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+/// живые объекты из списка; протухшие weak_ptr заодно выкидываются
+template <class T>
+static std::vector<std::shared_ptr<T>> LockAlive(std::vector<std::weak_ptr<T>>* tracked) {
+    std::vector<std::shared_ptr<T>> alive;
+    size_t kept = 0;
+    for (size_t i = 0; i < tracked->size(); ++i) {
+        if (auto strong = (*tracked)[i].lock()) {
+            alive.push_back(std::move(strong));
+            // самоприсваивание перемещением опустошило бы weak_ptr
+            if (kept != i) {
+                (*tracked)[kept] = std::move((*tracked)[i]);
+            }
+            ++kept;
+        }
+    }
+    tracked->resize(kept);
+    return alive;
+}
+
+static thread_local TrackBuffer* deferred = nullptr;
+
+static void CompactBuffer(TrackBuffer* buffer) {
+    auto expired = [](const auto& entry) { return entry.second.expired(); };
+    std::erase_if(buffer->frames, expired);
+    std::erase_if(buffer->closures, expired);
+    buffer->compact_at =
+        std::max<size_t>(1024, 2 * (buffer->frames.size() + buffer->closures.size()));
+}
+
+CycleCollector::DeferTracking::DeferTracking(TrackBuffer* buffer) : previous_(deferred) {
+    deferred = buffer;
+}
+
+CycleCollector::DeferTracking::~DeferTracking() {
+    deferred = previous_;
+}
+
+void CycleCollector::Flush(TrackBuffer* buffer) {
+    for (auto& [collector, frame] : buffer->frames) {
+        if (auto strong = frame.lock()) {
+            collector->Track(strong);
+        }
+    }
+    for (auto& [collector, closure] : buffer->closures) {
+        if (auto strong = closure.lock()) {
+            collector->Track(strong);
+        }
+    }
+    buffer->frames.clear();
+    buffer->closures.clear();
+}
+
+void TrackInbox::Post(TrackBuffer buffer) {
+    std::lock_guard lock{mutex_};
+    buffers_.push_back(std::move(buffer));
+}
+
+std::vector<TrackBuffer> TrackInbox::TakeAll() {
+    std::lock_guard lock{mutex_};
+    return std::exchange(buffers_, {});
+}
+
+void CycleCollector::TakePosted() {
+    for (auto& buffer : inbox_->TakeAll()) {
+        for (auto& [collector, frame] : buffer.frames) {
+            if (collector == this) {
+                frames_.push_back(std::move(frame));
+            }
+        }
+        for (auto& [collector, closure] : buffer.closures) {
+            if (collector == this) {
+                closures_.push_back(std::move(closure));
+            }
+        }
+    }
+}
+
+void CycleCollector::Track(const std::shared_ptr<Frame>& frame) {
+    if (deferred != nullptr) {
+        deferred->frames.emplace_back(this, frame);
+        if (deferred->frames.size() + deferred->closures.size() >= deferred->compact_at) {
+            CompactBuffer(deferred);
+        }
+        return;
+    }
+    frames_.push_back(frame);
+    MaybeCollect();
+}
+
+void CycleCollector::Track(const std::shared_ptr<Function>& closure) {
+    if (deferred != nullptr) {
+        deferred->closures.emplace_back(this, closure);
+        if (deferred->frames.size() + deferred->closures.size() >= deferred->compact_at) {
+            CompactBuffer(deferred);
+        }
+        return;
+    }
+    closures_.push_back(closure);
+    MaybeCollect();
+}
+
+void CycleCollector::MaybeCollect() {
+    if (++tracked_since_collect_ >= threshold_) {
+        Collect();
+    }
+}
+
+size_t CycleCollector::Collect() {
+    TakePosted();
+    // пока эти векторы живы, use_count каждого объекта больше на единицу
+    auto frames = LockAlive(&frames_);
+    auto closures = LockAlive(&closures_);
+    size_t node_count = frames.size() + closures.size();
+
+    // узлы графа: сначала кадры, потом замыкания
+    std::unordered_map<const void*, size_t> index;
+    index.reserve(node_count);
+    std::vector<long> external(node_count);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        index.emplace(frames[i].get(), i);
+        external[i] = frames[i].use_count() - 1;
+    }
+    for (size_t i = 0; i < closures.size(); ++i) {
+        const Object* closure = closures[i].get();
+        index.emplace(closure, frames.size() + i);
+        external[frames.size() + i] = closures[i].use_count() - 1;
+    }
+
+    auto for_each_edge = [&](size_t node, auto&& visit) {
+        auto visit_pointer = [&](const void* target) {
+            if (target == nullptr) {
+                return;
+            }
+            if (auto it = index.find(target); it != index.end()) {
+                visit(it->second);
+            }
+        };
+        if (node < frames.size()) {
+            const Frame& frame = *frames[node];
+            visit_pointer(frame.parent.get());
+            for (const auto& binding : frame.slots) {
+                visit_pointer(static_cast<const Object*>(binding.value.get()));
+            }
+        } else {
+            visit_pointer(closures[node - frames.size()]->GetCapturedFrame());
+        }
+    };
+
+    for (size_t node = 0; node < node_count; ++node) {
+        for_each_edge(node, [&](size_t target) { --external[target]; });
+    }
+
+    std::vector<bool> reachable(node_count, false);
+    std::vector<size_t> pending;
+    for (size_t node = 0; node < node_count; ++node) {
+        if (external[node] > 0) {
+            reachable[node] = true;
+            pending.push_back(node);
+        }
+    }
+    while (!pending.empty()) {
+        size_t node = pending.back();
+        pending.pop_back();
+        for_each_edge(node, [&](size_t target) {
+            if (!reachable[target]) {
+                reachable[target] = true;
+                pending.push_back(target);
+            }
+        });
+    }
+
+    size_t survivors = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (reachable[i]) {
+            ++survivors;
+        } else {
+            frames[i]->slots.clear();
+            frames[i]->parent.reset();
+        }
+    }
+
+    tracked_since_collect_ = 0;
+    threshold_ = std::max(kMinThreshold, node_count);
+    return survivors;
+}
+
+void CycleCollector::ReleaseAll() {
+    TakePosted();
+    for (const auto& frame : LockAlive(&frames_)) {
+        frame->slots.clear();
+        frame->parent.reset();
+    }
+    frames_.clear();
+    closures_.clear();
+    tracked_since_collect_ = 0;
+}
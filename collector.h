@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "object.h"
+
+/// Сборщик циклов поверх shared_ptr. Замыкание держит свой кадр, а кадр может держать
+/// замыкание (внутренний define функции, set! на lambda), и такой цикл счётчик ссылок
+/// никогда не освободит.
+///
+/// Сборщик помнит все кадры и замыкания через weak_ptr. Из use_count каждого вычитаются
+/// ссылки, которые идут от других отслеживаемых объектов; у кого что-то осталось, на того
+/// ссылается кто-то снаружи (глобальное окружение, стек VM, переменная C++). Всё, что от них
+/// не достижимо, - мусор: у таких кадров очищаются слоты, циклы рвутся, дальше память
+/// освобождают сами shared_ptr. Поэтому собирать можно в любой момент исполнения.
+///
+/// Collect может идти, пока считаются future этого же интерпретатора. Кадры, которые future
+/// создала, попадают к сборщику только через TrackInbox, когда она досчитана, а чужие кадры
+/// она лишь читает. Всё, до чего она дотягивается, держат её thunk и снимок глобальных имён,
+/// так что мусором эти кадры не станут и слоты у них сборщик не очистит.
+class CycleCollector;
+
+/// Кадры и замыкания, которые поток создал за время CycleCollector::DeferTracking.
+/// weak_ptr держит память объекта из make_shared, поэтому умершие время от времени
+/// выкидываются, как в самом сборщике.
+struct TrackBuffer {
+    std::vector<std::pair<CycleCollector*, std::weak_ptr<Frame>>> frames;
+    std::vector<std::pair<CycleCollector*, std::weak_ptr<Function>>> closures;
+    size_t compact_at = 1024;
+};
+
+/// Буферы задач, которые закончились в других потоках и которых, может быть, никто не
+/// дождётся (future без touch). Задача держит ящик через shared_ptr, так что может
+/// положить в него буфер, даже если сборщик уже разрушен.
+class TrackInbox {
+public:
+    void Post(TrackBuffer buffer);
+    std::vector<TrackBuffer> TakeAll();
+
+protected:
+    std::mutex mutex_;
+    std::vector<TrackBuffer> buffers_;
+};
+
+class CycleCollector {
+public:
+    CycleCollector() = default;
+    CycleCollector(const CycleCollector&) = delete;
+    CycleCollector& operator=(const CycleCollector&) = delete;
+
+    /// Сборщик принадлежит потоку своего Interpreter. Пока объект жив, Track любого
+    /// сборщика в этом потоке только дописывает в buffer и сборку не запускает; потом
+    /// владелец, когда параллельная работа закончилась, отдаёт buffer в Flush.
+    class DeferTracking {
+    public:
+        explicit DeferTracking(TrackBuffer* buffer);
+        DeferTracking(const DeferTracking&) = delete;
+        DeferTracking& operator=(const DeferTracking&) = delete;
+        ~DeferTracking();
+
+    private:
+        TrackBuffer* previous_;
+    };
+    /// регистрирует отложенное так, как если бы Track позвали сейчас в этом потоке
+    static void Flush(TrackBuffer* buffer);
+    /// Ящик, в который можно положить буфер из любого потока; сборщик разбирает его в
+    /// начале Collect и ReleaseAll. Объекты чужих сборщиков из буфера выбрасываются: значения
+    /// между Interpreter-ами не ходят.
+    const std::shared_ptr<TrackInbox>& GetInbox() const {
+        return inbox_;
+    }
+
+    void Track(const std::shared_ptr<Frame>& frame);
+    void Track(const std::shared_ptr<Function>& closure);
+
+    /// возвращает число кадров, оставшихся живыми
+    size_t Collect();
+    /// рвёт все кадры разом; только когда больше ничего не исполняется
+    void ReleaseAll();
+
+protected:
+    void MaybeCollect();
+    /// переносит в frames_ и closures_ всё, что лежит в inbox_
+    void TakePosted();
+
+protected:
+    static constexpr size_t kMinThreshold = 1024;
+
+    std::vector<std::weak_ptr<Frame>> frames_;
+    std::vector<std::weak_ptr<Function>> closures_;
+    size_t tracked_since_collect_ = 0;
+    size_t threshold_ = kMinThreshold;
+    std::shared_ptr<TrackInbox> inbox_ = std::make_shared<TrackInbox>();
+};
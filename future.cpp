@@ -0,0 +1,60 @@
+#include "future.h"
+
+#include "scheduler.h"
+
+std::shared_ptr<Future> Future::Spawn(std::shared_ptr<Function> thunk) {
+    auto globals = SnapshotGlobalsFor(*thunk);
+    CycleCollector* collector = thunk->GetCollector();
+    auto inbox = collector != nullptr ? collector->GetInbox() : nullptr;
+    auto future =
+        std::make_shared<Future>(std::move(thunk), std::move(globals), std::move(inbox));
+    // задача держит future: он должен дожить до её конца, даже если его уже выбросили
+    WorkStealingPool::Global().Submit([future] { future->TryRun(); });
+    return future;
+}
+
+bool Future::TryRun() {
+    uint32_t expected = PENDING;
+    if (!state_.compare_exchange_strong(expected, RUNNING, std::memory_order_acquire)) {
+        return false;
+    }
+    TrackBuffer tracked;
+    {
+        WorkStealingPool::TaskScope task;
+        EnterTask enter_task(&globals_);
+        CycleCollector::DeferTracking defer(&tracked);
+        try {
+            result_ = thunk_->Apply({});
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+    }
+    // touch может и не случиться: сборщик разберёт ящик сам при следующем Collect
+    if (inbox_ != nullptr) {
+        inbox_->Post(std::move(tracked));
+        inbox_ = nullptr;
+    }
+    // без thunk future не держит кадр, в котором его, возможно, сохранили
+    thunk_ = nullptr;
+    globals_ = GlobalValues{};
+    state_.store(DONE, std::memory_order_release);
+    state_.notify_all();
+    return true;
+}
+
+std::shared_ptr<Object> Future::Touch() {
+    if (!TryRun()) {
+        auto& pool = WorkStealingPool::Global();
+        for (uint32_t state = state_.load(std::memory_order_acquire); state != DONE;
+             state = state_.load(std::memory_order_acquire)) {
+            // пока задачу считает другой поток, помогаем пулу с остальными
+            if (!pool.RunPending()) {
+                state_.wait(state, std::memory_order_acquire);
+            }
+        }
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    return result_;
+}
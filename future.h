@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+
+#include "collector.h"
+#include "object.h"
+
+/// Результат (future expr): expr считается задачей WorkStealingPool::Global, а touch
+/// ждёт результата. Если ни один воркер ещё не взял задачу, touch считает её сам, так
+/// что fork-join не повиснет, даже когда все воркеры ждут в touch.
+///
+/// Тело future исполняется как параллельная задача: глобальные имена только читает, причём
+/// из снимка на момент (future expr), а кадры и пары, созданные не им, не меняет (см.
+/// current_task). Свои кадры и замыкания тело копит в TrackBuffer. Когда тело досчитано,
+/// буфер уходит в TrackInbox сборщика, так что циклы future, которую никто не тронул, тоже
+/// собираются.
+class Future : public Object {
+public:
+    static constexpr ObjectType kType = ObjectType::FUTURE;
+
+    Future(std::shared_ptr<Function> thunk, GlobalValues globals,
+           std::shared_ptr<TrackInbox> inbox)
+        : Object(kType),
+          thunk_(std::move(thunk)),
+          globals_(std::move(globals)),
+          inbox_(std::move(inbox)){};
+
+    /// future для вызова thunk без аргументов, уже поставленный в пул
+    static std::shared_ptr<Future> Spawn(std::shared_ptr<Function> thunk);
+
+    /// результат thunk или его исключение
+    std::shared_ptr<Object> Touch();
+
+    std::string ToString() override {
+        return "#<future>";
+    }
+
+protected:
+    enum State : uint32_t { PENDING, RUNNING, DONE };
+
+    /// false, если задачу уже взял кто-то другой
+    bool TryRun();
+
+protected:
+    std::atomic<uint32_t> state_ = PENDING;
+    /// пишутся тем, кто исполнил thunk, до перехода в DONE
+    std::shared_ptr<Function> thunk_;
+    GlobalValues globals_;
+    std::shared_ptr<Object> result_;
+    std::exception_ptr error_;
+    /// куда отдать кадры и замыкания thunk; у builtin-а сборщика нет
+    std::shared_ptr<TrackInbox> inbox_;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/// Неизменяемое отображение uint64_t -> T: префиксное дерево по 5 бит хеша ключа на уровень
+/// (HAMT). Узел хранит только занятые ветви, какие именно - говорит bitmap. Set копирует
+/// путь от корня до нужного листа, всё остальное новая версия делит со старой, так что
+/// копия отображения - это один shared_ptr, а старые версии никогда не меняются и читать
+/// их можно из любых потоков без блокировок. Единственный писатель может вместо Set звать
+/// SetInPlace и не копировать узлы, которые ещё не попали ни в одну отданную копию.
+template <class T>
+class PersistentMap {
+public:
+    /// значение для key или nullptr
+    const T* Find(uint64_t key) const {
+        uint64_t hash = Hash(key);
+        for (const Node* node = root_.get(); node != nullptr; hash >>= kBits) {
+            uint32_t bit = 1u << (hash & kMask);
+            if ((node->bitmap & bit) == 0) {
+                return nullptr;
+            }
+            const Entry& entry = node->entries[std::popcount(node->bitmap & (bit - 1))];
+            if (entry.child == nullptr) {
+                return entry.key == key ? &entry.value : nullptr;
+            }
+            node = entry.child.get();
+        }
+        return nullptr;
+    }
+
+    /// новая версия, в которой key соответствует value; эта не меняется
+    PersistentMap Set(uint64_t key, T value) const {
+        PersistentMap result;
+        result.root_ = Insert(root_, key, std::move(value), 0, 0, &result.size_);
+        result.size_ += size_;
+        return result;
+    }
+
+    /// То же, что *this = Set(key, value), но узлы, помеченные правкой edit, меняются на
+    /// месте, а скопированные получают эту пометку. Вызывающий обещает, что копий этой
+    /// версии с такими узлами ни у кого нет: отдав копию, он переходит к новой правке.
+    /// edit == 0 - правки нет, копируется весь путь.
+    void SetInPlace(uint64_t key, T value, uint64_t edit) {
+        size_t added = 0;
+        root_ = Insert(std::move(root_), key, std::move(value), 0, edit, &added);
+        size_ += added;
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+protected:
+    static constexpr uint32_t kBits = 5;
+    static constexpr uint64_t kMask = (1u << kBits) - 1;
+
+    struct Node;
+
+    /// лист, если child пуст, иначе ветвь дальше
+    struct Entry {
+        uint64_t key = 0;
+        T value{};
+        std::shared_ptr<Node> child;
+    };
+
+    struct Node {
+        uint32_t bitmap = 0;
+        /// правка, которая создала узел и может его менять; 0 - узел уже неизменяем
+        uint64_t edit = 0;
+        std::vector<Entry> entries;
+    };
+
+    /// Умножение на нечётное число обратимо, поэтому разные ключи дают разные хеши и
+    /// коллизий, которые пришлось бы хранить списком, не бывает. Старшие биты произведения
+    /// зависят от всех битов ключа, их и берём на верхние уровни.
+    static uint64_t Hash(uint64_t key) {
+        uint64_t hash = key * 0x9e3779b97f4a7c15ull;
+        return (hash >> 32) | (hash << 32);
+    }
+
+    /// node с key -> value; shift - сколько бит хеша ушло на уровни выше node
+    static std::shared_ptr<Node> Insert(std::shared_ptr<Node> node, uint64_t key, T value,
+                                        uint32_t shift, uint64_t edit, size_t* added) {
+        auto copy = std::move(node);
+        if (copy == nullptr || edit == 0 || copy->edit != edit) {
+            copy = copy != nullptr ? std::make_shared<Node>(*copy) : std::make_shared<Node>();
+            copy->edit = edit;
+        }
+        uint32_t bit = 1u << ((Hash(key) >> shift) & kMask);
+        size_t index = std::popcount(copy->bitmap & (bit - 1));
+        if ((copy->bitmap & bit) == 0) {
+            copy->bitmap |= bit;
+            copy->entries.insert(copy->entries.begin() + index,
+                                 Entry{key, std::move(value), nullptr});
+            *added = 1;
+            return copy;
+        }
+        Entry& entry = copy->entries[index];
+        if (entry.child != nullptr) {
+            entry.child =
+                Insert(std::move(entry.child), key, std::move(value), shift + kBits, edit, added);
+        } else if (entry.key == key) {
+            entry.value = std::move(value);
+        } else {
+            // два ключа на одной ветви: оба уходят на уровень ниже, где хеши разойдутся
+            size_t moved = 0;
+            auto child =
+                Insert(nullptr, entry.key, std::move(entry.value), shift + kBits, edit, &moved);
+            entry.child =
+                Insert(std::move(child), key, std::move(value), shift + kBits, edit, added);
+            entry.value = T{};
+        }
+        return copy;
+    }
+
+protected:
+    std::shared_ptr<Node> root_;
+    size_t size_ = 0;
+};
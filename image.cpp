@@ -0,0 +1,699 @@
+#include "image.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bytecode.h"
+#include "serialize.h"
+
+namespace {
+
+constexpr std::string_view kMagic = "SCMI";
+constexpr uint8_t kVersion = 1;
+
+enum class ObjectTag : uint8_t {
+    TRUE,
+    FALSE,
+    NUMBER,
+    SYMBOL,
+    CELL,
+    BUILTIN,
+    CLOSURE,
+    BYTECODE_CLOSURE,
+    BIG_NUMBER
+};
+
+/// Номера в одной из таблиц образа, в порядке первой встречи. Очередь ещё не записанных
+/// элементов - хвост items, так что обход идёт без рекурсии.
+template <class T, class Item = T*>
+class Numbering {
+public:
+    /// номер вместе с признаком, что элемент встретился впервые
+    std::pair<uint64_t, bool> Add(const T* key, const Item& item) {
+        auto [it, inserted] = ids_.emplace(key, items_.size());
+        if (inserted) {
+            items_.push_back(item);
+        }
+        return {it->second, inserted};
+    }
+    std::pair<uint64_t, bool> Add(T* item) {
+        return Add(item, item);
+    }
+
+    bool HasPending() const {
+        return next_ < items_.size();
+    }
+    const Item& TakePending() {
+        return items_[next_++];
+    }
+    size_t GetSize() const {
+        return items_.size();
+    }
+
+protected:
+    std::unordered_map<const T*, uint64_t> ids_;
+    std::vector<Item> items_;
+    size_t next_ = 0;
+};
+
+class HeapWriter {
+public:
+    explicit HeapWriter(const Scope& global_scope) {
+        for (const auto& [name, binding] : global_scope.GetBindings()) {
+            binding_names_.emplace(&binding, name);
+        }
+        for (const auto& [name, function] : name_to_function) {
+            builtin_names_.emplace(function.get(), Symbol::Intern(name)->GetId());
+        }
+        for (const auto& [name, binding] : global_scope.GetBindings()) {
+            if (binding.is_defined) {
+                ++global_count_;
+                WriteVarint(&globals_, symbols_.Index(name));
+                WriteObjectRef(&globals_, binding.value);
+            }
+        }
+    }
+
+    std::string Write() {
+        // каждая таблица пишется в порядке номеров, поэтому неважно, что обход перемешивает их
+        while (objects_.HasPending() || frames_.HasPending() || lambdas_.HasPending() ||
+               prototypes_.HasPending()) {
+            while (objects_.HasPending()) {
+                if (auto cell = As<Cell>(objects_.TakePending())) {
+                    WriteObjectRef(&cells_, cell->GetFirst());
+                    WriteObjectRef(&cells_, cell->GetSecond());
+                }
+            }
+            while (frames_.HasPending()) {
+                WriteFrame(frames_.TakePending());
+            }
+            while (lambdas_.HasPending()) {
+                WriteLambda(lambdas_.TakePending());
+            }
+            while (prototypes_.HasPending()) {
+                WritePrototype(prototypes_.TakePending());
+            }
+        }
+
+        std::string out(kMagic);
+        out.push_back(static_cast<char>(kVersion));
+        symbols_.Write(&out);
+        WriteVarint(&out, frames_.GetSize());
+        out += frame_sizes_;
+        WriteVarint(&out, lambdas_.GetSize());
+        WriteVarint(&out, prototypes_.GetSize());
+        WriteVarint(&out, objects_.GetSize());
+        out += shells_;
+        out += cells_;
+        out += frame_links_;
+        out += prototype_bodies_;
+        out += lambda_sources_;
+        WriteVarint(&out, global_count_);
+        out += globals_;
+        return out;
+    }
+
+protected:
+    void WriteObjectRef(std::string* out, const std::shared_ptr<Object>& object) {
+        if (object == nullptr) {
+            out->push_back(0);
+            return;
+        }
+        auto [id, inserted] = objects_.Add(object.get(), object);
+        WriteVarint(out, id + 1);
+        if (inserted) {
+            WriteShell(object);
+        }
+    }
+
+    void WriteFrameRef(std::string* out, Frame* frame) {
+        if (frame == nullptr) {
+            out->push_back(0);
+            return;
+        }
+        auto [id, inserted] = frames_.Add(frame);
+        WriteVarint(out, id + 1);
+        if (inserted) {
+            WriteVarint(&frame_sizes_, frame->slots.size());
+        }
+    }
+
+    void WriteShell(const std::shared_ptr<Object>& object) {
+        auto write_tag = [this](ObjectTag tag) { shells_.push_back(static_cast<char>(tag)); };
+        if (auto boolean = As<Bool>(object)) {
+            write_tag(boolean->GetBoolValue() ? ObjectTag::TRUE : ObjectTag::FALSE);
+        } else if (auto number = As<Number>(object); number != nullptr && number->IsSmall()) {
+            write_tag(ObjectTag::NUMBER);
+            WriteSignedVarint(&shells_, number->GetValue());
+        } else if (number != nullptr) {
+            BigInteger storage;
+            write_tag(ObjectTag::BIG_NUMBER);
+            WriteBigInteger(&shells_, number->GetBigInteger(&storage));
+        } else if (auto symbol = As<Symbol>(object)) {
+            write_tag(ObjectTag::SYMBOL);
+            WriteVarint(&shells_, symbols_.Index(symbol->GetId()));
+        } else if (Is<Cell>(object)) {
+            write_tag(ObjectTag::CELL);
+        } else if (auto closure = As<Closure>(object)) {
+            write_tag(ObjectTag::CLOSURE);
+            WriteVarint(&shells_, lambdas_.Add(closure->GetLambda().get()).first);
+            WriteFrameRef(&shells_, closure->GetFrame().get());
+        } else if (auto closure = As<BytecodeClosure>(object)) {
+            write_tag(ObjectTag::BYTECODE_CLOSURE);
+            WriteVarint(&shells_, prototypes_.Add(closure->GetPrototype().get()).first);
+            WriteFrameRef(&shells_, closure->GetFrame().get());
+        } else {
+            write_tag(ObjectTag::BUILTIN);
+            WriteVarint(&shells_, symbols_.Index(GetBuiltinName(object.get())));
+        }
+    }
+
+    void WriteFrame(Frame* frame) {
+        WriteFrameRef(&frame_links_, frame->parent.get());
+        for (const auto& slot : frame->slots) {
+            frame_links_.push_back(slot.is_defined ? 1 : 0);
+            WriteObjectRef(&frame_links_, slot.value);
+        }
+    }
+
+    void WriteLambda(LambdaInfo* lambda) {
+        auto* out = &lambda_sources_;
+        WriteObjectRef(out, lambda->parameters);
+        WriteVarint(out, lambda->source.size());
+        for (const auto& form : lambda->source) {
+            WriteObjectRef(out, form);
+        }
+        WriteVarint(out, lambda->enclosing_scopes.size());
+        for (const auto& names : lambda->enclosing_scopes) {
+            WriteVarint(out, names.size());
+            for (uint32_t name : names) {
+                WriteVarint(out, symbols_.Index(name));
+            }
+        }
+    }
+
+    void WritePrototype(Prototype* prototype) {
+        auto* out = &prototype_bodies_;
+        WriteVarint(out, prototype->parameter_count);
+        WriteVarint(out, prototype->frame_size);
+        WriteVarint(out, prototype->code.size());
+        for (const auto& instruction : prototype->code) {
+            out->push_back(static_cast<char>(instruction.opcode));
+            WriteVarint(out, instruction.a);
+            WriteVarint(out, instruction.b);
+        }
+        WriteVarint(out, prototype->constants.size());
+        for (const auto& constant : prototype->constants) {
+            WriteObjectRef(out, constant);
+        }
+        WriteVarint(out, prototype->globals.size());
+        for (Binding* binding : prototype->globals) {
+            WriteVarint(out, symbols_.Index(binding_names_.at(binding)));
+        }
+        WriteVarint(out, prototype->guards.size());
+        for (const auto& guard : prototype->guards) {
+            WriteVarint(out, symbols_.Index(binding_names_.at(guard.binding)));
+            WriteVarint(out, symbols_.Index(GetBuiltinName(guard.builtin)));
+        }
+        WriteVarint(out, prototype->prototypes.size());
+        for (const auto& nested : prototype->prototypes) {
+            WriteVarint(out, prototypes_.Add(nested.get()).first);
+        }
+    }
+
+    uint32_t GetBuiltinName(const Object* builtin) const {
+        auto it = builtin_names_.find(builtin);
+        if (it == builtin_names_.end()) {
+            throw RuntimeError("cannot save this object in an image");
+        }
+        return it->second;
+    }
+
+protected:
+    SymbolIndex symbols_;
+    std::unordered_map<const Binding*, uint32_t> binding_names_;
+    std::unordered_map<const Object*, uint32_t> builtin_names_;
+
+    /// объекты держатся до конца записи, чтобы адрес не достался новому объекту
+    Numbering<Object, std::shared_ptr<Object>> objects_;
+    Numbering<Frame> frames_;
+    Numbering<LambdaInfo> lambdas_;
+    Numbering<Prototype> prototypes_;
+
+    std::string frame_sizes_;
+    std::string shells_;
+    std::string cells_;
+    std::string frame_links_;
+    std::string prototype_bodies_;
+    std::string lambda_sources_;
+    std::string globals_;
+    size_t global_count_ = 0;
+};
+
+class HeapLoader {
+public:
+    HeapLoader(std::string_view image, Scope* global_scope, Analyzer* analyzer,
+               CycleCollector* collector)
+        : reader_(image),
+          global_scope_(global_scope),
+          analyzer_(analyzer),
+          collector_(collector) {
+    }
+
+    HeapLoader(const HeapLoader&) = delete;
+    HeapLoader& operator=(const HeapLoader&) = delete;
+
+    /// если загрузка не дошла до конца, рвёт циклы между тем, что успело создаться
+    ~HeapLoader() {
+        if (done_) {
+            return;
+        }
+        // таблицы заполняются по одному элементу, так что хвост у них может быть пустым
+        for (const auto& frame : frames_) {
+            if (frame != nullptr) {
+                frame->slots.clear();
+                frame->parent.reset();
+            }
+        }
+        for (const auto& object : objects_) {
+            if (auto cell = As<Cell>(object)) {
+                cell->SetFirst(nullptr);
+                cell->SetSecond(nullptr);
+            }
+        }
+    }
+
+    std::vector<std::pair<uint32_t, std::shared_ptr<Object>>> Load() {
+        reader_.ReadHeader(kMagic, kVersion);
+        symbols_ = reader_.ReadSymbolTable();
+
+        frames_.resize(reader_.ReadCount());
+        for (auto& frame : frames_) {
+            // у каждого слота дальше есть хотя бы два байта связей
+            frame = std::make_shared<Frame>(reader_.ReadCount(), nullptr);
+        }
+        lambdas_.resize(reader_.ReadCount());
+        for (auto& lambda : lambdas_) {
+            lambda = std::make_shared<LambdaInfo>();
+        }
+        prototypes_.resize(reader_.ReadCount());
+        for (auto& prototype : prototypes_) {
+            prototype = std::make_shared<Prototype>();
+            prototype->collector = collector_;
+            prototype->global_scope = global_scope_;
+        }
+        objects_.resize(reader_.ReadCount());
+        for (auto& object : objects_) {
+            object = ReadShell();
+        }
+
+        for (const auto& object : objects_) {
+            if (auto cell = As<Cell>(object)) {
+                cell->SetFirst(ReadObjectRef());
+                cell->SetSecond(ReadObjectRef());
+            }
+        }
+        for (const auto& frame : frames_) {
+            frame->parent = ReadFrameRef();
+            for (auto& slot : frame->slots) {
+                slot.is_defined = ReadFlag();
+                slot.value = ReadObjectRef();
+            }
+        }
+        captured_slots_.resize(prototypes_.size());
+        for (size_t i = 0; i < prototypes_.size(); ++i) {
+            ReadPrototype(prototypes_[i].get(), &captured_slots_[i]);
+        }
+        ValidateNesting();
+        // исходники уже связаны, теперь их можно разбирать
+        for (const auto& lambda : lambdas_) {
+            ReadLambda(lambda.get());
+        }
+
+        std::vector<std::pair<uint32_t, std::shared_ptr<Object>>> globals(reader_.ReadCount());
+        for (auto& [name, value] : globals) {
+            name = ReadSymbol();
+            value = ReadObjectRef();
+        }
+        if (!reader_.IsEnd()) {
+            throw SyntaxError("corrupted binary data");
+        }
+
+        for (const auto& frame : frames_) {
+            collector_->Track(frame);
+        }
+        for (const auto& object : objects_) {
+            if (Is<Closure>(object) || Is<BytecodeClosure>(object)) {
+                collector_->Track(std::static_pointer_cast<Function>(object));
+            }
+        }
+        done_ = true;
+        return globals;
+    }
+
+protected:
+    std::shared_ptr<Object> ReadShell() {
+        switch (static_cast<ObjectTag>(reader_.ReadByte())) {
+            case ObjectTag::TRUE:
+                return Bool::Make(true);
+            case ObjectTag::FALSE:
+                return Bool::Make(false);
+            case ObjectTag::NUMBER:
+                return Number::Make(reader_.ReadSignedVarint());
+            case ObjectTag::BIG_NUMBER:
+                return Number::Make(reader_.ReadBigInteger());
+            case ObjectTag::SYMBOL:
+                return Symbol::FromId(ReadSymbol());
+            case ObjectTag::CELL:
+                return Cell::Make(nullptr, nullptr);
+            case ObjectTag::BUILTIN: {
+                auto it = name_to_function.find(Symbol::FromId(ReadSymbol())->GetName());
+                if (it == name_to_function.end()) {
+                    throw SyntaxError("unknown builtin in image");
+                }
+                return it->second;
+            }
+            case ObjectTag::CLOSURE: {
+                const auto& lambda = lambdas_[reader_.ReadIndex(lambdas_.size())];
+                return std::make_shared<Closure>(lambda, ReadFrameRef());
+            }
+            case ObjectTag::BYTECODE_CLOSURE: {
+                const auto& prototype = prototypes_[reader_.ReadIndex(prototypes_.size())];
+                return std::make_shared<BytecodeClosure>(prototype, ReadFrameRef());
+            }
+            default:
+                throw SyntaxError("corrupted binary data");
+        }
+    }
+
+    void ReadPrototype(Prototype* prototype, std::vector<size_t>* captured_slots) {
+        prototype->parameter_count = reader_.ReadVarint();
+        prototype->frame_size = reader_.ReadVarint();
+        prototype->code.resize(reader_.ReadCount());
+        for (auto& instruction : prototype->code) {
+            uint8_t opcode = reader_.ReadByte();
+            if (opcode > static_cast<uint8_t>(Opcode::GEQUALS)) {
+                throw SyntaxError("corrupted binary data");
+            }
+            instruction.opcode = static_cast<Opcode>(opcode);
+            instruction.a = reader_.ReadIndex(UINT16_MAX + 1);
+            instruction.b = reader_.ReadIndex(UINT32_MAX + uint64_t{1});
+        }
+        prototype->constants.resize(reader_.ReadCount());
+        for (auto& constant : prototype->constants) {
+            constant = ReadObjectRef();
+        }
+        prototype->globals.resize(reader_.ReadCount());
+        for (auto& binding : prototype->globals) {
+            binding = global_scope_->GetBinding(ReadSymbol());
+        }
+        prototype->guards.resize(reader_.ReadCount());
+        for (auto& guard : prototype->guards) {
+            guard.binding = global_scope_->GetBinding(ReadSymbol());
+            auto it = name_to_function.find(Symbol::FromId(ReadSymbol())->GetName());
+            if (it == name_to_function.end()) {
+                throw SyntaxError("unknown builtin in image");
+            }
+            guard.builtin = it->second.get();
+        }
+        prototype->prototypes.resize(reader_.ReadCount());
+        for (auto& nested : prototype->prototypes) {
+            nested = prototypes_[reader_.ReadIndex(prototypes_.size())];
+        }
+        ValidateCode(*prototype, captured_slots);
+        ValidateStack(*prototype);
+    }
+
+    /// Номера констант, глобальных имён, переходов и слотов своего кадра; без этого битый
+    /// образ уронил бы VM. Слоты кадров выше проверить можно только по замыканиям, поэтому
+    /// в captured_slots[d - 1] пишется, сколько слотов код читает в кадре на глубине d.
+    static void ValidateCode(const Prototype& prototype, std::vector<size_t>* captured_slots) {
+        if (prototype.parameter_count > prototype.frame_size) {
+            throw SyntaxError("corrupted binary data");
+        }
+        for (const auto& instruction : prototype.code) {
+            size_t limit;
+            switch (instruction.opcode) {
+                case Opcode::LOAD_LOCAL:
+                case Opcode::STORE_LOCAL:
+                    if (instruction.a > 0) {
+                        if (captured_slots->size() < instruction.a) {
+                            captured_slots->resize(instruction.a);
+                        }
+                        auto& slots = (*captured_slots)[instruction.a - 1];
+                        slots = std::max<size_t>(slots, instruction.b + size_t{1});
+                        continue;
+                    }
+                    limit = prototype.frame_size;
+                    break;
+                case Opcode::DEFINE_LOCAL:
+                    limit = prototype.frame_size;
+                    break;
+                case Opcode::CONST:
+                case Opcode::FAIL:
+                    limit = prototype.constants.size();
+                    break;
+                case Opcode::LOAD_GLOBAL:
+                case Opcode::STORE_GLOBAL:
+                case Opcode::DEFINE_GLOBAL:
+                    limit = prototype.globals.size();
+                    break;
+                case Opcode::JUMP:
+                case Opcode::JUMP_IF_FALSE:
+                case Opcode::JUMP_IF_FALSE_KEEP:
+                case Opcode::JUMP_IF_TRUE_KEEP:
+                    limit = prototype.code.size();
+                    break;
+                case Opcode::MAKE_CLOSURE:
+                    limit = prototype.prototypes.size();
+                    break;
+                case Opcode::ADD:
+                case Opcode::SUBTRACT:
+                case Opcode::MULTIPLY:
+                case Opcode::LESS:
+                case Opcode::GREATER:
+                case Opcode::EQUALS:
+                case Opcode::LEQUALS:
+                case Opcode::GEQUALS:
+                    limit = prototype.guards.size();
+                    break;
+                default:
+                    continue;
+            }
+            if (instruction.b >= limit) {
+                throw SyntaxError("corrupted binary data");
+            }
+        }
+    }
+
+    /// Высота стека перед инструкцией одна и та же, каким бы путём до неё ни дошли, её
+    /// хватает каждой инструкции, и выполнение не сходит с конца кода. Иначе VM сняла бы со
+    /// стека больше, чем на него положено.
+    static void ValidateStack(const Prototype& prototype) {
+        const auto& code = prototype.code;
+        if (code.empty()) {
+            throw SyntaxError("corrupted binary data");
+        }
+        std::vector<int64_t> heights(code.size(), -1);
+        std::vector<size_t> pending = {0};
+        heights[0] = 0;
+        auto reach = [&](size_t pc, int64_t height) {
+            if (pc >= code.size() || (heights[pc] != -1 && heights[pc] != height)) {
+                throw SyntaxError("corrupted binary data");
+            }
+            if (heights[pc] == -1) {
+                heights[pc] = height;
+                pending.push_back(pc);
+            }
+        };
+        while (!pending.empty()) {
+            size_t pc = pending.back();
+            pending.pop_back();
+            const auto& instruction = code[pc];
+            int64_t height = heights[pc];
+            auto pop = [&height](int64_t count) {
+                if (height < count) {
+                    throw SyntaxError("corrupted binary data");
+                }
+                height -= count;
+            };
+            switch (instruction.opcode) {
+                case Opcode::CONST:
+                case Opcode::LOAD_LOCAL:
+                case Opcode::LOAD_GLOBAL:
+                case Opcode::MAKE_CLOSURE:
+                    reach(pc + 1, height + 1);
+                    break;
+                case Opcode::STORE_LOCAL:
+                case Opcode::DEFINE_LOCAL:
+                case Opcode::STORE_GLOBAL:
+                case Opcode::DEFINE_GLOBAL:
+                case Opcode::POP:
+                    pop(1);
+                    reach(pc + 1, height);
+                    break;
+                case Opcode::JUMP:
+                    reach(instruction.b, height);
+                    break;
+                case Opcode::JUMP_IF_FALSE:
+                    pop(1);
+                    reach(instruction.b, height);
+                    reach(pc + 1, height);
+                    break;
+                case Opcode::JUMP_IF_FALSE_KEEP:
+                case Opcode::JUMP_IF_TRUE_KEEP:
+                    pop(1);
+                    reach(instruction.b, height + 1);
+                    reach(pc + 1, height);
+                    break;
+                case Opcode::CALL:
+                case Opcode::TAIL_CALL:
+                    // после builtin-а в хвостовой позиции исполнение идёт дальше, к RETURN
+                    pop(instruction.b + int64_t{1});
+                    reach(pc + 1, height + 1);
+                    break;
+                case Opcode::RETURN:
+                    pop(1);
+                    break;
+                case Opcode::FAIL:
+                    break;
+                default:
+                    // встроенная арифметика: два аргумента, один результат
+                    pop(2);
+                    reach(pc + 1, height + 1);
+                    break;
+            }
+        }
+    }
+
+    /// Вложенная lambda читает кадр своего создателя на глубине 1, кадры выше - на глубине
+    /// на единицу больше, чем он сам; каждое замыкание из образа должно держать цепочку
+    /// кадров, где все эти слоты есть. Прототип, который вложен сам в себя, бывает только в
+    /// битом образе.
+    void ValidateNesting() {
+        std::unordered_map<const Prototype*, size_t> index;
+        for (size_t i = 0; i < prototypes_.size(); ++i) {
+            index.emplace(prototypes_[i].get(), i);
+        }
+        enum : uint8_t { NEW, ACTIVE, DONE };
+        std::vector<uint8_t> states(prototypes_.size(), NEW);
+        // обход в глубину без рекурсии: прототип и номер следующего вложенного
+        std::vector<std::pair<size_t, size_t>> path;
+        for (size_t root = 0; root < prototypes_.size(); ++root) {
+            if (states[root] != NEW) {
+                continue;
+            }
+            states[root] = ACTIVE;
+            path.emplace_back(root, 0);
+            while (!path.empty()) {
+                auto& [current, next] = path.back();
+                const Prototype& prototype = *prototypes_[current];
+                if (next < prototype.prototypes.size()) {
+                    size_t nested = index.at(prototype.prototypes[next++].get());
+                    if (states[nested] == ACTIVE) {
+                        throw SyntaxError("corrupted binary data");
+                    }
+                    if (states[nested] == NEW) {
+                        states[nested] = ACTIVE;
+                        path.emplace_back(nested, 0);
+                    }
+                    continue;
+                }
+                auto& slots = captured_slots_[current];
+                for (const auto& nested : prototype.prototypes) {
+                    const auto& nested_slots = captured_slots_[index.at(nested.get())];
+                    if (!nested_slots.empty() && nested_slots[0] > prototype.frame_size) {
+                        throw SyntaxError("corrupted binary data");
+                    }
+                    if (slots.size() + 1 < nested_slots.size()) {
+                        slots.resize(nested_slots.size() - 1);
+                    }
+                    for (size_t depth = 1; depth < nested_slots.size(); ++depth) {
+                        slots[depth - 1] = std::max(slots[depth - 1], nested_slots[depth]);
+                    }
+                }
+                states[current] = DONE;
+                path.pop_back();
+            }
+        }
+
+        for (const auto& object : objects_) {
+            auto closure = As<BytecodeClosure>(object);
+            if (closure == nullptr) {
+                continue;
+            }
+            const Frame* frame = closure->GetFrame().get();
+            for (size_t slots : captured_slots_[index.at(closure->GetPrototype().get())]) {
+                if (frame == nullptr || frame->slots.size() < slots) {
+                    throw SyntaxError("corrupted binary data");
+                }
+                frame = frame->parent.get();
+            }
+        }
+    }
+
+    void ReadLambda(LambdaInfo* lambda) {
+        lambda->parameters = ReadObjectRef();
+        lambda->source.resize(reader_.ReadCount());
+        for (auto& form : lambda->source) {
+            form = ReadObjectRef();
+        }
+        lambda->enclosing_scopes.resize(reader_.ReadCount());
+        for (auto& names : lambda->enclosing_scopes) {
+            names.resize(reader_.ReadCount());
+            for (auto& name : names) {
+                name = ReadSymbol();
+            }
+        }
+        analyzer_->RestoreLambda(lambda);
+    }
+
+    std::shared_ptr<Object> ReadObjectRef() {
+        uint64_t ref = reader_.ReadIndex(objects_.size() + 1);
+        return ref == 0 ? nullptr : objects_[ref - 1];
+    }
+
+    std::shared_ptr<Frame> ReadFrameRef() {
+        uint64_t ref = reader_.ReadIndex(frames_.size() + 1);
+        return ref == 0 ? nullptr : frames_[ref - 1];
+    }
+
+    uint32_t ReadSymbol() {
+        return symbols_[reader_.ReadIndex(symbols_.size())];
+    }
+
+    bool ReadFlag() {
+        return reader_.ReadIndex(2) != 0;
+    }
+
+protected:
+    BinaryReader reader_;
+    Scope* global_scope_;
+    Analyzer* analyzer_;
+    CycleCollector* collector_;
+    std::vector<uint32_t> symbols_;
+    std::vector<std::shared_ptr<Frame>> frames_;
+    std::vector<std::shared_ptr<LambdaInfo>> lambdas_;
+    std::vector<std::shared_ptr<Prototype>> prototypes_;
+    /// для каждого прототипа: сколько слотов нужно в кадрах на глубине 1, 2, ...
+    std::vector<std::vector<size_t>> captured_slots_;
+    std::vector<std::shared_ptr<Object>> objects_;
+    bool done_ = false;
+};
+
+}  // namespace
+
+std::string SaveHeap(const Scope& global_scope) {
+    return HeapWriter(global_scope).Write();
+}
+
+void LoadHeap(std::string_view image, Scope* global_scope, Analyzer* analyzer,
+              CycleCollector* collector) {
+    HeapLoader loader(image, global_scope, analyzer, collector);
+    for (auto& [name, value] : loader.Load()) {
+        global_scope->Define(name, std::move(value));
+    }
+}
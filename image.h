@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "analyzer.h"
+#include "collector.h"
+#include "object.h"
+
+/// Образ кучи: определённые глобальные имена и всё, что от них достижимо, - данные, кадры и
+/// замыкания обоих движков вместе с их кодом. Указателей в образе нет, только номера, так
+/// что файл можно отобразить в память в любом процессе.
+///
+///     "SCMI" версия:u8 таблица символов (как в serialize.h)
+///     кадры: число, размер каждого
+///     число LambdaInfo, число Prototype
+///     объекты: число, у каждого тег и то, что нужно для его создания
+///     связи: car и cdr каждой ячейки, parent и слоты каждого кадра
+///     тела Prototype, исходники LambdaInfo
+///     глобальные имена: число, затем имя и значение
+///
+/// Ссылка - varint, 0 это пустой указатель, n - элемент n-1 своей таблицы. Загрузчик
+/// сначала создаёт всё пустым и только потом связывает, поэтому циклы между кадрами и
+/// замыканиями и списки, изменённые через set-cdr!, восстанавливаются как были.
+///
+/// Байткод записывается целиком. Тело lambda анализатора - дерево Executor-ов с адресами
+/// глобальных binding-ов, его записать нельзя: в образе лежит исходник, и при загрузке
+/// Analyzer разбирает его заново.
+///
+/// Загрузчик проверяет формат и все ссылки на таблицы, а в байткоде - номера констант,
+/// глобальных имён, guard-ов, вложенных прототипов и переходов, слоты своего кадра, высоту
+/// стека на каждом пути и то, что у каждого замыкания есть все кадры и слоты, которые
+/// читает его код; такой битый образ даёт SyntaxError, а не падение VM. На слово
+/// принимаются кадры замыканий анализатора: их цепочка должна соответствовать
+/// LambdaInfo::enclosing_scopes, но это не проверяется.
+std::string SaveHeap(const Scope& global_scope);
+
+/// определяет глобальные имена из образа; если образ битый, global_scope не меняется
+void LoadHeap(std::string_view image, Scope* global_scope, Analyzer* analyzer,
+              CycleCollector* collector);
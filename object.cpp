@@ -0,0 +1,312 @@
+#include "object.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+
+/// Символы только добавляются и никогда не переезжают, поэтому читать их можно без
+/// блокировки. Кусок k хранит kFirstChunk << k символов, size публикуется после записи.
+struct SymbolTable {
+    static constexpr int kFirstChunkBits = 10;
+    static constexpr size_t kFirstChunk = size_t{1} << kFirstChunkBits;
+    static constexpr int kChunkCount = 32 - kFirstChunkBits;
+
+    const std::shared_ptr<Symbol>& At(uint32_t id) const {
+        size_t position = size_t{id} + kFirstChunk;
+        int chunk = std::bit_width(position) - 1 - kFirstChunkBits;
+        return chunks[chunk][position - (kFirstChunk << chunk)];
+    }
+
+    /// захватывается только для добавления символа
+    std::mutex mutex;
+    /// ключи смотрят в name_ самих символов
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::array<std::unique_ptr<std::shared_ptr<Symbol>[]>, kChunkCount> chunks;
+    std::atomic<uint32_t> size = 0;
+};
+
+static SymbolTable& GetSymbolTable() {
+    static SymbolTable table;
+    return table;
+}
+
+std::shared_ptr<Symbol> Symbol::Intern(std::string_view name) {
+    // свой кэш у каждого потока: повторные имена не трогают общий mutex
+    thread_local std::unordered_map<std::string_view, const std::shared_ptr<Symbol>*> known;
+    if (auto it = known.find(name); it != known.end()) {
+        return *it->second;
+    }
+
+    auto& table = GetSymbolTable();
+    std::lock_guard lock{table.mutex};
+    auto it = table.ids.find(name);
+    if (it == table.ids.end()) {
+        uint32_t id = table.size.load(std::memory_order_relaxed);
+        size_t position = size_t{id} + SymbolTable::kFirstChunk;
+        int chunk = std::bit_width(position) - 1 - SymbolTable::kFirstChunkBits;
+        if (position == (SymbolTable::kFirstChunk << chunk)) {
+            table.chunks[chunk].reset(
+                new std::shared_ptr<Symbol>[SymbolTable::kFirstChunk << chunk]);
+        }
+        auto& slot = table.chunks[chunk][position - (SymbolTable::kFirstChunk << chunk)];
+        slot = std::make_shared<Symbol>(std::string(name), id);
+        it = table.ids.emplace(slot->GetName(), id).first;
+        table.size.store(id + 1, std::memory_order_release);
+    }
+    const auto& symbol = table.At(it->second);
+    known.emplace(symbol->GetName(), &symbol);
+    return symbol;
+}
+
+std::shared_ptr<Symbol> Symbol::FromId(uint32_t id) {
+    const auto& table = GetSymbolTable();
+    if (id >= table.size.load(std::memory_order_acquire)) {
+        throw std::out_of_range("unknown symbol id");
+    }
+    return table.At(id);
+}
+
+std::shared_ptr<Bool> Bool::Make(bool bool_value) {
+    static const auto true_value = std::make_shared<Bool>(true);
+    static const auto false_value = std::make_shared<Bool>(false);
+    return bool_value ? true_value : false_value;
+}
+
+std::shared_ptr<Number> Number::Make(int64_t value) {
+    using Cache = std::array<std::shared_ptr<Number>, kCachedMax - kCachedMin + 1>;
+    static const Cache cache = [] {
+        Cache result;
+        for (int64_t i = kCachedMin; i <= kCachedMax; ++i) {
+            result[i - kCachedMin] = std::make_shared<Number>(i);
+        }
+        return result;
+    }();
+    if (value < kCachedMin || value > kCachedMax) {
+        return std::make_shared<Number>(value);
+    }
+    return cache[value - kCachedMin];
+}
+
+std::shared_ptr<Number> Number::Make(BigInteger value) {
+    if (value.FitsInt64()) {
+        return Make(value.ToInt64());
+    }
+    return std::make_shared<Number>(std::move(value));
+}
+
+std::shared_ptr<Number> AddBigNumbers(const Number& lhs, const Number& rhs) {
+    BigInteger lhs_storage, rhs_storage;
+    return Number::Make(lhs.GetBigInteger(&lhs_storage) + rhs.GetBigInteger(&rhs_storage));
+}
+
+std::shared_ptr<Number> SubtractBigNumbers(const Number& lhs, const Number& rhs) {
+    BigInteger lhs_storage, rhs_storage;
+    return Number::Make(lhs.GetBigInteger(&lhs_storage) - rhs.GetBigInteger(&rhs_storage));
+}
+
+std::shared_ptr<Number> MultiplyBigNumbers(const Number& lhs, const Number& rhs) {
+    BigInteger lhs_storage, rhs_storage;
+    return Number::Make(lhs.GetBigInteger(&lhs_storage) * rhs.GetBigInteger(&rhs_storage));
+}
+
+std::shared_ptr<Number> DivideBigNumbers(const Number& lhs, const Number& rhs) {
+    BigInteger lhs_storage, rhs_storage;
+    const auto& divisor = rhs.GetBigInteger(&rhs_storage);
+    if (divisor.IsZero()) {
+        throw RuntimeError("division by zero");
+    }
+    return Number::Make(lhs.GetBigInteger(&lhs_storage) / divisor);
+}
+
+int CompareBigNumbers(const Number& lhs, const Number& rhs) {
+    BigInteger lhs_storage, rhs_storage;
+    return lhs.GetBigInteger(&lhs_storage).Compare(rhs.GetBigInteger(&rhs_storage));
+}
+
+namespace {
+
+/// Блоки одного размера. Из системы они берутся пачками по kBatch и обратно не отдаются.
+/// Свободные блоки лежат в списке своего потока, поэтому выделение и освобождение идут без
+/// блокировок; когда поток завершается, его список уходит в общий запас.
+template <size_t kSize, size_t kAlign>
+class BlockPool {
+public:
+    static void* Allocate() {
+        if (free_list == nullptr) {
+            Refill();
+        }
+        FreeBlock* block = free_list;
+        free_list = block->next;
+        return block;
+    }
+
+    static void Free(void* pointer) {
+        auto* block = static_cast<FreeBlock*>(pointer);
+        if (thread_closed) {
+            // статические объекты разрушаются уже после списка потока
+            auto& shared = GetShared();
+            std::lock_guard lock{shared.mutex};
+            block->next = nullptr;
+            shared.orphans.push_back(block);
+            return;
+        }
+        if (free_list == nullptr) {
+            // поток, который только освобождает, сам Refill не позовёт
+            WatchThreadExit();
+        }
+        block->next = free_list;
+        free_list = block;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static constexpr size_t kBlockSize =
+        (std::max(kSize, sizeof(FreeBlock)) + kAlign - 1) / kAlign * kAlign;
+    static constexpr size_t kBatch = 256;
+    static_assert(kAlign <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+    struct Shared {
+        std::mutex mutex;
+        std::vector<FreeBlock*> orphans;
+        std::vector<std::unique_ptr<std::byte[]>> chunks;
+    };
+
+    /// при выходе из потока отдаёт его свободные блоки в общий запас
+    struct ThreadCloser {
+        ~ThreadCloser() {
+            thread_closed = true;
+            if (free_list != nullptr) {
+                auto& shared = GetShared();
+                std::lock_guard lock{shared.mutex};
+                shared.orphans.push_back(free_list);
+                free_list = nullptr;
+            }
+        }
+    };
+
+    /// с первого вызова в потоке его список при выходе уходит в общий запас
+    static void WatchThreadExit() {
+        thread_local ThreadCloser closer;
+    }
+
+    static Shared& GetShared() {
+        // живёт до конца процесса: блоки из пачек могут освобождаться при разрушении статиков
+        static auto* shared = new Shared;
+        return *shared;
+    }
+
+    static void Refill() {
+        WatchThreadExit();
+        auto& shared = GetShared();
+        std::lock_guard lock{shared.mutex};
+        if (!shared.orphans.empty()) {
+            free_list = shared.orphans.back();
+            shared.orphans.pop_back();
+            return;
+        }
+        std::byte* chunk = shared.chunks.emplace_back(new std::byte[kBlockSize * kBatch]).get();
+        for (size_t i = kBatch; i > 0; --i) {
+            auto* block = reinterpret_cast<FreeBlock*>(chunk + (i - 1) * kBlockSize);
+            block->next = free_list;
+            free_list = block;
+        }
+    }
+
+    static thread_local FreeBlock* free_list;
+    static thread_local bool thread_closed;
+};
+
+template <size_t kSize, size_t kAlign>
+thread_local typename BlockPool<kSize, kAlign>::FreeBlock* BlockPool<kSize, kAlign>::free_list =
+    nullptr;
+template <size_t kSize, size_t kAlign>
+thread_local bool BlockPool<kSize, kAlign>::thread_closed = false;
+
+/// аллокатор для allocate_shared: ячейка и блок управления shared_ptr - один блок пула
+template <class T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>&) {
+    }
+
+    T* allocate(size_t count) {
+        if (count != 1) {
+            return std::allocator<T>().allocate(count);
+        }
+        return static_cast<T*>(BlockPool<sizeof(T), alignof(T)>::Allocate());
+    }
+
+    void deallocate(T* pointer, size_t count) {
+        if (count != 1) {
+            std::allocator<T>().deallocate(pointer, count);
+            return;
+        }
+        BlockPool<sizeof(T), alignof(T)>::Free(pointer);
+    }
+
+    template <class U>
+    bool operator==(const PoolAllocator<U>&) const {
+        return true;
+    }
+};
+
+/// ячейку можно разобрать на месте, только если кроме нас на неё никто не ссылается
+bool IsUniqueCell(const std::shared_ptr<Object>& object) {
+    return object.use_count() == 1 && Is<Cell>(object);
+}
+
+}  // namespace
+
+uint32_t EnterTask::NewTaskId() {
+    static std::atomic<uint32_t> last_id = 0;
+    uint32_t id;
+    do {
+        id = last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+    } while (id == 0);
+    return id;
+}
+
+std::shared_ptr<Cell> Cell::Make(std::shared_ptr<Object> first, std::shared_ptr<Object> second) {
+    return std::allocate_shared<Cell>(PoolAllocator<Cell>(), std::move(first), std::move(second));
+}
+
+Cell::~Cell() {
+    if (!IsUniqueCell(first_) && !IsUniqueCell(second_)) {
+        return;
+    }
+    // дети, которые умрут вместе с этой ячейкой, сначала отцепляются от своих детей
+    std::vector<std::shared_ptr<Object>> pending;
+    auto detach = [&pending](std::shared_ptr<Object>* child) {
+        if (IsUniqueCell(*child)) {
+            pending.push_back(std::move(*child));
+        }
+    };
+    detach(&first_);
+    detach(&second_);
+    while (!pending.empty()) {
+        auto object = std::move(pending.back());
+        pending.pop_back();
+        auto cell = As<Cell>(object);
+        detach(&cell->first_);
+        detach(&cell->second_);
+    }
+}
+
+GlobalValues SnapshotGlobalsFor(const Function& function) {
+    if (task_globals != nullptr) {
+        return *task_globals;
+    }
+    Scope* scope = function.GetGlobalScope();
+    return scope != nullptr ? scope->Snapshot() : GlobalValues{};
+}
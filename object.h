@@ -1,31 +1,74 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
-#include <optional>
+#include <span>
 #include <string>
-#include <typeinfo>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
+#include "bignum.h"
 #include "error.h"
+#include "hamt.h"
+
+/// FUNCTION и всё после него - наследники Function
+enum class ObjectType : uint8_t {
+    SYMBOL,
+    BOOL,
+    NUMBER,
+    CELL,
+    FUTURE,
+    FUNCTION,
+    CLOSURE,
+    BYTECODE_CLOSURE,
+};
 
-class Scope;
-
-class Object : public std::enable_shared_from_this<Object> {
+class Object {
 public:
+    explicit Object(ObjectType type) : type_(type){};
     virtual ~Object() = default;
 
+    ObjectType GetType() const {
+        return type_;
+    }
+
     virtual std::string ToString() {
         throw RuntimeError("Calling ToSting from base class");
     };
 
-    virtual std::shared_ptr<Object> Eval(Scope* scope) {
-        throw RuntimeError("Calling Eval from base class");
-    };
+protected:
+    ObjectType type_;
 };
 
+class Function;
+class CycleCollector;
+
+/// Проверка типа - одно сравнение тега, указатель заимствуется у obj без изменения счётчика
+/// ссылок, так что obj должен пережить результат. У builtin-ов (Add, Car, ...) своего тега
+/// нет, для них после тега FUNCTION нужен ещё dynamic_cast.
 template <class T>
-std::shared_ptr<T> As(const std::shared_ptr<Object>& obj) {
-    return std::dynamic_pointer_cast<T>(obj);
+T* As(const std::shared_ptr<Object>& obj) {
+    if (obj == nullptr) {
+        return nullptr;
+    }
+    if constexpr (std::is_same_v<T, Function>) {
+        return obj->GetType() >= ObjectType::FUNCTION ? static_cast<T*>(obj.get()) : nullptr;
+    } else if constexpr (std::is_base_of_v<Function, T> && T::kType == ObjectType::FUNCTION) {
+        return obj->GetType() == T::kType ? dynamic_cast<T*>(obj.get()) : nullptr;
+    } else {
+        return obj->GetType() == T::kType ? static_cast<T*>(obj.get()) : nullptr;
+    }
+}
+
+/// то же, но результат владеет объектом - когда его надо сохранить
+template <class T>
+std::shared_ptr<T> AsShared(const std::shared_ptr<Object>& obj) {
+    if (As<T>(obj) == nullptr) {
+        return nullptr;
+    }
+    return std::static_pointer_cast<T>(obj);
 }
 
 template <class T>
@@ -33,85 +76,234 @@ bool Is(const std::shared_ptr<Object>& obj) {
     return As<T>(obj) != nullptr;
 }
 
+/// is_defined отличает ещё не определённое имя от значения () - оно тоже nullptr
+struct Binding {
+    std::shared_ptr<Object> value;
+    bool is_defined = false;
+};
+
+/// Номер параллельной задачи, которую поток исполняет сейчас; 0 - вне задач. Кадры и
+/// ячейки помнят, в какой задаче созданы. Задача меняет только свои: всё остальное в это
+/// же время могут читать другие задачи и сборщик циклов владельца. 32 бит хватает, чтобы
+/// номер ячейки поместился в хвост Object; после переполнения номера идут по кругу.
+inline constinit thread_local uint32_t current_task = 0;
+
+/// Кадр лексического окружения: слоты параметров и внутренних define одной lambda.
+/// Локальное имя ещё при разборе превращается в (глубина, слот), так что поиск - это
+/// depth переходов по parent и индекс в массиве.
+struct Frame {
+    Frame(size_t size, std::shared_ptr<Frame> parent_frame)
+        : slots(size), parent(std::move(parent_frame)){};
+
+    Frame* GetAncestor(uint16_t depth) {
+        Frame* frame = this;
+        for (; depth > 0; --depth) {
+            frame = frame->parent.get();
+        }
+        return frame;
+    }
+    Binding& Lookup(uint16_t depth, uint32_t slot) {
+        return GetAncestor(depth)->slots[slot];
+    }
+
+    std::vector<Binding> slots;
+    std::shared_ptr<Frame> parent;
+    uint32_t task = current_task;
+};
+
+/// RuntimeError, если задача пытается изменить кадр, созданный не ею
+inline void CheckFrameWritable(const Frame& frame) {
+    if (current_task != 0 && frame.task != current_task) [[unlikely]] {
+        throw RuntimeError("cannot change a variable of another task inside a parallel task");
+    }
+}
+
+/// Значения глобальных имён на какой-то момент; ключ - адрес binding-а в Scope
+using GlobalValues = PersistentMap<std::shared_ptr<Object>>;
+
+/// Снимок, из которого параллельная задача в этом потоке читает глобальные имена; вне задач
+/// nullptr, и код читает сами binding-и
+inline constinit thread_local const GlobalValues* task_globals = nullptr;
+
+/// значение глобального имени для чтения или nullptr, если имя не определено
+inline const std::shared_ptr<Object>* ReadGlobal(const Binding* binding) {
+    if (task_globals != nullptr) [[unlikely]] {
+        return task_globals->Find(reinterpret_cast<uintptr_t>(binding));
+    }
+    return binding->is_defined ? &binding->value : nullptr;
+}
+
+/// Делает поток исполнителем новой задачи до конца своей жизни: глобальные имена читаются
+/// из values, а current_task получает свежий номер
+class EnterTask {
+public:
+    explicit EnterTask(const GlobalValues* values)
+        : previous_globals_(task_globals), previous_task_(current_task) {
+        task_globals = values;
+        current_task = NewTaskId();
+    }
+    EnterTask(const EnterTask&) = delete;
+    EnterTask& operator=(const EnterTask&) = delete;
+    ~EnterTask() {
+        task_globals = previous_globals_;
+        current_task = previous_task_;
+    }
+
+private:
+    static uint32_t NewTaskId();
+
+private:
+    const GlobalValues* previous_globals_;
+    uint32_t previous_task_;
+};
+
+/// Глобальное окружение; имена - id интернированных символов, строки при поиске не
+/// хешируются. Пишет в него только поток, который сейчас исполняет свой Interpreter, через
+/// binding-и напрямую, и после каждой записи переносит значение в снимок через MarkChanged.
+/// Параллельные задачи читают не binding-и, а Snapshot: пока они работают, владелец может
+/// делать define, set! и LoadImage, а задачи не видят ни гонок, ни половины перезагрузки.
 class Scope {
 public:
-    std::shared_ptr<Object> SearchForName(const std::string& name) {
-        if (current_namespace_.contains(name)) {
-            return current_namespace_.at(name);
-        }
-        if (parent_scope_ != nullptr) {
-            return parent_scope_->SearchForName(name);
+    explicit Scope(std::shared_ptr<Scope> parent_scope = nullptr)
+        : parent_scope_(std::move(parent_scope)){};
+
+    Binding* SearchForName(uint32_t name) {
+        for (Scope* scope = this; scope != nullptr; scope = scope->parent_scope_.get()) {
+            auto it = scope->current_namespace_.find(name);
+            if (it != scope->current_namespace_.end()) {
+                return &it->second;
+            }
         }
         return nullptr;
     }
-    void Define(const std::string& name, std::shared_ptr<Object> argument) {
-        current_namespace_[name] = argument;
+    /// адрес binding-а не меняется при rehash, поэтому его можно запомнить заранее
+    Binding* GetBinding(uint32_t name) {
+        return &current_namespace_[name];
     }
-    void Set(const std::string& name, std::shared_ptr<Object> argument) {
-        if (SearchForName(name) != nullptr) {
-            if (current_namespace_.contains(name)) {
-                current_namespace_[name] = argument;
-            }
-            if (parent_scope_ != nullptr) {
-                return parent_scope_->Set(name, argument);
-            }
+    void Define(uint32_t name, std::shared_ptr<Object> argument) {
+        Binding& binding = current_namespace_[name];
+        binding = Binding{std::move(argument), true};
+        MarkChanged(binding);
+    }
+    const std::unordered_map<uint32_t, Binding>& GetBindings() const {
+        return current_namespace_;
+    }
+    void Set(uint32_t name, std::shared_ptr<Object> argument) {
+        Binding* binding = SearchForName(name);
+        if (binding == nullptr || !binding->is_defined) {
+            throw NameError("cannot find this name in any namespace");
         }
-        throw NameError("cannot find this name in any namespace");
-    }
-    //    void ChangeParent(Scope* par) {
-    //        parent_scope_ = par;
-    //    }
-    //    void Create(const std::string& name) {
-    //        current_namespace_[name] = std::make_shared<Object>();
-    //    }
-    //    void Reset() {
-    //        for (auto& [name, ptr] : current_namespace_) {
-    //            ptr = std::make_shared<Object>();
-    //        }
-    //    }
+        binding->value = std::move(argument);
+        MarkChanged(*binding);
+    }
+
+    /// После каждой записи в binding этого окружения. Узлы снимка, которые ещё никому не
+    /// отданы, меняются на месте; после Snapshot первая запись копирует путь до binding-а.
+    void MarkChanged(const Binding& binding) {
+        snapshot_.SetInPlace(reinterpret_cast<uintptr_t>(&binding), binding.value, edit_);
+    }
+    /// значения всех определённых имён сейчас; копия корня, за O(1)
+    GlobalValues Snapshot() {
+        ++edit_;
+        return snapshot_;
+    }
 
 protected:
-    Scope* parent_scope_;
-    std::unordered_map<std::string, std::shared_ptr<Object>> current_namespace_;
+    std::shared_ptr<Scope> parent_scope_;
+    std::unordered_map<uint32_t, Binding> current_namespace_;
+    /// текущее значение каждого определённого имени; binding-и его только пополняют
+    GlobalValues snapshot_;
+    /// правка, узлы которой MarkChanged меняет на месте; Snapshot заводит новую
+    uint64_t edit_ = 1;
 };
 
+/// Вычисленные аргументы вызова. Смотрят в буфер вызывающего (стек VM, стек аргументов
+/// анализатора) и действительны только до возврата из Apply или до того, как Apply
+/// исполнит пользовательский код, - смотря что наступит раньше.
+using Arguments = std::span<const std::shared_ptr<Object>>;
+
 class Function : public Object {
 public:
-    virtual std::shared_ptr<Object> Apply(std::shared_ptr<Object>, Scope*) {
+    static constexpr ObjectType kType = ObjectType::FUNCTION;
+
+    explicit Function(ObjectType type = kType) : Object(type){};
+
+    /// аргументы приходят уже вычисленными
+    virtual std::shared_ptr<Object> Apply(Arguments) {
         throw RuntimeError("Calling Apply from base class");
     }
+
+    /// Входы для вызова с одним и двумя аргументами: им не нужен буфер аргументов.
+    /// Частые builtin-ы переопределяют их, остальным хватает переходника к Apply.
+    virtual std::shared_ptr<Object> Apply1(const std::shared_ptr<Object>& argument) {
+        return Apply(Arguments(&argument, 1));
+    }
+    virtual std::shared_ptr<Object> Apply2(const std::shared_ptr<Object>& first,
+                                           const std::shared_ptr<Object>& second) {
+        const std::shared_ptr<Object> arguments[] = {first, second};
+        return Apply(arguments);
+    }
+
+    std::string ToString() override {
+        return "#<procedure>";
+    }
+
+    /// кадр, который держит замыкание, - для сборщика циклов; у builtin-ов его нет
+    virtual Frame* GetCapturedFrame() const {
+        return nullptr;
+    }
+    /// окружение, глобальные имена которого читает код замыкания
+    virtual Scope* GetGlobalScope() const {
+        return nullptr;
+    }
+    /// сборщик, которому достаются кадры вызовов замыкания
+    virtual CycleCollector* GetCollector() const {
+        return nullptr;
+    }
 };
 
+/// Снимок глобальных имён для задачи, которая вызовет function: внутри другой задачи - её
+/// же снимок, иначе свежий снимок окружения function
+GlobalValues SnapshotGlobalsFor(const Function& function);
 
-std::optional<std::shared_ptr<Function>> GetFunction(const std::string& name);
+bool GetBoolValueFromAnyType(const std::shared_ptr<Object>& argument);
 
+/// Каждому имени соответствует ровно один Symbol, поэтому символы можно сравнивать по
+/// указателю или по id. Создавать их надо через Intern, а не make_shared.
 class Symbol : public Object {
 public:
-    Symbol(const std::string& name) : name_(name){};
+    static constexpr ObjectType kType = ObjectType::SYMBOL;
+
+    Symbol(std::string name, uint32_t id) : Object(kType), name_(std::move(name)), id_(id){};
+
+    static std::shared_ptr<Symbol> Intern(std::string_view name);
+    static std::shared_ptr<Symbol> FromId(uint32_t id);
 
     const std::string& GetName() const {
         return name_;
     }
 
-    std::string ToString() override {
-        return name_;
+    uint32_t GetId() const {
+        return id_;
     }
 
-    std::shared_ptr<Object> Eval(Scope* scope) override {
-        auto func = GetFunction(name_);
-        if (func != std::nullopt) {
-            return *func;
-        }
-        throw NameError("wrong command name");
+    std::string ToString() override {
+        return name_;
     }
 
 protected:
     std::string name_;
+    uint32_t id_;
 };
 
 class Bool : public Object {
 public:
-    Bool(bool bool_value = false) : bool_value_(bool_value){};
+    static constexpr ObjectType kType = ObjectType::BOOL;
+
+    Bool(bool bool_value = false) : Object(kType), bool_value_(bool_value){};
+
+    /// #t и #f неизменяемы, поэтому на весь процесс их ровно по одному
+    static std::shared_ptr<Bool> Make(bool bool_value);
 
     bool GetBoolValue() const {
         return bool_value_;
@@ -126,174 +318,233 @@ public:
         }
     }
 
-    std::shared_ptr<Object> Eval(Scope* scope) override {
-        return shared_from_this();
-    }
-
 protected:
     bool bool_value_;
 };
 
+/// Точное целое. Пока значение помещается в int64_t, оно хранится как есть, и арифметика
+/// идёт в машинных словах с проверкой переполнения; иначе рядом лежит BigInteger. Make
+/// нормализует значение, так что большое число никогда не помещается в int64_t.
 class Number : public Object {
 public:
-    Number(int64_t value) : value_(value){};
+    static constexpr ObjectType kType = ObjectType::NUMBER;
 
+    Number(int64_t value) : Object(kType), value_(value){};
+    explicit Number(BigInteger value)
+        : Object(kType), big_(std::make_unique<const BigInteger>(std::move(value))){};
+
+    /// числа из [kCachedMin, kCachedMax] берутся из заранее созданной таблицы, остальные
+    /// выделяются как обычно; Number неизменяем, так что делить объекты безопасно
+    static std::shared_ptr<Number> Make(int64_t value);
+    static std::shared_ptr<Number> Make(BigInteger value);
+
+    static constexpr int64_t kCachedMin = -128;
+    static constexpr int64_t kCachedMax = 1023;
+
+    bool IsSmall() const {
+        return big_ == nullptr;
+    }
+    bool IsNegative() const {
+        return big_ != nullptr ? big_->IsNegative() : value_ < 0;
+    }
+    /// значение маленького числа
     int64_t GetValue() const {
         return value_;
     }
-
-    std::string ToString() override {
-        return std::to_string(value_);
+    /// значение любого числа; маленькое собирается в storage
+    const BigInteger& GetBigInteger(BigInteger* storage) const {
+        if (big_ != nullptr) {
+            return *big_;
+        }
+        *storage = BigInteger(value_);
+        return *storage;
     }
 
-    std::shared_ptr<Object> Eval(Scope* scope) override {
-        return shared_from_this();
+    std::string ToString() override {
+        return big_ != nullptr ? big_->ToString() : std::to_string(value_);
     }
 
 protected:
-    int64_t value_;
+    int64_t value_ = 0;
+    std::unique_ptr<const BigInteger> big_;
 };
 
+/// Арифметика над Number. Если оба числа маленькие и результат не переполняется, всё
+/// решается здесь же, в машинных словах; иначе - медленный путь через BigInteger.
+std::shared_ptr<Number> AddBigNumbers(const Number& lhs, const Number& rhs);
+std::shared_ptr<Number> SubtractBigNumbers(const Number& lhs, const Number& rhs);
+std::shared_ptr<Number> MultiplyBigNumbers(const Number& lhs, const Number& rhs);
+std::shared_ptr<Number> DivideBigNumbers(const Number& lhs, const Number& rhs);
+int CompareBigNumbers(const Number& lhs, const Number& rhs);
+
+inline std::shared_ptr<Number> AddNumbers(const Number& lhs, const Number& rhs) {
+    int64_t result;
+    if (lhs.IsSmall() && rhs.IsSmall() &&
+        !__builtin_add_overflow(lhs.GetValue(), rhs.GetValue(), &result)) {
+        return Number::Make(result);
+    }
+    return AddBigNumbers(lhs, rhs);
+}
+
+inline std::shared_ptr<Number> SubtractNumbers(const Number& lhs, const Number& rhs) {
+    int64_t result;
+    if (lhs.IsSmall() && rhs.IsSmall() &&
+        !__builtin_sub_overflow(lhs.GetValue(), rhs.GetValue(), &result)) {
+        return Number::Make(result);
+    }
+    return SubtractBigNumbers(lhs, rhs);
+}
+
+inline std::shared_ptr<Number> MultiplyNumbers(const Number& lhs, const Number& rhs) {
+    int64_t result;
+    if (lhs.IsSmall() && rhs.IsSmall() &&
+        !__builtin_mul_overflow(lhs.GetValue(), rhs.GetValue(), &result)) {
+        return Number::Make(result);
+    }
+    return MultiplyBigNumbers(lhs, rhs);
+}
+
+/// частное с отбрасыванием дробной части; на ноль - RuntimeError
+inline std::shared_ptr<Number> DivideNumbers(const Number& lhs, const Number& rhs) {
+    // INT64_MIN / -1 - единственное переполнение при делении
+    if (lhs.IsSmall() && rhs.IsSmall() && rhs.GetValue() != 0 &&
+        !(lhs.GetValue() == INT64_MIN && rhs.GetValue() == -1)) {
+        return Number::Make(lhs.GetValue() / rhs.GetValue());
+    }
+    return DivideBigNumbers(lhs, rhs);
+}
+
+/// -1, 0 или 1
+inline int CompareNumbers(const Number& lhs, const Number& rhs) {
+    if (lhs.IsSmall() && rhs.IsSmall()) {
+        return (lhs.GetValue() > rhs.GetValue()) - (lhs.GetValue() < rhs.GetValue());
+    }
+    return CompareBigNumbers(lhs, rhs);
+}
+
 class Cell : public Object {
 public:
+    static constexpr ObjectType kType = ObjectType::CELL;
+
     Cell(std::shared_ptr<Object> first, std::shared_ptr<Object> second)
-        : first_(first), second_(second){};
+        : Object(kType), first_(std::move(first)), second_(std::move(second)){};
+    /// список в миллион элементов рекурсивный деструктор не переживёт, поэтому цепочки
+    /// ячеек разбираются циклом
+    ~Cell() override;
+
+    /// ячейка из пула: память выделяется пачками, см. object.cpp
+    static std::shared_ptr<Cell> Make(std::shared_ptr<Object> first,
+                                      std::shared_ptr<Object> second);
 
     std::shared_ptr<Object> GetFirst() const {
         return first_;
     }
     void SetFirst(std::shared_ptr<Object> new_first) {
-        first_ = new_first;
+        first_ = std::move(new_first);
     }
     std::shared_ptr<Object> GetSecond() const {
         return second_;
     }
     void SetSecond(std::shared_ptr<Object> new_second) {
-        second_ = new_second;
+        second_ = std::move(new_second);
     }
 
-    /// TODO так..?
     std::string ToString() override {
-        if (second_ == nullptr) {
-            return first_->ToString();
-        }
-        return '(' + first_->ToString() + ' ' + second_->ToString() + ')';
-    }
-
-    std::shared_ptr<Object> Eval(Scope* scope) override {
-        //        if (second_ == nullptr) {
-        //            return first_->Eval();
-        //        }
-        if (first_ == nullptr) {
-            throw RuntimeError("first is nullptr in cell");
+        std::string result = "(" + ElementToString(first_);
+        std::shared_ptr<Object> tail = second_;
+        while (auto cell = As<Cell>(tail)) {
+            result += ' ' + ElementToString(cell->first_);
+            tail = cell->second_;
         }
-        /// TODO проверить на fuzzer этот ужас
-        if (second_ == nullptr && Is<Cell>(first_) &&    // NOLINT
-            Is<Symbol>(As<Cell>(first_)->GetFirst()) &&  // NOLINT
-            As<Symbol>(As<Cell>(first_)->GetFirst())->GetName() == "quote") {
-            return first_->Eval(scope);
+        if (tail != nullptr) {
+            result += " . " + tail->ToString();
         }
-        auto func = first_->Eval(scope);
-        if (!Is<Function>(func)) {
-            throw RuntimeError("not a function in eval");
-        }
-        return As<Function>(func)->Apply(second_, scope);
+        return result + ')';
     }
 
 protected:
-    std::shared_ptr<Object> first_;
-    std::shared_ptr<Object> second_;
-};
-
-/// отчаяние завело меня в специальный тип - гарантируется, что тут валидные символы тусят
-class NumPair : public Object {
-public:
-    NumPair(std::shared_ptr<Object> first, std::shared_ptr<Object> second)
-        : first_(first), second_(second){};
-
-    NumPair(std::shared_ptr<Object> cell) {
-        if (!Is<Cell>(cell)) {
-            throw RuntimeError("Need cell in NumPair constructor");
-        }
-        first_ = As<Cell>(cell)->GetFirst();
-        second_ = As<Cell>(cell)->GetSecond();
-        if (!Is<Number>(first_) || !Is<Number>(second_)) {
-            throw RuntimeError("NumPair arguments should be nums");
+    /// пустой список хранится как nullptr
+    static std::string ElementToString(const std::shared_ptr<Object>& element) {
+        if (element == nullptr) {
+            return "()";
         }
-    }
-    /// TODO написать GetFirst, GetSecond
-    std::shared_ptr<Object> Eval(Scope* scope) override {
-        return shared_from_this();
+        return element->ToString();
     }
 
-    std::string ToString() override {
-        if (second_ == nullptr) {
-            return first_->ToString();
-        }
-        return first_->ToString() + " . " + second_->ToString();
+public:
+    /// задача, в которой ячейка создана; см. current_task
+    uint32_t GetTask() const {
+        return task_;
     }
 
 protected:
+    uint32_t task_ = current_task;
     std::shared_ptr<Object> first_;
     std::shared_ptr<Object> second_;
 };
 
-#define MAKE_BASIC_FUNCTION(classname)                                                          \
-    class classname : public Function {                                                         \
-    public:                                                                                     \
-        std::shared_ptr<Object> Apply(std::shared_ptr<Object> argument, Scope* scope) override; \
+#define MAKE_BASIC_FUNCTION(classname)                                   \
+    class classname : public Function {                                  \
+    public:                                                              \
+        std::shared_ptr<Object> Apply(Arguments arg_vector) override;    \
     };
 
-MAKE_BASIC_FUNCTION(IsBool);
-MAKE_BASIC_FUNCTION(Quote);
-MAKE_BASIC_FUNCTION(IsNumber);
-MAKE_BASIC_FUNCTION(Equals);
-MAKE_BASIC_FUNCTION(Less);
-MAKE_BASIC_FUNCTION(Greater);
-MAKE_BASIC_FUNCTION(LEquals);
-MAKE_BASIC_FUNCTION(GEquals);
-MAKE_BASIC_FUNCTION(Add);
-MAKE_BASIC_FUNCTION(Subtract);
-MAKE_BASIC_FUNCTION(Multiply);
+/// builtin ровно от одного аргумента: Apply проверяет их число и зовёт Apply1
+#define MAKE_UNARY_FUNCTION(classname)                                                  \
+    class classname : public Function {                                                 \
+    public:                                                                             \
+        std::shared_ptr<Object> Apply(Arguments arg_vector) override;                   \
+        std::shared_ptr<Object> Apply1(const std::shared_ptr<Object>& argument) override; \
+    };
+
+/// builtin, у которого вызов от двух аргументов считается без обхода Arguments
+#define MAKE_BINARY_FUNCTION(classname)                                          \
+    class classname : public Function {                                          \
+    public:                                                                      \
+        std::shared_ptr<Object> Apply(Arguments arg_vector) override;            \
+        std::shared_ptr<Object> Apply2(const std::shared_ptr<Object>& first,     \
+                                       const std::shared_ptr<Object>& second) override; \
+    };
+
+MAKE_UNARY_FUNCTION(IsBool);
+MAKE_UNARY_FUNCTION(IsNumber);
+MAKE_BINARY_FUNCTION(Equals);
+MAKE_BINARY_FUNCTION(Less);
+MAKE_BINARY_FUNCTION(Greater);
+MAKE_BINARY_FUNCTION(LEquals);
+MAKE_BINARY_FUNCTION(GEquals);
+MAKE_BINARY_FUNCTION(Add);
+MAKE_BINARY_FUNCTION(Subtract);
+MAKE_BINARY_FUNCTION(Multiply);
 MAKE_BASIC_FUNCTION(Divide);
 MAKE_BASIC_FUNCTION(Max);
 MAKE_BASIC_FUNCTION(Min);
-MAKE_BASIC_FUNCTION(Abs);
-MAKE_BASIC_FUNCTION(Not);
-MAKE_BASIC_FUNCTION(And);
-MAKE_BASIC_FUNCTION(Or);
-MAKE_BASIC_FUNCTION(IsPair);
-MAKE_BASIC_FUNCTION(IsNull);
+MAKE_UNARY_FUNCTION(Abs);
+MAKE_UNARY_FUNCTION(Not);
+MAKE_UNARY_FUNCTION(IsPair);
+MAKE_UNARY_FUNCTION(IsNull);
 MAKE_BASIC_FUNCTION(IsList);
-MAKE_BASIC_FUNCTION(Cons);
-MAKE_BASIC_FUNCTION(Car);
-MAKE_BASIC_FUNCTION(Cdr);
+MAKE_BINARY_FUNCTION(Cons);
+MAKE_UNARY_FUNCTION(Car);
+MAKE_UNARY_FUNCTION(Cdr);
 MAKE_BASIC_FUNCTION(MakeList);
 MAKE_BASIC_FUNCTION(ListRef);
 MAKE_BASIC_FUNCTION(ListTail);
-MAKE_BASIC_FUNCTION(IsSymbol);
-MAKE_BASIC_FUNCTION(Define);
-MAKE_BASIC_FUNCTION(Set);
-
-class Variable : public Function {
-public:
-    Variable(std::shared_ptr<Object> value) : value_(value){};
-
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> argument, Scope* scope) override {
-        return value_;
-    }
-
-    std::string ToString() override {
-        return value_->ToString();
-    }
-
-protected:
-    std::shared_ptr<Object> value_;
-};
-
-static std::unordered_map<std::string, std::shared_ptr<Function>> name_to_function = {
+MAKE_BASIC_FUNCTION(SetCar);
+MAKE_BASIC_FUNCTION(SetCdr);
+MAKE_UNARY_FUNCTION(IsSymbol);
+MAKE_BINARY_FUNCTION(IsEq);
+MAKE_BASIC_FUNCTION(ParMap);
+MAKE_BASIC_FUNCTION(ParForEach);
+MAKE_BASIC_FUNCTION(ParReduce);
+MAKE_UNARY_FUNCTION(MakeFuture);
+MAKE_UNARY_FUNCTION(Touch);
+
+/// Одна таблица на всю программу: образ кучи узнаёт builtin-ы по адресу. Таблица и сами
+/// builtin-ы неизменяемы, каждый Interpreter копирует их в своё глобальное окружение,
+/// так что интерпретаторы в разных потоках общего изменяемого состояния не имеют.
+inline const std::unordered_map<std::string, std::shared_ptr<Function>> name_to_function = {
     {"boolean?", std::make_shared<IsBool>()},
-    {"quote", std::make_shared<Quote>()},
     {"number?", std::make_shared<IsNumber>()},
     {"=", std::make_shared<Equals>()},
     {"<", std::make_shared<Less>()},
@@ -308,8 +559,6 @@ static std::unordered_map<std::string, std::shared_ptr<Function>> name_to_functi
     {"min", std::make_shared<Min>()},
     {"abs", std::make_shared<Abs>()},
     {"not", std::make_shared<Not>()},
-    {"and", std::make_shared<And>()},
-    {"or", std::make_shared<Or>()},
     {"pair?", std::make_shared<IsPair>()},
     {"null?", std::make_shared<IsNull>()},
     {"list?", std::make_shared<IsList>()},
@@ -319,6 +568,12 @@ static std::unordered_map<std::string, std::shared_ptr<Function>> name_to_functi
     {"list", std::make_shared<MakeList>()},
     {"list-ref", std::make_shared<ListRef>()},
     {"list-tail", std::make_shared<ListTail>()},
+    {"set-car!", std::make_shared<SetCar>()},
+    {"set-cdr!", std::make_shared<SetCdr>()},
     {"symbol?", std::make_shared<IsSymbol>()},
-    {"define", std::make_shared<Define>()},
-    {"set!", std::make_shared<Set>()}};
+    {"eq?", std::make_shared<IsEq>()},
+    {"par-map", std::make_shared<ParMap>()},
+    {"par-for-each", std::make_shared<ParForEach>()},
+    {"par-reduce", std::make_shared<ParReduce>()},
+    {"make-future", std::make_shared<MakeFuture>()},
+    {"touch", std::make_shared<Touch>()}};
@@ -1,69 +1,134 @@
 #include <parser.h>
 
-#define CheckToken(TokenType, token, behaviour)            \
-    if (TokenType* ptr = std::get_if<TokenType>(&token)) { \
-        behaviour;                                         \
-    }
+#include <vector>
 
-std::shared_ptr<Object> Read(Tokenizer* tokenizer) {
-    Token token = tokenizer->GetToken();
-    tokenizer->Next();
-    if (BooleanToken* ptr = std::get_if<BooleanToken>(&token)) {
-        if (*ptr == BooleanToken::TRUE) {
-            return std::make_shared<Bool>(true);
+namespace {
+
+/// Форма, которую читатель начал, но ещё не закончил. Вместо рекурсии по вложенности и по
+/// элементам списка такие формы лежат на явном стеке.
+struct PendingForm {
+    enum class Kind { LIST, QUOTE };
+
+    explicit PendingForm(Kind kind) : kind(kind){};
+
+    Kind kind;
+    std::shared_ptr<Object> head;
+    /// последняя ячейка списка, к ней дописывается следующий элемент
+    Cell* tail = nullptr;
+    /// после точки ждём последний cdr и закрывающую скобку
+    bool after_dot = false;
+};
+
+bool IsBracket(const Token& token, BracketToken bracket) {
+    const BracketToken* bracket_ptr = std::get_if<BracketToken>(&token);
+    return bracket_ptr != nullptr && *bracket_ptr == bracket;
+}
+
+/// Читает формы, пока не будет закончена та, что лежит на дне стека (или, если стек пуст,
+/// одна следующая форма). Нативный стек не растёт ни от длины, ни от глубины входа.
+std::shared_ptr<Object> ReadForm(Tokenizer* tokenizer, std::vector<PendingForm>* stack) {
+    static const auto quote = Symbol::Intern("quote");
+    while (true) {
+        std::shared_ptr<Object> datum;
+        Token token = tokenizer->GetToken();
+        tokenizer->Next();
+        if (BooleanToken* ptr = std::get_if<BooleanToken>(&token)) {
+            datum = Bool::Make(*ptr == BooleanToken::TRUE);
+        } else if (ConstantToken* ptr = std::get_if<ConstantToken>(&token)) {
+            datum = ptr->digits.empty() ? Number::Make(ptr->value)
+                                        : Number::Make(BigInteger::Parse(ptr->digits));
+        } else if (SymbolToken* ptr = std::get_if<SymbolToken>(&token)) {
+            datum = Symbol::FromId(ptr->id);
+        } else if (IsBracket(token, BracketToken::OPEN)) {
+            if (!IsBracket(tokenizer->GetToken(), BracketToken::CLOSE)) {
+                stack->emplace_back(PendingForm::Kind::LIST);
+                continue;
+            }
+            tokenizer->Next();
+        } else if (IsBracket(token, BracketToken::CLOSE)) {
+            throw SyntaxError("Close bracket without open");
+        } else if (std::get_if<QuoteToken>(&token)) {
+            // 'x is sugar for (quote x)
+            stack->emplace_back(PendingForm::Kind::QUOTE);
+            continue;
         } else {
-            return std::make_shared<Bool>(false);
+            throw SyntaxError("undefined token");
         }
-    }
-    CheckToken(ConstantToken, token, return std::make_shared<Number>(ptr->value));
-    if (BracketToken* ptr = std::get_if<BracketToken>(&token)) {
-        if (*ptr == BracketToken::CLOSE) {
-            throw SyntaxError("Close bracket without open");
+
+        // готовое значение поднимается по стеку, пока какая-нибудь форма не попросит ещё
+        while (true) {
+            if (stack->empty()) {
+                return datum;
+            }
+            PendingForm& form = stack->back();
+            if (form.kind == PendingForm::Kind::QUOTE) {
+                datum = Cell::Make(quote, Cell::Make(std::move(datum), nullptr));
+                stack->pop_back();
+                continue;
+            }
+            if (form.after_dot) {
+                form.tail->SetSecond(std::move(datum));
+                if (!IsBracket(tokenizer->GetToken(), BracketToken::CLOSE)) {
+                    throw SyntaxError("Need close bracket");
+                }
+                tokenizer->Next();
+                datum = std::move(form.head);
+                stack->pop_back();
+                continue;
+            }
+
+            auto cell = Cell::Make(std::move(datum), nullptr);
+            Cell* new_tail = cell.get();
+            if (form.tail == nullptr) {
+                form.head = std::move(cell);
+            } else {
+                form.tail->SetSecond(std::move(cell));
+            }
+            form.tail = new_tail;
+
+            const Token& next = tokenizer->GetToken();
+            if (std::get_if<DotToken>(&next)) {
+                tokenizer->Next();
+                form.after_dot = true;
+                break;
+            }
+            if (!IsBracket(next, BracketToken::CLOSE)) {
+                break;
+            }
+            tokenizer->Next();
+            datum = std::move(form.head);
+            stack->pop_back();
         }
-        return ReadList(tokenizer);
-    }
-    if (QuoteToken* ptr = std::get_if<QuoteToken>(&token)) {
-        return std::make_shared<Cell>(std::make_shared<Symbol>("quote"), Read(tokenizer));
     }
-    /// TODO стереть
-
-    CheckToken(SymbolToken, token, return std::make_shared<Symbol>(ptr->name));
-    throw SyntaxError("undefined token");
 }
 
-bool IsCloseBracket(Tokenizer* tokenizer) {
-    Token token = tokenizer->GetToken();
-    if (BracketToken* bracket_ptr = std::get_if<BracketToken>(&token)) {
-        if (*bracket_ptr == BracketToken::CLOSE) {
-            return true;
-        }
+/// Стек один на поток и между чтениями пуст, так что его память не выделяется заново на
+/// каждую форму. После ошибки недочитанная форма отпускается сразу.
+std::shared_ptr<Object> ReadWithStack(Tokenizer* tokenizer, bool inside_list) {
+    static thread_local std::vector<PendingForm> stack;
+    if (inside_list) {
+        stack.emplace_back(PendingForm::Kind::LIST);
     }
-    return false;
+    try {
+        return ReadForm(tokenizer, &stack);
+    } catch (...) {
+        stack.clear();
+        throw;
+    }
+}
+
+}  // namespace
+
+std::shared_ptr<Object> Read(Tokenizer* tokenizer) {
+    return ReadWithStack(tokenizer, false);
 }
 
-/// TODO где-то тут мне надо кидаться ошибкой
 std::shared_ptr<Object> ReadList(Tokenizer* tokenizer) {
-    if (IsCloseBracket(tokenizer)) {
+    if (IsBracket(tokenizer->GetToken(), BracketToken::CLOSE)) {
         tokenizer->Next();
         return nullptr;
     }
-    std::shared_ptr<Object> first = Read(tokenizer);
-
-    Token dot_token_ptr = tokenizer->GetToken();
-    if (!std::get_if<DotToken>(&dot_token_ptr)) {
-        return std::make_shared<Cell>(first, ReadList(tokenizer));
-    }
-
-    tokenizer->Next();
-    std::shared_ptr<Object> second = Read(tokenizer);
-    Token token = tokenizer->GetToken();
-    if (BracketToken* bracket = std::get_if<BracketToken>(&token)) {
-        if (*bracket == BracketToken::CLOSE) {
-            tokenizer->Next();
-            return std::make_shared<Cell>(first, second);
-        }
-    }
-    throw SyntaxError("Need close bracket");
+    return ReadWithStack(tokenizer, true);
 }
 
 std::shared_ptr<Object> ReadAll(Tokenizer* tokenizer) {
@@ -72,4 +137,4 @@ std::shared_ptr<Object> ReadAll(Tokenizer* tokenizer) {
         throw SyntaxError("tokenizer did not end");
     }
     return object_ptr;
-}
\ No newline at end of file
+}
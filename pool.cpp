@@ -0,0 +1,107 @@
+#include "pool.h"
+
+#include <exception>
+#include <future>
+
+InterpreterPool::InterpreterPool(size_t workers, size_t queue_capacity, Engine engine,
+                                 std::function<void(Interpreter*)> warm_up)
+    : queue_(queue_capacity) {
+    std::vector<std::future<void>> ready;
+    for (size_t i = 0; i < workers; ++i) {
+        std::promise<void> warmed_up;
+        ready.push_back(warmed_up.get_future());
+        workers_.emplace_back([this, engine, warm_up, warmed_up = std::move(warmed_up)]() mutable {
+            // интерпретатор создаётся в своём потоке: его ячейки и кадры идут из пула
+            // этого потока
+            Interpreter interpreter(engine);
+            try {
+                if (warm_up) {
+                    warm_up(&interpreter);
+                }
+                warmed_up.set_value();
+            } catch (...) {
+                warmed_up.set_exception(std::current_exception());
+            }
+            WorkerLoop(&interpreter);
+        });
+    }
+    try {
+        for (auto& future : ready) {
+            future.get();
+        }
+    } catch (...) {
+        Stop();
+        throw;
+    }
+}
+
+InterpreterPool::~InterpreterPool() {
+    Stop();
+}
+
+void InterpreterPool::Stop() {
+    stopping_.store(true);
+    pushed_.fetch_add(1, std::memory_order_release);
+    pushed_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+bool InterpreterPool::TrySubmit(std::string expression, std::function<void(PoolResponse)> done) {
+    PoolRequest request{std::move(expression), std::move(done), std::chrono::steady_clock::now()};
+    return TryPush(&request);
+}
+
+void InterpreterPool::Submit(std::string expression, std::function<void(PoolResponse)> done) {
+    PoolRequest request{std::move(expression), std::move(done), std::chrono::steady_clock::now()};
+    while (true) {
+        uint32_t seen = popped_.load(std::memory_order_acquire);
+        if (TryPush(&request)) {
+            return;
+        }
+        popped_.wait(seen);
+    }
+}
+
+bool InterpreterPool::TryPush(PoolRequest* request) {
+    if (!queue_.TryPush(*request)) {
+        return false;
+    }
+    pushed_.fetch_add(1, std::memory_order_release);
+    pushed_.notify_one();
+    return true;
+}
+
+void InterpreterPool::WorkerLoop(Interpreter* interpreter) {
+    while (true) {
+        // счётчик читается до TryPop: если запрос придёт после неудачной попытки,
+        // wait увидит новое значение и не уснёт
+        uint32_t seen = pushed_.load(std::memory_order_acquire);
+        if (auto request = queue_.TryPop()) {
+            popped_.fetch_add(1, std::memory_order_release);
+            popped_.notify_all();
+            request->done(Execute(interpreter, *request));
+            continue;
+        }
+        if (stopping_.load()) {
+            return;
+        }
+        pushed_.wait(seen);
+    }
+}
+
+PoolResponse InterpreterPool::Execute(Interpreter* interpreter, const PoolRequest& request) {
+    PoolResponse response;
+    auto start = std::chrono::steady_clock::now();
+    response.wait_time = start - request.submitted;
+    try {
+        response.output = interpreter->Run(request.expression);
+    } catch (const std::exception& error) {
+        response.ok = false;
+        response.output = error.what();
+    }
+    response.run_time = std::chrono::steady_clock::now() - start;
+    return response;
+}
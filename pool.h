@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "queue.h"
+#include "scheme.h"
+
+/// Ответ на одно выражение. Ошибка Scheme не роняет воркер, а приходит сюда текстом.
+struct PoolResponse {
+    bool ok = true;
+    /// результат Run или текст исключения
+    std::string output;
+    /// от Submit до начала исполнения и само исполнение
+    std::chrono::nanoseconds wait_time{0};
+    std::chrono::nanoseconds run_time{0};
+};
+
+struct PoolRequest {
+    std::string expression;
+    /// зовётся в потоке воркера, пока он не берёт следующий запрос
+    std::function<void(PoolResponse)> done;
+    std::chrono::steady_clock::time_point submitted;
+};
+
+/// Фиксированный набор потоков, у каждого свой Interpreter, прогретый один раз при
+/// старте. Запросы идут через общую MpmcQueue; интерпретаторы между собой ничего не
+/// делят, поэтому порядок исполнения между воркерами не определён, а define в одном
+/// запросе виден только следующим запросам того же воркера.
+class InterpreterPool {
+public:
+    /// warm_up исполняется в каждом воркере до первого запроса, например LoadImage
+    InterpreterPool(size_t workers, size_t queue_capacity, Engine engine,
+                    std::function<void(Interpreter*)> warm_up = nullptr);
+
+    InterpreterPool(const InterpreterPool&) = delete;
+    InterpreterPool& operator=(const InterpreterPool&) = delete;
+    /// дожидается всех принятых запросов
+    ~InterpreterPool();
+
+    /// false, если очередь полна: вызывающий сам решает, ждать или отказать клиенту
+    bool TrySubmit(std::string expression, std::function<void(PoolResponse)> done);
+    /// ждёт места в очереди
+    void Submit(std::string expression, std::function<void(PoolResponse)> done);
+
+    size_t GetWorkerCount() const {
+        return workers_.size();
+    }
+
+protected:
+    bool TryPush(PoolRequest* request);
+    /// исполняет всё, что уже в очереди, и останавливает воркеры
+    void Stop();
+    void WorkerLoop(Interpreter* interpreter);
+    static PoolResponse Execute(Interpreter* interpreter, const PoolRequest& request);
+
+protected:
+    MpmcQueue<PoolRequest> queue_;
+    /// счётчики для ожидания через atomic::wait: воркер спит на pushed_, Submit - на popped_
+    std::atomic<uint32_t> pushed_ = 0;
+    std::atomic<uint32_t> popped_ = 0;
+    std::atomic<bool> stopping_ = false;
+    std::vector<std::thread> workers_;
+};
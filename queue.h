@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+/// Ограниченная очередь без блокировок для многих писателей и многих читателей (схема
+/// Вьюкова). У каждой ячейки есть номер хода sequence: ячейка свободна для записи с
+/// номером pos, когда sequence == pos, и готова для чтения, когда sequence == pos + 1.
+/// Писатели и читатели конкурируют только за свой счётчик, очередь полна - TryPush
+/// возвращает false, и что делать дальше, решает вызывающий.
+template <class T>
+class MpmcQueue {
+public:
+    /// capacity - степень двойки
+    explicit MpmcQueue(size_t capacity) : mask_(capacity - 1), cells_(new Cell[capacity]) {
+        if (capacity == 0 || (capacity & mask_) != 0) {
+            throw std::invalid_argument("queue capacity must be a power of two");
+        }
+        for (size_t i = 0; i < capacity; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    size_t GetCapacity() const {
+        return mask_ + 1;
+    }
+
+    /// при неудаче value не тронуто
+    bool TryPush(T& value) {
+        size_t position = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[position & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto lag = static_cast<std::ptrdiff_t>(sequence - position);
+            if (lag == 0) {
+                if (tail_.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                return false;
+            } else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value.emplace(std::move(value));
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> TryPop() {
+        size_t position = head_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[position & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto lag = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+            if (lag == 0) {
+                if (head_.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                return std::nullopt;
+            } else {
+                position = head_.load(std::memory_order_relaxed);
+            }
+        }
+        std::optional<T> result = std::move(cell->value);
+        cell->value.reset();
+        cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+        return result;
+    }
+
+protected:
+    static constexpr size_t kCacheLine = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::optional<T> value;
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    /// счётчики на разных линиях кэша, чтобы писатели не мешали читателям
+    alignas(kCacheLine) std::atomic<size_t> tail_ = 0;
+    alignas(kCacheLine) std::atomic<size_t> head_ = 0;
+};
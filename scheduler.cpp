@@ -0,0 +1,167 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+/// воркер, которым является текущий поток, и глубина вложенности задач
+static thread_local WorkStealingPool* current_pool = nullptr;
+static thread_local size_t current_index = 0;
+static thread_local size_t task_depth = 0;
+
+WorkStealingPool::WorkStealingPool(size_t workers) {
+    for (size_t i = 0; i < workers; ++i) {
+        queues_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this, i] { WorkerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    stopping_.store(true);
+    epoch_.fetch_add(1);
+    epoch_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+WorkStealingPool& WorkStealingPool::Global() {
+    // не разрушается: воркеры могут быть заняты, когда уже разрушаются статики
+    static auto* pool =
+        new WorkStealingPool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return *pool;
+}
+
+bool WorkStealingPool::IsInsideTask() {
+    return task_depth > 0;
+}
+
+void WorkStealingPool::Submit(Task task) {
+    Worker& queue = current_pool == this ? *queues_[current_index] : injected_;
+    {
+        std::lock_guard lock{queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    }
+    epoch_.fetch_add(1, std::memory_order_release);
+    epoch_.notify_one();
+}
+
+bool WorkStealingPool::RunPending() {
+    Task task;
+    if (!TakeTask(&task)) {
+        return false;
+    }
+    Execute(&task);
+    return true;
+}
+
+bool WorkStealingPool::TakeTask(Task* task) {
+    if (current_pool == this) {
+        Worker& own = *queues_[current_index];
+        std::lock_guard lock{own.mutex};
+        if (!own.tasks.empty()) {
+            *task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    auto steal = [task](Worker* victim) {
+        std::lock_guard lock{victim->mutex};
+        if (victim->tasks.empty()) {
+            return false;
+        }
+        *task = std::move(victim->tasks.front());
+        victim->tasks.pop_front();
+        return true;
+    };
+    if (steal(&injected_)) {
+        return true;
+    }
+    // начинаем с соседа, чтобы воры не толпились у первого воркера
+    size_t start = current_pool == this ? current_index + 1 : 0;
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        if (steal(queues_[(start + i) % queues_.size()].get())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+WorkStealingPool::TaskScope::TaskScope() {
+    ++task_depth;
+}
+
+WorkStealingPool::TaskScope::~TaskScope() {
+    --task_depth;
+}
+
+void WorkStealingPool::Execute(Task* task) {
+    TaskScope scope;
+    (*task)();
+}
+
+void WorkStealingPool::WorkerLoop(size_t index) {
+    current_pool = this;
+    current_index = index;
+    while (true) {
+        // epoch читается до поиска: задача, пришедшая после неудачного поиска, не
+        // даст уснуть
+        uint32_t seen = epoch_.load(std::memory_order_acquire);
+        if (RunPending()) {
+            continue;
+        }
+        if (stopping_.load()) {
+            return;
+        }
+        epoch_.wait(seen);
+    }
+}
+
+TaskGroup::TaskGroup(WorkStealingPool* pool) : pool_(pool), state_(std::make_shared<State>()) {
+}
+
+TaskGroup::~TaskGroup() {
+    WaitForTasks();
+}
+
+void TaskGroup::Run(std::function<void()> task) {
+    state_->pending.fetch_add(1);
+    pool_->Submit([state = state_, task = std::move(task)] {
+        if (!state->cancelled.load(std::memory_order_relaxed)) {
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard lock{state->mutex};
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+                state->cancelled.store(true);
+            }
+        }
+        state->pending.fetch_sub(1, std::memory_order_release);
+        state->pending.notify_all();
+    });
+}
+
+void TaskGroup::Wait() {
+    WaitForTasks();
+    std::lock_guard lock{state_->mutex};
+    if (auto error = std::exchange(state_->error, nullptr)) {
+        state_->cancelled.store(false);
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskGroup::WaitForTasks() {
+    while (true) {
+        uint32_t pending = state_->pending.load(std::memory_order_acquire);
+        if (pending == 0) {
+            return;
+        }
+        // пока своих задач нет в деках, помогаем с любыми
+        if (!pool_->RunPending()) {
+            state_->pending.wait(pending);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Пул потоков с перехватом работы. У каждого воркера своя дека: свои задачи он берёт с
+/// конца, свободные воркеры крадут с начала - там самые старые задачи, при рекурсивном
+/// делении диапазона они же самые крупные. Дека под своим mutex-ом, но его берут только
+/// владелец и изредка вор, так что ожидания на нём почти нет. Задачи из потоков вне пула
+/// попадают в общую очередь.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t workers);
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    /// задачи, которые ещё в деках, не выполняются
+    ~WorkStealingPool();
+
+    /// Один пул на программу: воркеров на один меньше, чем ядер, последнее ядро - у
+    /// потока, который ждёт в TaskGroup::Wait и сам выполняет задачи
+    static WorkStealingPool& Global();
+
+    size_t GetWorkerCount() const {
+        return workers_.size();
+    }
+
+    void Submit(Task task);
+    /// выполняет одну задачу из пула в текущем потоке; false, если брать нечего
+    bool RunPending();
+
+    /// текущий поток выполняет задачу какого-нибудь пула
+    static bool IsInsideTask();
+    /// для работы, которая считается задачей пула, даже если её выполнили не из пула
+    class TaskScope {
+    public:
+        TaskScope();
+        TaskScope(const TaskScope&) = delete;
+        TaskScope& operator=(const TaskScope&) = delete;
+        ~TaskScope();
+    };
+
+protected:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool TakeTask(Task* task);
+    void Execute(Task* task);
+    void WorkerLoop(size_t index);
+
+protected:
+    std::vector<std::unique_ptr<Worker>> queues_;
+    Worker injected_;
+    std::atomic<uint32_t> epoch_ = 0;
+    std::atomic<bool> stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+/// Группа задач fork-join. Wait не просто спит, а выполняет задачи пула, поэтому
+/// группа, запущенная из задачи, не занимает воркер впустую и не может повиснуть.
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkStealingPool* pool);
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    /// дожидается задач, но их исключения теряет
+    ~TaskGroup();
+
+    void Run(std::function<void()> task);
+    /// бросает первое исключение из задач группы
+    void Wait();
+
+    /// после исключения в одной задаче остальным уже незачем работать
+    bool IsCancelled() const {
+        return state_->cancelled.load(std::memory_order_relaxed);
+    }
+
+protected:
+    /// задачи держат состояние сами: последняя может будить Wait уже после его возврата
+    struct State {
+        std::atomic<uint32_t> pending = 0;
+        std::atomic<bool> cancelled = false;
+        std::mutex mutex;
+        std::exception_ptr error;
+    };
+
+    void WaitForTasks();
+
+protected:
+    WorkStealingPool* pool_;
+    std::shared_ptr<State> state_;
+};
@@ -1,581 +1,870 @@
 #include "scheme.h"
 
+#include <charconv>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 #include "algorithm"
+#include "future.h"
+#include "image.h"
 #include "object.h"
 #include "parser.h"
-#include "sstream"
+#include "scheduler.h"
+#include "serialize.h"
 #include "tokenizer.h"
 
-std::string Interpreter::Run(const std::string& line) {
-    std::stringstream stream{line};
-    Tokenizer tokenizer{&stream};
+Interpreter::Interpreter(Engine engine)
+    : engine_(engine),
+      analyzer_(&global_scope_, &collector_),
+      compiler_(&global_scope_, &collector_) {
+    for (const auto& [name, function] : name_to_function) {
+        global_scope_.Define(Symbol::Intern(name)->GetId(), function);
+    }
+}
 
-    auto input_ast = ReadAll(&tokenizer);
+Interpreter::~Interpreter() {
+    // значения наружу не уходят, так что все оставшиеся циклы можно рвать
+    collector_.ReleaseAll();
+}
 
-    //    auto function = input_ast->GetFirst();
-    //
-    //    auto args = ConvertAndEvalArgsToVector(input_ast->GetSecond());
+size_t Interpreter::CollectGarbage() {
+    return collector_.Collect();
+}
 
-    if (input_ast == nullptr) {
-        throw RuntimeError("input_ast is nullptr");
-    }
-    auto output_ast = input_ast->Eval(&global_scope_);
+/// Есть ли в форме (quote <список>). Такой список - один объект на весь готовый код, и
+/// set-car! на нём был бы виден следующему Run из кэша, а без кэша Read создаёт его заново.
+bool HasQuotedList(const std::shared_ptr<Object>& form) {
+    static const uint32_t kQuote = Symbol::Intern("quote")->GetId();
 
-    return output_ast->ToString();
+    auto cell = As<Cell>(form);
+    if (cell == nullptr) {
+        return false;
+    }
+    if (auto head = As<Symbol>(cell->GetFirst()); head != nullptr && head->GetId() == kQuote) {
+        auto rest = As<Cell>(cell->GetSecond());
+        return rest != nullptr && Is<Cell>(rest->GetFirst());
+    }
+    for (auto current = form; Is<Cell>(current); current = As<Cell>(current)->GetSecond()) {
+        if (HasQuotedList(As<Cell>(current)->GetFirst())) {
+            return true;
+        }
+    }
+    return false;
 }
 
-std::optional<std::shared_ptr<Function>> GetFunction(const std::string& name) {
-    auto it = name_to_function.find(name);
-    if (it == name_to_function.end()) {
-        return std::nullopt;
+std::string Interpreter::Run(const std::string& line) {
+    FormCache::Entry compiled;
+    const FormCache::Entry* entry = form_cache_.Find(line);
+    if (entry == nullptr) {
+        Tokenizer tokenizer{std::string_view(line)};
+        entry = Prepare(line, &tokenizer, &compiled);
     }
-    return name_to_function.at(name);  /// TODO два раза ищу по массиву, не знаю, как лечить
+
+    auto output_ast = Execute(*entry);
+    if (output_ast == nullptr) {
+        return "()";
+    }
+    return output_ast->ToString();
 }
 
-std::shared_ptr<Object> IsNumber::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    if (Is<Cell>(argument)) {
-        if (As<Cell>(argument)->GetSecond() != nullptr) {
-            throw SyntaxError("wrong number parameter in cell");
+namespace {
+
+/// Частые короткие результаты пишутся в output сразу, остальные - через ToString
+void AppendResult(const std::shared_ptr<Object>& object, std::string* output) {
+    if (object == nullptr) {
+        output->append("()");
+    } else if (auto number = As<Number>(object); number != nullptr && number->IsSmall()) {
+        char buffer[24];
+        auto end = std::to_chars(buffer, buffer + sizeof(buffer), number->GetValue()).ptr;
+        output->append(buffer, end);
+    } else if (auto boolean = As<Bool>(object)) {
+        output->append(boolean->GetBoolValue() ? "#t" : "#f");
+    } else if (auto symbol = As<Symbol>(object)) {
+        output->append(symbol->GetName());
+    } else {
+        output->append(object->ToString());
+    }
+}
+
+}  // namespace
+
+void Interpreter::RunBatch(std::span<const std::string_view> expressions, BatchResult* result) {
+    result->output.clear();
+    result->items.clear();
+    result->items.reserve(expressions.size());
+    // токенизатор заводится при первом промахе кэша и дальше только переставляется
+    std::optional<Tokenizer> tokenizer;
+    FormCache::Entry compiled;
+    for (std::string_view text : expressions) {
+        auto offset = result->output.size();
+        auto status = BatchResult::Status::OK;
+        try {
+            const FormCache::Entry* entry = form_cache_.Find(text);
+            if (entry == nullptr) {
+                if (tokenizer) {
+                    tokenizer->Reset(text);
+                } else {
+                    tokenizer.emplace(text);
+                }
+                entry = Prepare(text, &*tokenizer, &compiled);
+            }
+            AppendResult(Execute(*entry), &result->output);
+        } catch (const SyntaxError& error) {
+            status = BatchResult::Status::SYNTAX_ERROR;
+            result->output.resize(offset);
+            result->output.append(error.what());
+        } catch (const NameError& error) {
+            status = BatchResult::Status::NAME_ERROR;
+            result->output.resize(offset);
+            result->output.append(error.what());
+        } catch (const RuntimeError& error) {
+            status = BatchResult::Status::RUNTIME_ERROR;
+            result->output.resize(offset);
+            result->output.append(error.what());
         }
-        return std::make_shared<Bool>(Is<Number>(As<Cell>(argument)->GetFirst()));
+        result->items.push_back({status, static_cast<uint32_t>(offset),
+                                 static_cast<uint32_t>(result->output.size() - offset)});
     }
-    return std::make_shared<Bool>(Is<Number>(argument));
 }
 
-void CheckCellIsValid(std::shared_ptr<Object> cell) {
-    if (!Is<Cell>(cell)) {
-        return;
+Evaluation Interpreter::Start(const std::string& line) {
+    if (engine_ != Engine::BYTECODE) {
+        throw RuntimeError("resumable evaluation needs the bytecode engine");
     }
-    if (As<Cell>(cell)->GetFirst() == nullptr) {
-        throw RuntimeError("CheckCellIsValid error");
+    FormCache::Entry compiled;
+    const FormCache::Entry* entry = form_cache_.Find(line);
+    if (entry == nullptr) {
+        Tokenizer tokenizer{std::string_view(line)};
+        entry = Prepare(line, &tokenizer, &compiled);
     }
+    return Evaluation(entry->prototype);
 }
 
-void ConvertAndEvalArgument(std::shared_ptr<Object> argument,
-                            std::vector<std::shared_ptr<Object>>* arg_vector_ptr, Scope* scope) {
-    if (argument == nullptr) {
-        return;
+Evaluation::Evaluation(const std::shared_ptr<Prototype>& prototype) {
+    vm_.Start(prototype);
+}
+
+bool Evaluation::Resume(uint64_t fuel) {
+    if (state_ != State::RUNNING) {
+        throw RuntimeError("evaluation is already finished");
     }
-    if (!Is<Cell>(argument)) {
-        arg_vector_ptr->push_back(argument);  /// TODO Надо ли тут Eval? попробовать без
-        return;
+    try {
+        if (vm_.Resume(fuel, &result_)) {
+            state_ = State::DONE;
+        }
+    } catch (...) {
+        state_ = State::STOPPED;
+        throw;
     }
-    CheckCellIsValid(argument);
-    if (Is<Function>(As<Cell>(argument)->GetFirst()->Eval(scope))) {
-        arg_vector_ptr->push_back(argument->Eval(scope));
-        return;
+    return state_ == State::DONE;
+}
+
+std::string Evaluation::GetResult() const {
+    if (state_ != State::DONE) {
+        throw RuntimeError("evaluation has no result");
     }
-    ConvertAndEvalArgument(As<Cell>(argument)->GetFirst(), arg_vector_ptr, scope);
-    ConvertAndEvalArgument(As<Cell>(argument)->GetSecond(), arg_vector_ptr, scope);
+    return result_ == nullptr ? "()" : result_->ToString();
 }
 
-std::vector<std::shared_ptr<Object>> ConvertAndEvalArgsToVector(std::shared_ptr<Object> argument,
-                                                                Scope* scope) {
-    std::vector<std::shared_ptr<Object>> converted_args_vector;
-    ConvertAndEvalArgument(argument, &converted_args_vector, scope);
-    return converted_args_vector;
+void Evaluation::Cancel() {
+    vm_.Clear();
+    if (state_ == State::RUNNING) {
+        state_ = State::STOPPED;
+    }
 }
 
-/// TODO кажется это можно переписать через if constexpr или чота такое
-#define CheckArgVectorElementTypes(TargetType)                          \
-    for (const auto& current_arg : arg_vector) {                        \
-        if (!Is<TargetType>(current_arg)) {                             \
-            throw RuntimeError("wrong element types in one operation"); \
-        }                                                               \
+void Interpreter::RunStream(std::istream* in,
+                            const std::function<void(const std::string&)>& sink) {
+    Tokenizer tokenizer{in};
+    while (!tokenizer.IsEnd()) {
+        auto output_ast = Evaluate(Read(&tokenizer));
+        sink(output_ast == nullptr ? "()" : output_ast->ToString());
     }
+}
 
-std::shared_ptr<Object> Equals::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    CheckArgVectorElementTypes(Number);
-    for (size_t i = 1; i < arg_vector.size(); ++i) {
-        if (As<Number>(arg_vector[i - 1])->GetValue() != As<Number>(arg_vector[i])->GetValue()) {
-            return std::make_shared<Bool>(false);
-        }
+void Interpreter::RunProgram(std::string_view program,
+                             const std::function<void(const std::string&)>& sink) {
+    for (ProgramLoader loader(program); !loader.IsEnd();) {
+        auto output_ast = Evaluate(loader.Next());
+        sink(output_ast == nullptr ? "()" : output_ast->ToString());
     }
-    return std::make_shared<Bool>(true);
 }
 
-std::shared_ptr<Object> Less::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    CheckArgVectorElementTypes(Number);
-    for (size_t i = 1; i < arg_vector.size(); ++i) {
-        if (As<Number>(arg_vector[i - 1])->GetValue() >= As<Number>(arg_vector[i])->GetValue()) {
-            return std::make_shared<Bool>(false);
-        }
+void Interpreter::SaveImage(const std::string& path) {
+    auto image = SaveHeap(global_scope_);
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(image.data(), image.size()) || !file.flush()) {
+        throw RuntimeError("cannot write " + path);
     }
-    return std::make_shared<Bool>(true);
 }
 
-std::shared_ptr<Object> Greater::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    CheckArgVectorElementTypes(Number);
-    for (size_t i = 1; i < arg_vector.size(); ++i) {
-        if (As<Number>(arg_vector[i - 1])->GetValue() <= As<Number>(arg_vector[i])->GetValue()) {
-            return std::make_shared<Bool>(false);
-        }
+void Interpreter::LoadImage(const std::string& path) {
+    MappedFile file(path);
+    LoadHeap(file.GetData(), &global_scope_, &analyzer_, &collector_);
+}
+
+std::shared_ptr<Object> Interpreter::Evaluate(const std::shared_ptr<Object>& form) {
+    FormCache::Entry entry;
+    Compile(form, &entry);
+    return Execute(entry);
+}
+
+const FormCache::Entry* Interpreter::Prepare(std::string_view text, Tokenizer* tokenizer,
+                                             FormCache::Entry* compiled) {
+    auto form = ReadAll(tokenizer);
+    Compile(form, compiled);
+    if (!HasQuotedList(form)) {
+        form_cache_.Insert(text, *compiled);
     }
-    return std::make_shared<Bool>(true);
+    return compiled;
 }
 
-std::shared_ptr<Object> LEquals::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    CheckArgVectorElementTypes(Number);
-    for (size_t i = 1; i < arg_vector.size(); ++i) {
-        if (As<Number>(arg_vector[i - 1])->GetValue() > As<Number>(arg_vector[i])->GetValue()) {
-            return std::make_shared<Bool>(false);
-        }
+void Interpreter::Compile(const std::shared_ptr<Object>& form, FormCache::Entry* entry) {
+    if (form == nullptr) {
+        throw RuntimeError("input_ast is nullptr");
+    }
+    if (engine_ == Engine::BYTECODE) {
+        entry->prototype = compiler_.Compile(form);
+    } else {
+        entry->executor = analyzer_.Analyze(form);
     }
-    return std::make_shared<Bool>(true);
 }
 
-std::shared_ptr<Object> GEquals::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    CheckArgVectorElementTypes(Number);
-    for (size_t i = 1; i < arg_vector.size(); ++i) {
-        if (As<Number>(arg_vector[i - 1])->GetValue() < As<Number>(arg_vector[i])->GetValue()) {
-            return std::make_shared<Bool>(false);
-        }
+std::shared_ptr<Object> Interpreter::Execute(const FormCache::Entry& entry) {
+    // запись может вытеснить из кэша, пока код исполняется, поэтому код держим сами
+    if (engine_ == Engine::BYTECODE) {
+        auto prototype = entry.prototype;
+        return vm_.Execute(prototype, nullptr);
     }
-    return std::make_shared<Bool>(true);
+    auto executor = entry.executor;
+    return executor->Execute(nullptr);
 }
 
-std::shared_ptr<Object> Add::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    CheckArgVectorElementTypes(Number);
-    int64_t operation_result = 0;
-    for (auto arg : arg_vector) {
-        operation_result += As<Number>(arg)->GetValue();
+const FormCache::Entry* FormCache::Find(std::string_view text) {
+    auto it = index_.find(text);
+    if (it == index_.end()) {
+        ++stats_.misses;
+        return nullptr;
     }
-    return std::make_shared<Number>(operation_result);
+    ++stats_.hits;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &*it->second;
 }
 
-std::shared_ptr<Object> Subtract::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    CheckArgVectorElementTypes(Number);
-    int64_t operation_result;
-    bool reached_first_num = false;
-    for (auto arg : arg_vector) {
-        if (!reached_first_num) {
-            operation_result = As<Number>(arg)->GetValue();
-            reached_first_num = true;
-            continue;
-        }
-        operation_result -= As<Number>(arg)->GetValue();
+void FormCache::Insert(std::string_view text, const Entry& entry) {
+    if (capacity_ == 0) {
+        return;
     }
-    if (!reached_first_num) {
-        throw RuntimeError("need argument in subtract");
+    Shrink(capacity_ - 1);
+    entries_.push_front(entry);
+    entries_.front().text = text;
+    index_.emplace(entries_.front().text, entries_.begin());
+}
+
+void FormCache::SetCapacity(size_t capacity) {
+    capacity_ = capacity;
+    Shrink(capacity_);
+}
+
+void FormCache::Shrink(size_t size) {
+    while (entries_.size() > size) {
+        index_.erase(entries_.back().text);
+        entries_.pop_back();
+        ++stats_.evictions;
     }
-    return std::make_shared<Number>(operation_result);
 }
 
-std::shared_ptr<Object> Multiply::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    CheckArgVectorElementTypes(Number);
-    int64_t operation_result = 1;
-    for (auto arg : arg_vector) {
-        if (!Is<Number>(arg)) {
-            throw RuntimeError("wrong element types in one operation (Add)");
-        }
-        operation_result *= As<Number>(arg)->GetValue();
+std::shared_ptr<Object> IsNumber::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 1) {
+        throw RuntimeError("incorrect argument number in IsNumber");
     }
-    return std::make_shared<Number>(operation_result);
+    return Apply1(arg_vector[0]);
 }
 
-std::shared_ptr<Object> Divide::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    CheckArgVectorElementTypes(Number);
-    int64_t operation_result;
-    bool reached_first_num = false;
-    for (auto arg : arg_vector) {
-        if (!reached_first_num) {
-            operation_result = As<Number>(arg)->GetValue();
-            reached_first_num = true;
-            continue;
-        }
-        operation_result /= As<Number>(arg)->GetValue();
+std::shared_ptr<Object> IsNumber::Apply1(const std::shared_ptr<Object>& argument) {
+    return Bool::Make(Is<Number>(argument));
+}
+
+/// TODO кажется это можно переписать через if constexpr или чота такое
+#define CheckArgVectorElementTypes(TargetType)                          \
+    for (const auto& current_arg : arg_vector) {                        \
+        if (!Is<TargetType>(current_arg)) {                             \
+            throw RuntimeError("wrong element types in one operation"); \
+        }                                                               \
     }
-    if (!reached_first_num) {
-        throw RuntimeError("need argument in divide");
+
+/// значение аргумента для Apply1/Apply2, ошибка та же, что у CheckArgVectorElementTypes
+const Number& GetNumberArgument(const std::shared_ptr<Object>& argument) {
+    auto number = As<Number>(argument);
+    if (number == nullptr) {
+        throw RuntimeError("wrong element types in one operation");
     }
-    return std::make_shared<Number>(operation_result);
+    return *number;
 }
 
-std::shared_ptr<Object> Max::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
+/// Проверка цепочки a1 ? a2 ? ...: holds получает результат CompareNumbers соседей
+template <class Predicate>
+std::shared_ptr<Object> CompareChain(Arguments arg_vector, Predicate holds) {
     CheckArgVectorElementTypes(Number);
-    int64_t operation_result;
-    bool reached_first_num = false;
-    for (auto arg : arg_vector) {
-        if (!reached_first_num) {
-            reached_first_num = true;
-            operation_result = As<Number>(arg)->GetValue();
-            continue;
+    for (size_t i = 1; i < arg_vector.size(); ++i) {
+        if (!holds(CompareNumbers(*As<Number>(arg_vector[i - 1]), *As<Number>(arg_vector[i])))) {
+            return Bool::Make(false);
         }
-        operation_result = std::max(operation_result, As<Number>(arg)->GetValue());
     }
-    if (!reached_first_num) {
-        throw RuntimeError("need argument in max");
+    return Bool::Make(true);
+}
+
+/// Свёртка для + - *: пока результат помещается в int64_t, она идёт без выделений памяти,
+/// с первого переполнения или большого аргумента - в BigInteger. overflows - одна из
+/// __builtin_*_overflow.
+template <class Overflows, class BigOperation>
+std::shared_ptr<Object> FoldNumbers(int64_t initial, Arguments arg_vector, Overflows overflows,
+                                    BigOperation big_operation) {
+    int64_t small_result = initial;
+    size_t i = 0;
+    for (; i < arg_vector.size(); ++i) {
+        auto number = As<Number>(arg_vector[i]);
+        int64_t next;
+        if (!number->IsSmall() || overflows(small_result, number->GetValue(), &next)) {
+            break;
+        }
+        small_result = next;
     }
-    return std::make_shared<Number>(operation_result);
+    if (i == arg_vector.size()) {
+        return Number::Make(small_result);
+    }
+    BigInteger result(small_result);
+    BigInteger storage;
+    for (; i < arg_vector.size(); ++i) {
+        result = big_operation(result, As<Number>(arg_vector[i])->GetBigInteger(&storage));
+    }
+    return Number::Make(std::move(result));
+}
+
+std::shared_ptr<Object> Equals::Apply(Arguments arg_vector) {
+    return CompareChain(arg_vector, [](int order) { return order == 0; });
+}
+
+std::shared_ptr<Object> Equals::Apply2(const std::shared_ptr<Object>& first,
+                                    const std::shared_ptr<Object>& second) {
+    return Bool::Make(CompareNumbers(GetNumberArgument(first), GetNumberArgument(second)) == 0);
+}
+
+std::shared_ptr<Object> Less::Apply(Arguments arg_vector) {
+    return CompareChain(arg_vector, [](int order) { return order < 0; });
+}
+
+std::shared_ptr<Object> Less::Apply2(const std::shared_ptr<Object>& first,
+                                    const std::shared_ptr<Object>& second) {
+    return Bool::Make(CompareNumbers(GetNumberArgument(first), GetNumberArgument(second)) < 0);
+}
+
+std::shared_ptr<Object> Greater::Apply(Arguments arg_vector) {
+    return CompareChain(arg_vector, [](int order) { return order > 0; });
+}
+
+std::shared_ptr<Object> Greater::Apply2(const std::shared_ptr<Object>& first,
+                                    const std::shared_ptr<Object>& second) {
+    return Bool::Make(CompareNumbers(GetNumberArgument(first), GetNumberArgument(second)) > 0);
+}
+
+std::shared_ptr<Object> LEquals::Apply(Arguments arg_vector) {
+    return CompareChain(arg_vector, [](int order) { return order <= 0; });
+}
+
+std::shared_ptr<Object> LEquals::Apply2(const std::shared_ptr<Object>& first,
+                                    const std::shared_ptr<Object>& second) {
+    return Bool::Make(CompareNumbers(GetNumberArgument(first), GetNumberArgument(second)) <= 0);
+}
+
+std::shared_ptr<Object> GEquals::Apply(Arguments arg_vector) {
+    return CompareChain(arg_vector, [](int order) { return order >= 0; });
+}
+
+std::shared_ptr<Object> GEquals::Apply2(const std::shared_ptr<Object>& first,
+                                    const std::shared_ptr<Object>& second) {
+    return Bool::Make(CompareNumbers(GetNumberArgument(first), GetNumberArgument(second)) >= 0);
 }
 
-std::shared_ptr<Object> Min::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
+std::shared_ptr<Object> Add::Apply(Arguments arg_vector) {
     CheckArgVectorElementTypes(Number);
-    int64_t operation_result;
-    bool reached_first_num = false;
-    for (auto arg : arg_vector) {
-        if (!reached_first_num) {
-            reached_first_num = true;
-            operation_result = As<Number>(arg)->GetValue();
-            continue;
-        }
-        operation_result = std::min(operation_result, As<Number>(arg)->GetValue());
+    return FoldNumbers(
+        0, arg_vector,
+        [](int64_t lhs, int64_t rhs, int64_t* result) {
+            return __builtin_add_overflow(lhs, rhs, result);
+        },
+        [](const BigInteger& lhs, const BigInteger& rhs) { return lhs + rhs; });
+}
+
+std::shared_ptr<Object> Add::Apply2(const std::shared_ptr<Object>& first,
+                                    const std::shared_ptr<Object>& second) {
+    return AddNumbers(GetNumberArgument(first), GetNumberArgument(second));
+}
+
+std::shared_ptr<Object> Subtract::Apply(Arguments arg_vector) {
+    CheckArgVectorElementTypes(Number);
+    if (arg_vector.empty()) {
+        throw RuntimeError("need argument in subtract");
     }
-    if (!reached_first_num) {
-        throw RuntimeError("need argument in min");
+    const auto& first = *As<Number>(arg_vector[0]);
+    if (!first.IsSmall()) {
+        auto result = AsShared<Number>(arg_vector[0]);
+        for (const auto& arg : arg_vector.subspan(1)) {
+            result = SubtractNumbers(*result, *As<Number>(arg));
+        }
+        return result;
     }
-    return std::make_shared<Number>(operation_result);
+    return FoldNumbers(
+        first.GetValue(), arg_vector.subspan(1),
+        [](int64_t lhs, int64_t rhs, int64_t* result) {
+            return __builtin_sub_overflow(lhs, rhs, result);
+        },
+        [](const BigInteger& lhs, const BigInteger& rhs) { return lhs - rhs; });
+}
+
+std::shared_ptr<Object> Subtract::Apply2(const std::shared_ptr<Object>& first,
+                                    const std::shared_ptr<Object>& second) {
+    return SubtractNumbers(GetNumberArgument(first), GetNumberArgument(second));
 }
 
-std::shared_ptr<Object> Abs::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
+std::shared_ptr<Object> Multiply::Apply(Arguments arg_vector) {
     CheckArgVectorElementTypes(Number);
-    if (arg_vector.size() > 1 || arg_vector.empty()) {
-        throw RuntimeError("incorrect argument number in abs");
-    }
-    return std::make_shared<Number>(std::abs(As<Number>(arg_vector[0])->GetValue()));
+    return FoldNumbers(
+        1, arg_vector,
+        [](int64_t lhs, int64_t rhs, int64_t* result) {
+            return __builtin_mul_overflow(lhs, rhs, result);
+        },
+        [](const BigInteger& lhs, const BigInteger& rhs) { return lhs * rhs; });
 }
 
-bool CellIsNumPair(std::shared_ptr<Object> argument) {
-    std::shared_ptr<Object> first = As<Cell>(argument)->GetFirst();
-    std::shared_ptr<Object> second = As<Cell>(argument)->GetSecond();
-    return Is<Number>(first) && Is<Number>(second) && first != nullptr && second != nullptr;
+std::shared_ptr<Object> Multiply::Apply2(const std::shared_ptr<Object>& first,
+                                    const std::shared_ptr<Object>& second) {
+    return MultiplyNumbers(GetNumberArgument(first), GetNumberArgument(second));
 }
 
-void ConvertArgument(std::shared_ptr<Object> argument,
-                     std::vector<std::shared_ptr<Object>>* arg_vector_ptr) {
-    if (argument == nullptr) {
-        return;
+std::shared_ptr<Object> Divide::Apply(Arguments arg_vector) {
+    CheckArgVectorElementTypes(Number);
+    if (arg_vector.empty()) {
+        throw RuntimeError("need argument in divide");
     }
-    if (!Is<Cell>(argument)) {
-        arg_vector_ptr->push_back(argument);
-        return;
+    auto result = AsShared<Number>(arg_vector[0]);
+    for (const auto& arg : arg_vector.subspan(1)) {
+        result = DivideNumbers(*result, *As<Number>(arg));
     }
+    return result;
+}
 
-    if (CellIsNumPair(argument)) {
-        arg_vector_ptr->push_back(std::make_shared<NumPair>(As<Cell>(argument)));
-        return;
+std::shared_ptr<Object> Max::Apply(Arguments arg_vector) {
+    CheckArgVectorElementTypes(Number);
+    if (arg_vector.empty()) {
+        throw RuntimeError("need argument in max");
     }
-    ConvertArgument(As<Cell>(argument)->GetFirst(), arg_vector_ptr);
-    ConvertArgument(As<Cell>(argument)->GetSecond(), arg_vector_ptr);
+    auto result = arg_vector[0];
+    for (const auto& arg : arg_vector.subspan(1)) {
+        if (CompareNumbers(*As<Number>(arg), *As<Number>(result)) > 0) {
+            result = arg;
+        }
+    }
+    return result;
 }
 
-std::vector<std::shared_ptr<Object>> ConvertArgsToVector(std::shared_ptr<Object> argument) {
-    std::vector<std::shared_ptr<Object>> converted_args_vector;
-    ConvertArgument(argument, &converted_args_vector);
-    return converted_args_vector;
+std::shared_ptr<Object> Min::Apply(Arguments arg_vector) {
+    CheckArgVectorElementTypes(Number);
+    if (arg_vector.empty()) {
+        throw RuntimeError("need argument in min");
+    }
+    auto result = arg_vector[0];
+    for (const auto& arg : arg_vector.subspan(1)) {
+        if (CompareNumbers(*As<Number>(arg), *As<Number>(result)) < 0) {
+            result = arg;
+        }
+    }
+    return result;
 }
 
-std::shared_ptr<Object> Quote::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    if (argument == nullptr) {
-        return std::make_shared<Symbol>("()");
-    }
-    if (!Is<Cell>(argument)) {
-        return std::make_shared<Symbol>(argument->ToString());
+std::shared_ptr<Object> Abs::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 1) {
+        throw RuntimeError("incorrect argument number in abs");
     }
+    return Apply1(arg_vector[0]);
+}
 
-    auto arg_vector = ConvertArgsToVector(argument);
-    std::string operation_result_str = "(";
-    /// TODO сомнительная часть кода
-    try {
-        CheckCellIsValid(As<Cell>(argument));
-    } catch (RuntimeError) {
-        operation_result_str += "()";
-    } catch (...) {
-        throw RuntimeError("undefined error in quote");
-    }
-    /// сомнительная часть окончена
-    for (size_t i = 0; i < arg_vector.size(); ++i) {
-        if (Is<Cell>(arg_vector[i])) {
-            operation_result_str += Quote::Apply(arg_vector[i], scope)->ToString();
-        } else {
-            operation_result_str += arg_vector[i]->ToString();
-            if (i != arg_vector.size() - 1) {
-                operation_result_str += ' ';
-            }
-        }
+std::shared_ptr<Object> Abs::Apply1(const std::shared_ptr<Object>& argument) {
+    const auto& number = GetNumberArgument(argument);
+    if (!number.IsNegative()) {
+        return argument;
     }
-    operation_result_str += ')';
-    return std::make_shared<Symbol>(operation_result_str);
+    return SubtractNumbers(*Number::Make(0), number);
 }
 
-std::shared_ptr<Object> IsBool::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    if (arg_vector.size() > 1 || arg_vector.empty()) {
+std::shared_ptr<Object> IsBool::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 1) {
         throw RuntimeError("incorrect argument number in IsBool");
     }
-    return std::make_shared<Bool>(Is<Bool>(arg_vector[0]));
+    return Apply1(arg_vector[0]);
 }
 
-bool GetBoolValueFromAnyType(std::shared_ptr<Object> argument) {
+std::shared_ptr<Object> IsBool::Apply1(const std::shared_ptr<Object>& argument) {
+    return Bool::Make(Is<Bool>(argument));
+}
+
+bool GetBoolValueFromAnyType(const std::shared_ptr<Object>& argument) {
     if (Is<Bool>(argument)) {
         return As<Bool>(argument)->GetBoolValue();
     }
     return true;
 }
 
-std::shared_ptr<Object> Not::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    if (arg_vector.size() > 1 || arg_vector.empty()) {
+std::shared_ptr<Object> Not::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 1) {
         throw RuntimeError("incorrect argument number in Not");
     }
-    return std::make_shared<Bool>(!GetBoolValueFromAnyType(arg_vector[0]));
+    return Apply1(arg_vector[0]);
 }
 
-void ConvertCompactArgument(std::shared_ptr<Object> argument,
-                            std::vector<std::shared_ptr<Object>>* arg_vector_ptr) {
+std::shared_ptr<Object> Not::Apply1(const std::shared_ptr<Object>& argument) {
+    return Bool::Make(!GetBoolValueFromAnyType(argument));
+}
 
-    if (!Is<Cell>(argument)) {
-        arg_vector_ptr->push_back(argument);
-        return;
-    }
-    auto first = As<Cell>(argument)->GetFirst();
-    arg_vector_ptr->push_back(first);
-    if (As<Cell>(argument)->GetSecond() == nullptr) {
-        return;
+const std::shared_ptr<Object>& GetSingleArgument(Arguments arg_vector, const char* function_name) {
+    if (arg_vector.size() != 1) {
+        throw RuntimeError(std::string("incorrect argument number in ") + function_name);
     }
-    ConvertCompactArgument(As<Cell>(argument)->GetSecond(), arg_vector_ptr);
+    return arg_vector[0];
 }
 
-std::vector<std::shared_ptr<Object>> ConvertCompactArgsToVector(std::shared_ptr<Object> argument) {
-    std::vector<std::shared_ptr<Object>> arg_vector;
-    ConvertCompactArgument(argument, &arg_vector);
-    return arg_vector;
+Cell* GetPairArgument(const std::shared_ptr<Object>& argument, const char* function_name) {
+    auto pair = As<Cell>(argument);
+    if (pair == nullptr) {
+        throw RuntimeError(std::string("need a pair in ") + function_name);
+    }
+    return pair;
 }
 
-std::shared_ptr<Object> And::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertCompactArgsToVector(argument);
-    if (arg_vector.size() <= 1) {
-        return std::make_shared<Bool>(true);
+/// идёт по cdr от list ровно position раз, хвост не копируется
+std::shared_ptr<Object> SkipListElements(std::shared_ptr<Object> list, std::shared_ptr<Object> position,
+                                         const char* function_name) {
+    auto number = As<Number>(position);
+    if (number == nullptr || number->IsNegative()) {
+        throw RuntimeError(std::string("position should be a non-negative number in ") +
+                           function_name);
     }
-    for (auto& arg : arg_vector) {
-        arg = arg->Eval(scope);
-        if (!GetBoolValueFromAnyType(arg)) {
-            return arg;
+    // большое число заведомо длиннее любого списка в памяти
+    int64_t count = number->IsSmall() ? number->GetValue() : INT64_MAX;
+    for (int64_t i = count; i > 0; --i) {
+        if (!Is<Cell>(list)) {
+            throw RuntimeError(std::string("position is bigger than list size in ") +
+                               function_name);
         }
+        list = As<Cell>(list)->GetSecond();
     }
-    return arg_vector.back();
+    return list;
 }
 
-std::shared_ptr<Object> Or::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertCompactArgsToVector(argument);
-    if (arg_vector.size() <= 1) {
-        return std::make_shared<Bool>(false);
-    }
-    for (auto& arg : arg_vector) {
-        arg = arg->Eval(scope);
-        if (GetBoolValueFromAnyType(arg)) {
-            return arg;
-        }
-    }
-    return arg_vector.back();
+std::shared_ptr<Object> IsPair::Apply(Arguments arg_vector) {
+    return Apply1(GetSingleArgument(arg_vector, "pair?"));
 }
 
-std::shared_ptr<Object> UnpackLine(std::shared_ptr<Object> argument) {
-    if (!Is<Symbol>(argument)) {
-        throw RuntimeError("cannot unpack not a symbol");
-    }
-    std::stringstream stream{As<Symbol>(argument)->ToString()};
-    Tokenizer tokenizer{&stream};
-    return ReadAll(&tokenizer);
+std::shared_ptr<Object> IsPair::Apply1(const std::shared_ptr<Object>& argument) {
+    return Bool::Make(Is<Cell>(argument));
 }
 
-/// договорились, что на вход на приходит Cell
-std::shared_ptr<Object> IsPair::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto packed_arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    std::shared_ptr<Object> unpacked_argument = UnpackLine(packed_arg_vector[0]);
-    auto unpacked_arg_vector = ConvertAndEvalArgsToVector(unpacked_argument, scope);
-    if (unpacked_arg_vector.size() == 2) {
-        for (auto arg : unpacked_arg_vector) {
-            if (!Is<Number>(arg)) {
-                return std::make_shared<Bool>(false);
-            }
-        }
-        return std::make_shared<Bool>(true);
-    }
-    return std::make_shared<Bool>(false);
+std::shared_ptr<Object> IsNull::Apply(Arguments arg_vector) {
+    return Apply1(GetSingleArgument(arg_vector, "null?"));
 }
 
-std::shared_ptr<Object> IsNull::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto packed_arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    std::shared_ptr<Object> unpacked_argument = UnpackLine(packed_arg_vector[0]);
-    auto unpacked_arg_vector = ConvertAndEvalArgsToVector(unpacked_argument, scope);
-    return std::make_shared<Bool>(unpacked_arg_vector.empty());
+std::shared_ptr<Object> IsNull::Apply1(const std::shared_ptr<Object>& argument) {
+    return Bool::Make(argument == nullptr);
 }
 
-/// TODO перепиши
-std::shared_ptr<Object> IsList::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto packed_arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    std::shared_ptr<Object> unpacked_argument = UnpackLine(packed_arg_vector[0]);
-    if (unpacked_argument == nullptr) {
-        return std::make_shared<Bool>(true);
-    }
-    int counter = 0;
-    while (counter <= 100) {
-        ++counter;
-        if (!Is<Cell>(unpacked_argument)) {
-            return std::make_shared<Bool>(false);
+std::shared_ptr<Object> IsList::Apply(Arguments arg_vector) {
+    // fast идёт в два раза быстрее slow, так что на циклическом списке они встретятся
+    std::shared_ptr<Object> slow = GetSingleArgument(arg_vector, "list?");
+    std::shared_ptr<Object> fast = slow;
+    while (Is<Cell>(fast)) {
+        fast = As<Cell>(fast)->GetSecond();
+        if (!Is<Cell>(fast)) {
+            break;
         }
-        if (As<Cell>(unpacked_argument)->GetSecond() == nullptr) {
-            return std::make_shared<Bool>(true);
+        fast = As<Cell>(fast)->GetSecond();
+        slow = As<Cell>(slow)->GetSecond();
+        if (fast == slow) {
+            return Bool::Make(false);
         }
-        unpacked_argument = As<Cell>(unpacked_argument)->GetSecond();
     }
-    throw RuntimeError("Undefined IsList error");
+    return Bool::Make(fast == nullptr);
 }
 
-std::shared_ptr<Object> Cons::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
+std::shared_ptr<Object> Cons::Apply(Arguments arg_vector) {
     if (arg_vector.size() != 2) {
         throw RuntimeError("Undefined cons behaviour");
     }
-    return std::make_shared<Symbol>('(' + arg_vector[0]->ToString() + " . " +
-                                    arg_vector[1]->ToString() + ')');
+    return Apply2(arg_vector[0], arg_vector[1]);
 }
 
-std::shared_ptr<Object> Car::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto packed_arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    std::shared_ptr<Object> unpacked_argument = UnpackLine(packed_arg_vector[0]);
-    if (unpacked_argument == nullptr) {
-        throw RuntimeError("car to empty cell");
-    }
-    return std::make_shared<Cell>(std::make_shared<Symbol>("quote"),
-                                  As<Cell>(unpacked_argument)->GetFirst())
-        ->Eval(scope);
+std::shared_ptr<Object> Cons::Apply2(const std::shared_ptr<Object>& first,
+                                     const std::shared_ptr<Object>& second) {
+    return Cell::Make(first, second);
 }
 
-std::shared_ptr<Object> Cdr::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto packed_arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    std::shared_ptr<Object> unpacked_argument = UnpackLine(packed_arg_vector[0]);
-    if (unpacked_argument == nullptr) {
-        throw RuntimeError("cdr to empty cell");
-    }
-    if (As<Cell>(unpacked_argument)->GetSecond() == nullptr) {
-        return std::make_shared<Symbol>("()");
-    } else {
-        return std::make_shared<Cell>(std::make_shared<Symbol>("quote"),
-                                      As<Cell>(unpacked_argument)->GetSecond())
-            ->Eval(scope);
+std::shared_ptr<Object> Car::Apply(Arguments arg_vector) {
+    return Apply1(GetSingleArgument(arg_vector, "car"));
+}
+
+std::shared_ptr<Object> Car::Apply1(const std::shared_ptr<Object>& argument) {
+    return GetPairArgument(argument, "car")->GetFirst();
+}
+
+std::shared_ptr<Object> Cdr::Apply(Arguments arg_vector) {
+    return Apply1(GetSingleArgument(arg_vector, "cdr"));
+}
+
+std::shared_ptr<Object> Cdr::Apply1(const std::shared_ptr<Object>& argument) {
+    return GetPairArgument(argument, "cdr")->GetSecond();
+}
+
+std::shared_ptr<Object> MakeList::Apply(Arguments arg_vector) {
+    std::shared_ptr<Object> list = nullptr;
+    for (auto it = arg_vector.rbegin(); it != arg_vector.rend(); ++it) {
+        list = Cell::Make(*it, list);
     }
+    return list;
 }
 
-std::shared_ptr<Object> MakeCellFromVector(std::vector<std::shared_ptr<Object>>& arg_vec,
-                                           size_t start = 0) {
-    if (arg_vec.empty()) {
-        return nullptr;
+std::shared_ptr<Object> ListRef::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 2) {
+        throw RuntimeError("incorrect argument number in list-ref");
     }
-    std::shared_ptr<Cell> cell = std::make_shared<Cell>(nullptr, nullptr);
-    std::shared_ptr<Object> current_cell_ptr = cell;
-    for (size_t i = start; i < arg_vec.size(); ++i) {
-        As<Cell>(current_cell_ptr)->SetFirst(arg_vec[i]);
-        if (i == arg_vec.size() - 1) {
-            break;
-        }
-        As<Cell>(current_cell_ptr)->SetSecond(std::make_shared<Cell>(nullptr, nullptr));
-        current_cell_ptr = As<Cell>(current_cell_ptr)->GetSecond();
+    auto tail = SkipListElements(arg_vector[0], arg_vector[1], "list-ref");
+    if (!Is<Cell>(tail)) {
+        throw RuntimeError("position is bigger than list size in list-ref");
     }
-    return cell;
+    return As<Cell>(tail)->GetFirst();
 }
 
-std::shared_ptr<Object> MakeList::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    auto potential_cell = MakeCellFromVector(arg_vector);
-    if (potential_cell == nullptr) {
-        return std::make_shared<Symbol>("()");
-    } else {
-        return std::make_shared<Cell>(std::make_shared<Symbol>("quote"), potential_cell)
-            ->Eval(scope);
+std::shared_ptr<Object> ListTail::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 2) {
+        throw RuntimeError("incorrect argument number in list-tail");
     }
+    return SkipListElements(arg_vector[0], arg_vector[1], "list-tail");
 }
 
-std::shared_ptr<Object> ListRef::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto packed_arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    if (packed_arg_vector.size() <= 1) {
-        throw RuntimeError("undefined ListRef error");
+/// пару, созданную вне задачи, в это же время могут читать другие задачи
+void CheckPairWritable(const Cell& cell) {
+    if (current_task != 0 && cell.GetTask() != current_task) {
+        throw RuntimeError("cannot change a pair of another task inside a parallel task");
     }
-    std::shared_ptr<Object> unpacked_argument = UnpackLine(packed_arg_vector[0]);
-    auto unpacked_arg_vector = ConvertAndEvalArgsToVector(unpacked_argument, scope);
-    size_t position = As<Number>(packed_arg_vector[1])->GetValue();
-    if (position >= unpacked_arg_vector.size()) {
-        throw RuntimeError("position is bigger than arg_vector size in ListRef");
-    }
-    return unpacked_arg_vector[position];
 }
 
-std::shared_ptr<Object> ListTail::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto packed_arg_vector = ConvertAndEvalArgsToVector(argument, scope);
-    if (packed_arg_vector.size() <= 1) {
-        throw RuntimeError("undefined ListRef error");
-    }
-    std::shared_ptr<Object> unpacked_argument = UnpackLine(packed_arg_vector[0]);
-    auto unpacked_arg_vector = ConvertAndEvalArgsToVector(unpacked_argument, scope);
-    size_t position = As<Number>(packed_arg_vector[1])->GetValue();
-    if (position == unpacked_arg_vector.size()) {
-        return std::make_shared<Symbol>("()");
+std::shared_ptr<Object> SetCar::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 2 || !Is<Cell>(arg_vector[0])) {
+        throw RuntimeError("set-car! needs a pair and a value");
     }
-    if (position > unpacked_arg_vector.size()) {
-        throw RuntimeError("position is bigger than arg_vector size in ListTail");
+    CheckPairWritable(*As<Cell>(arg_vector[0]));
+    As<Cell>(arg_vector[0])->SetFirst(arg_vector[1]);
+    return Symbol::Intern("set-car!");
+}
+
+std::shared_ptr<Object> SetCdr::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 2 || !Is<Cell>(arg_vector[0])) {
+        throw RuntimeError("set-cdr! needs a pair and a value");
     }
-    auto tail = MakeCellFromVector(unpacked_arg_vector, position);
-    return std::make_shared<Cell>(std::make_shared<Symbol>("quote"), tail)->Eval(scope);
+    CheckPairWritable(*As<Cell>(arg_vector[0]));
+    As<Cell>(arg_vector[0])->SetSecond(arg_vector[1]);
+    return Symbol::Intern("set-cdr!");
 }
 
-std::shared_ptr<Object> IsSymbol::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    auto arg_vector = ConvertAndEvalArgsToVector(argument, scope);
+std::shared_ptr<Object> IsSymbol::Apply(Arguments arg_vector) {
     if (arg_vector.size() != 1) {
         throw RuntimeError("undefined symbol? error");
     }
-    return std::make_shared<Bool>(Is<Symbol>(arg_vector[0]));
+    return Apply1(arg_vector[0]);
+}
+
+std::shared_ptr<Object> IsSymbol::Apply1(const std::shared_ptr<Object>& argument) {
+    return Bool::Make(Is<Symbol>(argument));
 }
 
-std::shared_ptr<Object> Define::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    if (argument == nullptr) {
-        throw SyntaxError("argument is nullptr in define");
+std::shared_ptr<Object> IsEq::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 2) {
+        throw RuntimeError("undefined eq? error");
+    }
+    return Apply2(arg_vector[0], arg_vector[1]);
+}
+
+std::shared_ptr<Object> IsEq::Apply2(const std::shared_ptr<Object>& first,
+                                     const std::shared_ptr<Object>& second) {
+    // символы интернированы, так что для них хватает сравнения указателей
+    if (first == second) {
+        return Bool::Make(true);
+    }
+    if (Is<Number>(first) && Is<Number>(second)) {
+        return Bool::Make(CompareNumbers(*As<Number>(first), *As<Number>(second)) == 0);
+    }
+    if (Is<Bool>(first) && Is<Bool>(second)) {
+        return Bool::Make(As<Bool>(first)->GetBoolValue() == As<Bool>(second)->GetBoolValue());
+    }
+    return Bool::Make(false);
+}
+
+/// функция и элементы списка - аргументы par-map и par-for-each
+std::vector<std::shared_ptr<Object>> GetParallelList(const std::shared_ptr<Object>& list,
+                                                     const std::string& name) {
+    std::vector<std::shared_ptr<Object>> elements;
+    auto tail = list;
+    for (; Is<Cell>(tail); tail = As<Cell>(tail)->GetSecond()) {
+        elements.push_back(As<Cell>(tail)->GetFirst());
+    }
+    if (tail != nullptr) {
+        throw RuntimeError(name + " needs a proper list");
+    }
+    return elements;
+}
+
+/// Вызывает body(begin, end) на кусках [0, count) в потоках WorkStealingPool::Global.
+/// Пока ParallelFor ждёт, тот же поток считает чужие куски, и стек, на который смотрят
+/// Arguments вызывающего builtin-а, может перевыделиться, так что всё нужное из аргументов
+/// копируется до вызова.
+/// Диапазон делится пополам, пока не станет меньше grain, половины уходят в деку: кто
+/// освободился раньше, крадёт их. Кадры и замыкания, созданные в кусках, сборщик циклов
+/// получает только после того, как все куски посчитаны. Глобальные имена куски читают из
+/// снимка на момент вызова, который делает function.
+template <class Body>
+void ParallelFor(const Function& function, size_t count, Body body) {
+    auto globals = SnapshotGlobalsFor(function);
+    auto& pool = WorkStealingPool::Global();
+    size_t grain = std::max<size_t>(1, count / (8 * (pool.GetWorkerCount() + 1)));
+    std::mutex buffers_mutex;
+    std::vector<TrackBuffer> buffers;
+    auto flush = [&] {
+        for (auto& buffer : buffers) {
+            CycleCollector::Flush(&buffer);
+        }
+    };
+
+    TaskGroup group(&pool);
+    std::function<void(size_t, size_t)> split = [&](size_t begin, size_t end) {
+        while (end - begin > grain) {
+            size_t middle = begin + (end - begin) / 2;
+            group.Run([&split, middle, end] { split(middle, end); });
+            end = middle;
+        }
+        if (group.IsCancelled()) {
+            return;
+        }
+        TrackBuffer buffer;
+        try {
+            EnterTask enter_task(&globals);
+            CycleCollector::DeferTracking defer(&buffer);
+            body(begin, end);
+        } catch (...) {
+            std::lock_guard lock{buffers_mutex};
+            buffers.push_back(std::move(buffer));
+            throw;
+        }
+        std::lock_guard lock{buffers_mutex};
+        buffers.push_back(std::move(buffer));
+    };
+    if (count != 0) {
+        group.Run([&split, count] { split(0, count); });
     }
-    auto cell = As<Cell>(argument);
-    if (!Is<Symbol>(cell->GetFirst())) {
-        throw SyntaxError("define error");
+    try {
+        group.Wait();
+    } catch (...) {
+        flush();
+        throw;
     }
-    std::string variable_name = As<Symbol>(cell->GetFirst())->GetName();
-    auto arg_vector = ConvertAndEvalArgsToVector(cell->GetSecond(), scope);
-    if (arg_vector.size() != 1) {
-        throw SyntaxError("define arg error");
+    flush();
+}
+
+std::shared_ptr<Object> ParMap::Apply(Arguments arg_vector) {
+    auto function = arg_vector.size() == 2 ? AsShared<Function>(arg_vector[0]) : nullptr;
+    if (function == nullptr) {
+        throw RuntimeError("par-map needs a function and a list");
     }
-    auto obj = std::make_shared<Variable>(arg_vector[0]);
-    name_to_function[variable_name] = obj;
-    return std::make_shared<Symbol>("defined!");
+    auto elements = GetParallelList(arg_vector[1], "par-map");
+    std::vector<std::shared_ptr<Object>> results(elements.size());
+    ParallelFor(*function, elements.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            results[i] = function->Apply1(elements[i]);
+        }
+    });
+    std::shared_ptr<Object> list = nullptr;
+    for (auto it = results.rbegin(); it != results.rend(); ++it) {
+        list = Cell::Make(std::move(*it), std::move(list));
+    }
+    return list;
 }
 
-std::shared_ptr<Object> Set::Apply(std::shared_ptr<Object> argument, Scope* scope) {
-    if (argument == nullptr) {
-        throw SyntaxError("argument is nullptr in set");
+std::shared_ptr<Object> ParForEach::Apply(Arguments arg_vector) {
+    auto function = arg_vector.size() == 2 ? AsShared<Function>(arg_vector[0]) : nullptr;
+    if (function == nullptr) {
+        throw RuntimeError("par-for-each needs a function and a list");
     }
-    auto cell = As<Cell>(argument);
-    if (!Is<Symbol>(cell->GetFirst())) {
-        throw SyntaxError("define error");
+    auto elements = GetParallelList(arg_vector[1], "par-for-each");
+    ParallelFor(*function, elements.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            function->Apply1(elements[i]);
+        }
+    });
+    return nullptr;
+}
+
+/// (par-reduce f init list): f должна быть ассоциативной - каждый кусок сворачивается
+/// сам по себе, потом итоги кусков слева направо, начиная с init
+std::shared_ptr<Object> ParReduce::Apply(Arguments arg_vector) {
+    auto function = arg_vector.size() == 3 ? AsShared<Function>(arg_vector[0]) : nullptr;
+    if (function == nullptr) {
+        throw RuntimeError("par-reduce needs a function, an initial value and a list");
+    }
+    auto result = arg_vector[1];
+    auto elements = GetParallelList(arg_vector[2], "par-reduce");
+    std::mutex partials_mutex;
+    std::vector<std::pair<size_t, std::shared_ptr<Object>>> partials;
+    ParallelFor(*function, elements.size(), [&](size_t begin, size_t end) {
+        auto partial = elements[begin];
+        for (size_t i = begin + 1; i < end; ++i) {
+            partial = function->Apply2(partial, elements[i]);
+        }
+        std::lock_guard lock{partials_mutex};
+        partials.emplace_back(begin, std::move(partial));
+    });
+
+    std::sort(partials.begin(), partials.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    for (const auto& [begin, partial] : partials) {
+        result = function->Apply2(result, partial);
     }
-    auto arg_vector = ConvertAndEvalArgsToVector(cell->GetSecond(), scope);
+    return result;
+}
+
+std::shared_ptr<Object> MakeFuture::Apply(Arguments arg_vector) {
     if (arg_vector.size() != 1) {
-        throw SyntaxError("define arg error");
+        throw RuntimeError("make-future needs a procedure without arguments");
     }
-    std::string variable_name = As<Symbol>(cell->GetFirst())->GetName();
-    if (!name_to_function.contains(variable_name)) {
-        throw NameError("invalid symbol to set");
+    return Apply1(arg_vector[0]);
+}
+
+std::shared_ptr<Object> MakeFuture::Apply1(const std::shared_ptr<Object>& argument) {
+    auto thunk = AsShared<Function>(argument);
+    if (thunk == nullptr) {
+        throw RuntimeError("make-future needs a procedure without arguments");
     }
-    auto obj = std::make_shared<Variable>(arg_vector[0]);
-    name_to_function[variable_name] = obj;
-    return std::make_shared<Symbol>("set!");
-}
\ No newline at end of file
+    return Future::Spawn(std::move(thunk));
+}
+
+std::shared_ptr<Object> Touch::Apply(Arguments arg_vector) {
+    if (arg_vector.size() != 1) {
+        throw RuntimeError("incorrect argument number in touch");
+    }
+    return Apply1(arg_vector[0]);
+}
+
+/// как в Multilisp, touch обычного значения возвращает его самого
+std::shared_ptr<Object> Touch::Apply1(const std::shared_ptr<Object>& argument) {
+    auto future = AsShared<Future>(argument);
+    return future != nullptr ? future->Touch() : argument;
+}
@@ -1,12 +1,178 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <list>
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "analyzer.h"
+#include "bytecode.h"
 #include "object.h"
+#include "tokenizer.h"
+
+enum class Engine { ANALYZER, BYTECODE };
+
+struct FormCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+};
+
+/// LRU-кэш Interpreter::Run: текст формы -> результат Analyzer или Compiler для неё.
+/// Глобальные имена в готовом коде - адреса binding-ов, а значения читаются при исполнении,
+/// так что define и set! кэш не портят. Встроенная арифметика байткода защищена guard-ом.
+class FormCache {
+public:
+    struct Entry {
+        std::string text;
+        ExecutorPtr executor;
+        std::shared_ptr<Prototype> prototype;
+    };
+
+    explicit FormCache(size_t capacity) : capacity_(capacity){};
+
+    /// запись для text или nullptr; найденная запись становится самой свежей
+    const Entry* Find(std::string_view text);
+    /// при переполнении вытесняет самую давнюю запись
+    void Insert(std::string_view text, const Entry& entry);
+
+    /// 0 выключает кэш
+    void SetCapacity(size_t capacity);
+    const FormCacheStats& GetStats() const {
+        return stats_;
+    }
+
+protected:
+    void Shrink(size_t size);
+
+protected:
+    size_t capacity_;
+    /// самые свежие спереди; ключи index_ смотрят в text этих записей
+    std::list<Entry> entries_;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+    FormCacheStats stats_;
+};
+
+/// Результаты Interpreter::RunBatch. Тексты всех результатов и ошибок лежат подряд в одной
+/// строке output, items - где чей. Один BatchResult можно отдавать в RunBatch снова и
+/// снова: память output и items при этом не выделяется заново.
+struct BatchResult {
+    enum class Status : uint8_t { OK, SYNTAX_ERROR, NAME_ERROR, RUNTIME_ERROR };
+
+    struct Item {
+        Status status;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    /// результат i-го выражения или текст его ошибки
+    std::string_view Get(size_t i) const {
+        return std::string_view(output).substr(items[i].offset, items[i].size);
+    }
+    bool IsOk(size_t i) const {
+        return items[i].status == Status::OK;
+    }
+
+    std::string output;
+    std::vector<Item> items;
+};
+
+/// Выражение из Interpreter::Start, которое исполняется порциями: хозяин цикла событий
+/// даёт каждому скрипту ограниченное число шагов и между порциями занимается другими.
+/// Состояние - собственный стек VM, так что отложенных вычислений у одного Interpreter
+/// может быть сколько угодно, и Run между порциями тоже можно звать. Interpreter должен
+/// пережить все свои Evaluation.
+class Evaluation {
+public:
+    /// Исполняет не больше fuel вызовов процедур; true, когда выражение вычислено. Ошибка
+    /// выражения бросается отсюда, как из Run, и заканчивает вычисление.
+    bool Resume(uint64_t fuel);
+
+    bool IsDone() const {
+        return state_ == State::DONE;
+    }
+    /// результат в том же виде, что у Run
+    std::string GetResult() const;
+
+    /// бросает вычисление, его кадры освобождаются сразу
+    void Cancel();
+
+protected:
+    friend class Interpreter;
+
+    enum class State { RUNNING, DONE, STOPPED };
+
+    explicit Evaluation(const std::shared_ptr<Prototype>& prototype);
+
+protected:
+    VirtualMachine vm_;
+    State state_ = State::RUNNING;
+    std::shared_ptr<Object> result_;
+};
 
 class Interpreter {
 public:
+    explicit Interpreter(Engine engine = Engine::ANALYZER);
+
+    Interpreter(const Interpreter&) = delete;
+    Interpreter& operator=(const Interpreter&) = delete;
+    ~Interpreter();
+
+    /// Повторный Run того же текста берёт готовый код из FormCache без Tokenizer и Read
     std::string Run(const std::string&);
 
+    /// Run для каждого выражения по очереди, но без строки на каждый результат: тексты
+    /// пишутся в result->output. Ошибка выражения не прерывает остальные, а становится его
+    /// результатом; выражения, как и в Run, видят define предыдущих.
+    void RunBatch(std::span<const std::string_view> expressions, BatchResult* result);
+
+    /// Выражение, которое исполнится при Evaluation::Resume. Только для Engine::BYTECODE:
+    /// код анализатора - рекурсия C++, его нельзя остановить посередине.
+    Evaluation Start(const std::string& line);
+
+    /// Читает и исполняет формы из in по одной, результат каждой сразу отдаётся в sink.
+    /// В памяти держится только текущая форма, так что длина входа не ограничена.
+    void RunStream(std::istream* in, const std::function<void(const std::string&)>& sink);
+    /// то же для программы в двоичном формате из serialize.h: без Tokenizer и Read
+    void RunProgram(std::string_view program,
+                    const std::function<void(const std::string&)>& sink);
+
+    /// Образ кучи из image.h: все определённые глобальные имена со всем, что от них
+    /// достижимо. Загрузка образа заменяет повторное исполнение всех define библиотеки.
+    void SaveImage(const std::string& path);
+    void LoadImage(const std::string& path);
+
+    /// сборка циклов вне очереди; возвращает число живых кадров
+    size_t CollectGarbage();
+
+    void SetFormCacheCapacity(size_t capacity) {
+        form_cache_.SetCapacity(capacity);
+    }
+    const FormCacheStats& GetFormCacheStats() const {
+        return form_cache_.GetStats();
+    }
+
+protected:
+    static constexpr size_t kFormCacheCapacity = 1024;
+
+    std::shared_ptr<Object> Evaluate(const std::shared_ptr<Object>& form);
+    /// готовый код для text из кэша или свежий в compiled
+    const FormCache::Entry* Prepare(std::string_view text, Tokenizer* tokenizer,
+                                    FormCache::Entry* compiled);
+    /// код для form тем движком, который выбран
+    void Compile(const std::shared_ptr<Object>& form, FormCache::Entry* entry);
+    std::shared_ptr<Object> Execute(const FormCache::Entry& entry);
+
 protected:
+    Engine engine_;
     Scope global_scope_;
+    CycleCollector collector_;
+    Analyzer analyzer_;
+    Compiler compiler_;
+    VirtualMachine vm_;
+    FormCache form_cache_{kFormCacheCapacity};
 };
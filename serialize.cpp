@@ -0,0 +1,335 @@
+#include "serialize.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "parser.h"
+#include "tokenizer.h"
+
+namespace {
+
+constexpr std::string_view kMagic = "SCMB";
+constexpr uint8_t kVersion = 1;
+
+enum class NodeTag : uint8_t { NIL, TRUE, FALSE, NUMBER, SYMBOL, LIST, BIG_NUMBER };
+
+/// Пишет узлы в прямом порядке. Обход идёт по явному стеку, как и в Read: глубина формы
+/// ограничена только памятью.
+class NodeWriter {
+public:
+    explicit NodeWriter(std::string* out) : out_(out) {
+    }
+
+    void Write(const std::shared_ptr<Object>& form) {
+        pending_.push_back(form);
+        while (!pending_.empty()) {
+            auto node = std::move(pending_.back());
+            pending_.pop_back();
+            WriteNode(node);
+        }
+    }
+
+    const SymbolIndex& GetSymbols() const {
+        return symbols_;
+    }
+
+protected:
+    void WriteNode(const std::shared_ptr<Object>& node) {
+        if (node == nullptr) {
+            out_->push_back(static_cast<char>(NodeTag::NIL));
+        } else if (auto boolean = As<Bool>(node)) {
+            out_->push_back(static_cast<char>(boolean->GetBoolValue() ? NodeTag::TRUE
+                                                                      : NodeTag::FALSE));
+        } else if (auto number = As<Number>(node); number != nullptr && number->IsSmall()) {
+            out_->push_back(static_cast<char>(NodeTag::NUMBER));
+            WriteSignedVarint(out_, number->GetValue());
+        } else if (number != nullptr) {
+            BigInteger storage;
+            out_->push_back(static_cast<char>(NodeTag::BIG_NUMBER));
+            WriteBigInteger(out_, number->GetBigInteger(&storage));
+        } else if (auto symbol = As<Symbol>(node)) {
+            out_->push_back(static_cast<char>(NodeTag::SYMBOL));
+            WriteVarint(out_, symbols_.Index(symbol->GetId()));
+        } else if (auto list = As<Cell>(node)) {
+            WriteList(list);
+        } else {
+            throw RuntimeError("only parsed forms can be serialized");
+        }
+    }
+
+    void WriteList(Cell* list) {
+        size_t first_element = pending_.size();
+        std::shared_ptr<Object> tail;
+        size_t count = 0;
+        for (Cell* cell = list; cell != nullptr; cell = As<Cell>(tail)) {
+            pending_.push_back(cell->GetFirst());
+            tail = cell->GetSecond();
+            ++count;
+        }
+        pending_.push_back(tail);
+        // со стека узлы снимаются с конца: первым должен выйти первый элемент, последним хвост
+        std::reverse(pending_.begin() + first_element, pending_.end());
+        out_->push_back(static_cast<char>(NodeTag::LIST));
+        WriteVarint(out_, count);
+    }
+
+protected:
+    std::string* out_;
+    std::vector<std::shared_ptr<Object>> pending_;
+    SymbolIndex symbols_;
+};
+
+/// список, который загрузчик ещё собирает
+struct PendingList {
+    std::shared_ptr<Object> head;
+    Cell* tail = nullptr;
+    uint64_t remaining;
+};
+
+}  // namespace
+
+std::string SerializeForms(const std::vector<std::shared_ptr<Object>>& forms) {
+    std::string nodes;
+    NodeWriter writer(&nodes);
+    for (const auto& form : forms) {
+        writer.Write(form);
+    }
+
+    std::string out(kMagic);
+    out.push_back(static_cast<char>(kVersion));
+    writer.GetSymbols().Write(&out);
+    return out + nodes;
+}
+
+std::string CompileSource(std::string_view source) {
+    std::vector<std::shared_ptr<Object>> forms;
+    for (Tokenizer tokenizer{source}; !tokenizer.IsEnd();) {
+        forms.push_back(Read(&tokenizer));
+    }
+    return SerializeForms(forms);
+}
+
+void WriteVarint(std::string* out, uint64_t value) {
+    while (value >= 0x80) {
+        out->push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+void WriteSignedVarint(std::string* out, int64_t value) {
+    // zigzag: маленькие по модулю отрицательные числа тоже занимают один байт
+    WriteVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void WriteBigInteger(std::string* out, const BigInteger& value) {
+    out->push_back(value.IsNegative() ? 1 : 0);
+    WriteVarint(out, value.GetDigits().size());
+    for (uint32_t digit : value.GetDigits()) {
+        WriteVarint(out, digit);
+    }
+}
+
+uint32_t SymbolIndex::Index(uint32_t id) {
+    auto [it, inserted] = indices_.emplace(id, symbols_.size());
+    if (inserted) {
+        symbols_.push_back(id);
+    }
+    return it->second;
+}
+
+void SymbolIndex::Write(std::string* out) const {
+    WriteVarint(out, symbols_.size());
+    for (uint32_t id : symbols_) {
+        const auto& name = Symbol::FromId(id)->GetName();
+        WriteVarint(out, name.size());
+        *out += name;
+    }
+}
+
+BinaryReader::BinaryReader(std::string_view data)
+    : cursor_(data.data()), end_(data.data() + data.size()) {
+}
+
+void BinaryReader::ReadHeader(std::string_view magic, uint8_t version) {
+    if (std::string_view(cursor_, std::min(GetRemaining(), magic.size())) != magic) {
+        throw SyntaxError("unknown binary format");
+    }
+    cursor_ += magic.size();
+    if (ReadByte() != version) {
+        throw SyntaxError("unsupported binary format version");
+    }
+}
+
+std::vector<uint32_t> BinaryReader::ReadSymbolTable() {
+    std::vector<uint32_t> symbols(ReadCount());
+    for (auto& id : symbols) {
+        uint64_t length = ReadVarint();
+        if (length > GetRemaining()) {
+            throw SyntaxError("corrupted binary data");
+        }
+        id = Symbol::Intern(std::string_view(cursor_, length))->GetId();
+        cursor_ += length;
+    }
+    return symbols;
+}
+
+uint8_t BinaryReader::ReadByte() {
+    if (cursor_ == end_) {
+        throw SyntaxError("unexpected end of binary data");
+    }
+    return static_cast<uint8_t>(*cursor_++);
+}
+
+uint64_t BinaryReader::ReadVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = ReadByte();
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw SyntaxError("corrupted binary data");
+}
+
+int64_t BinaryReader::ReadSignedVarint() {
+    uint64_t value = ReadVarint();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+BigInteger BinaryReader::ReadBigInteger() {
+    bool negative = ReadIndex(2) != 0;
+    std::vector<uint32_t> digits(ReadCount());
+    for (auto& digit : digits) {
+        digit = ReadIndex(BigInteger::kBase);
+    }
+    if (!digits.empty() && digits.back() == 0) {
+        throw SyntaxError("corrupted binary data");
+    }
+    return BigInteger(negative, std::move(digits));
+}
+
+uint64_t BinaryReader::ReadIndex(uint64_t limit) {
+    uint64_t index = ReadVarint();
+    if (index >= limit) {
+        throw SyntaxError("corrupted binary data");
+    }
+    return index;
+}
+
+uint64_t BinaryReader::ReadCount() {
+    uint64_t count = ReadVarint();
+    if (count > GetRemaining()) {
+        throw SyntaxError("corrupted binary data");
+    }
+    return count;
+}
+
+ProgramLoader::ProgramLoader(std::string_view data) : reader_(data) {
+    reader_.ReadHeader(kMagic, kVersion);
+    symbols_ = reader_.ReadSymbolTable();
+}
+
+bool ProgramLoader::IsEnd() const {
+    return reader_.IsEnd();
+}
+
+std::shared_ptr<Object> ProgramLoader::Next() {
+    std::vector<PendingList> stack;
+    while (true) {
+        std::shared_ptr<Object> datum;
+        switch (static_cast<NodeTag>(reader_.ReadByte())) {
+            case NodeTag::NIL:
+                break;
+            case NodeTag::TRUE:
+                datum = Bool::Make(true);
+                break;
+            case NodeTag::FALSE:
+                datum = Bool::Make(false);
+                break;
+            case NodeTag::NUMBER:
+                datum = Number::Make(reader_.ReadSignedVarint());
+                break;
+            case NodeTag::BIG_NUMBER:
+                datum = Number::Make(reader_.ReadBigInteger());
+                break;
+            case NodeTag::SYMBOL:
+                datum = Symbol::FromId(symbols_[reader_.ReadIndex(symbols_.size())]);
+                break;
+            case NodeTag::LIST: {
+                uint64_t count = reader_.ReadCount();
+                if (count == 0) {
+                    throw SyntaxError("corrupted binary data");
+                }
+                stack.push_back(PendingList{nullptr, nullptr, count});
+                continue;
+            }
+            default:
+                throw SyntaxError("corrupted binary data");
+        }
+
+        while (true) {
+            if (stack.empty()) {
+                return datum;
+            }
+            PendingList& list = stack.back();
+            if (list.remaining == 0) {
+                list.tail->SetSecond(std::move(datum));
+                datum = std::move(list.head);
+                stack.pop_back();
+                continue;
+            }
+            auto cell = Cell::Make(std::move(datum), nullptr);
+            Cell* new_tail = cell.get();
+            if (list.tail == nullptr) {
+                list.head = std::move(cell);
+            } else {
+                list.tail->SetSecond(std::move(cell));
+            }
+            list.tail = new_tail;
+            --list.remaining;
+            break;
+        }
+    }
+}
+
+std::vector<std::shared_ptr<Object>> DeserializeForms(std::string_view data) {
+    std::vector<std::shared_ptr<Object>> forms;
+    for (ProgramLoader loader(data); !loader.IsEnd();) {
+        forms.push_back(loader.Next());
+    }
+    return forms;
+}
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw RuntimeError("cannot open " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw RuntimeError("cannot stat " + path);
+    }
+    size_ = info.st_size;
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw RuntimeError("cannot map " + path);
+        }
+        data_ = static_cast<const char*>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
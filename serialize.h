@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "object.h"
+
+/// Общие части двоичных форматов (программы здесь, образа кучи в image.h): заголовок из
+/// сигнатуры и байта версии, varint-ы и таблица символов - число имён, затем у каждого
+/// длина:varint и байты. Символы в данных - номера в этой таблице, так что файл не
+/// зависит от id символов в процессе, который его записал.
+void WriteVarint(std::string* out, uint64_t value);
+void WriteSignedVarint(std::string* out, int64_t value);
+/// знак:u8, число разрядов BigInteger и сами разряды varint-ами
+void WriteBigInteger(std::string* out, const BigInteger& value);
+
+/// номера символов в таблице файла, в порядке первого появления
+class SymbolIndex {
+public:
+    uint32_t Index(uint32_t id);
+    void Write(std::string* out) const;
+
+protected:
+    std::unordered_map<uint32_t, uint32_t> indices_;
+    std::vector<uint32_t> symbols_;
+};
+
+/// Разбор буфера; любой выход за его конец или мусор - SyntaxError
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data);
+
+    bool IsEnd() const {
+        return cursor_ == end_;
+    }
+    /// сколько байт осталось - верхняя оценка для любого числа элементов впереди
+    size_t GetRemaining() const {
+        return end_ - cursor_;
+    }
+
+    void ReadHeader(std::string_view magic, uint8_t version);
+    /// id символов по номеру в таблице; имена интернируются прямо из буфера
+    std::vector<uint32_t> ReadSymbolTable();
+    uint8_t ReadByte();
+    uint64_t ReadVarint();
+    int64_t ReadSignedVarint();
+    BigInteger ReadBigInteger();
+    /// varint, который должен быть меньше limit, - номер в таблице
+    uint64_t ReadIndex(uint64_t limit);
+    /// число элементов впереди; каждому нужен хотя бы байт, так что мусор не раздует память
+    uint64_t ReadCount();
+
+protected:
+    const char* cursor_;
+    const char* end_;
+};
+
+/// Двоичный формат разобранной программы, чтобы не гонять большие библиотеки через
+/// Tokenizer и Read при каждом запуске.
+///
+///     "SCMB" версия:u8
+///     число символов:varint, затем у каждого длина:varint и байты имени
+///     формы верхнего уровня подряд до конца данных
+///
+/// Узел - байт тега и данные. У списка это число элементов, сами элементы и хвост (NIL у
+/// обычного списка), так что цепочка ячеек стоит один тег. Целые - zigzag varint, а те,
+/// что не помещаются в int64_t, - отдельным тегом через WriteBigInteger.
+std::string SerializeForms(const std::vector<std::shared_ptr<Object>>& forms);
+
+/// разбирает исходник целиком и сериализует все его формы
+std::string CompileSource(std::string_view source);
+
+/// Читает формы из двоичных данных по одной, по аналогии с Tokenizer. Данные (например,
+/// отображённый в память файл) должны жить дольше загрузчика; имена символов
+/// интернируются прямо из них, без промежуточных строк.
+class ProgramLoader {
+public:
+    explicit ProgramLoader(std::string_view data);
+
+    bool IsEnd() const;
+    std::shared_ptr<Object> Next();
+
+protected:
+    BinaryReader reader_;
+    /// id символов по их номеру в таблице файла
+    std::vector<uint32_t> symbols_;
+};
+
+std::vector<std::shared_ptr<Object>> DeserializeForms(std::string_view data);
+
+/// файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    std::string_view GetData() const {
+        return std::string_view(data_, size_);
+    }
+
+protected:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,189 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "pool.h"
+
+/// Сервер поверх InterpreterPool. Запрос - одна строка с выражением, ответ - строка
+///     <номер запроса> ok|error <ожидание, мкс> <исполнение, мкс> <результат или ошибка>
+/// Номера считаются с 0 в пределах соединения, ответы могут прийти не по порядку.
+/// Без --socket читает stdin и пишет в stdout, с ним - принимает соединения по Unix
+/// сокету. Когда очередь полна, сервер перестаёт читать соединение, и клиент упирается
+/// в буфер сокета.
+
+namespace {
+
+struct Options {
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t queue_capacity = 1024;
+    Engine engine = Engine::ANALYZER;
+    std::string image;
+    std::string socket;
+};
+
+Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+        if (argument == "--workers" && has_value) {
+            options.workers = std::stoul(argv[++i]);
+        } else if (argument == "--queue" && has_value) {
+            options.queue_capacity = std::stoul(argv[++i]);
+        } else if (argument == "--bytecode") {
+            options.engine = Engine::BYTECODE;
+        } else if (argument == "--image" && has_value) {
+            options.image = argv[++i];
+        } else if (argument == "--socket" && has_value) {
+            options.socket = argv[++i];
+        } else {
+            throw std::invalid_argument(
+                "usage: scheme_advanced_server [--workers N] [--queue N] [--bytecode] "
+                "[--image PATH] [--socket PATH]");
+        }
+    }
+    return options;
+}
+
+/// Ответы одного соединения: пишутся из воркеров, поэтому под mutex.
+/// Соединение закрывается, только когда ответ ушёл на каждый принятый запрос.
+class Connection {
+public:
+    explicit Connection(int output_fd) : output_fd_(output_fd) {
+    }
+
+    void Serve(InterpreterPool* pool, std::istream* in) {
+        std::string line;
+        for (uint64_t id = 0; std::getline(*in, line); ++id) {
+            {
+                std::lock_guard lock{mutex_};
+                ++pending_;
+            }
+            pool->Submit(std::move(line),
+                         [this, id](PoolResponse response) { Reply(id, response); });
+        }
+        std::unique_lock lock{mutex_};
+        all_replied_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+protected:
+    void Reply(uint64_t id, const PoolResponse& response) {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        auto text = std::to_string(id) + (response.ok ? " ok " : " error ") +
+                    std::to_string(duration_cast<microseconds>(response.wait_time).count()) +
+                    " " +
+                    std::to_string(duration_cast<microseconds>(response.run_time).count()) +
+                    " " + response.output + "\n";
+        std::lock_guard lock{mutex_};
+        for (size_t written = 0; written < text.size();) {
+            auto count = write(output_fd_, text.data() + written, text.size() - written);
+            if (count < 0 && errno != EINTR) {
+                break;  // клиент ушёл, остальные ответы тоже пропадут
+            }
+            written += std::max<ssize_t>(count, 0);
+        }
+        // Serve проснётся только после unlock, так что Connection ещё жив
+        if (--pending_ == 0) {
+            all_replied_.notify_all();
+        }
+    }
+
+protected:
+    int output_fd_;
+    std::mutex mutex_;
+    std::condition_variable all_replied_;
+    uint64_t pending_ = 0;
+};
+
+/// istream поверх файлового дескриптора сокета
+class SocketBuffer : public std::streambuf {
+public:
+    explicit SocketBuffer(int fd) : fd_(fd) {
+    }
+
+protected:
+    int_type underflow() override {
+        ssize_t count;
+        do {
+            count = read(fd_, buffer_, sizeof(buffer_));
+        } while (count < 0 && errno == EINTR);
+        if (count <= 0) {
+            return traits_type::eof();
+        }
+        setg(buffer_, buffer_, buffer_ + count);
+        return traits_type::to_int_type(buffer_[0]);
+    }
+
+private:
+    int fd_;
+    char buffer_[1 << 16];
+};
+
+void ServeSocket(InterpreterPool* pool, const std::string& path) {
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (listener < 0 || path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("cannot create socket " + path);
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+        throw std::runtime_error("cannot listen on " + path + ": " + std::strerror(errno));
+    }
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            throw std::runtime_error(std::string("accept failed: ") + std::strerror(errno));
+        }
+        std::thread([pool, client] {
+            SocketBuffer buffer(client);
+            std::istream in(&buffer);
+            Connection(client).Serve(pool, &in);
+            close(client);
+        }).detach();
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    // ушедший клиент - ошибка write, а не смерть процесса
+    std::signal(SIGPIPE, SIG_IGN);
+    try {
+        auto options = ParseOptions(argc, argv);
+        InterpreterPool pool(options.workers, options.queue_capacity, options.engine,
+                             [&options](Interpreter* interpreter) {
+                                 if (!options.image.empty()) {
+                                     interpreter->LoadImage(options.image);
+                                 }
+                             });
+        if (options.socket.empty()) {
+            std::ios::sync_with_stdio(false);
+            Connection(STDOUT_FILENO).Serve(&pool, &std::cin);
+        } else {
+            ServeSocket(&pool, options.socket);
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
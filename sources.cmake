@@ -1,7 +1,17 @@
 add_library(scheme_advanced
+    object.cpp
+    bignum.cpp
     tokenizer.cpp
     parser.cpp
     scheme.cpp
+    analyzer.cpp
+    bytecode.cpp
+    collector.cpp
+    serialize.cpp
+    image.cpp
+    pool.cpp
+    scheduler.cpp
+    future.cpp
     
     # maybe more .cpp files here
 )
@@ -7,6 +7,9 @@
 
 class SchemeTest {
 public:
+    explicit SchemeTest(Engine engine = Engine::ANALYZER) : interpreter_(engine) {
+    }
+
     void ExpectEq(std::string expression, const std::string& result) {
         REQUIRE(interpreter_.Run(expression) == result);
     }
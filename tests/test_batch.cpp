@@ -0,0 +1,66 @@
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "scheme_test.h"
+
+TEST_CASE("RunBatchMatchesRun") {
+    const std::vector<std::string_view> expressions = {
+        "(define (square x) (* x x))",
+        "(square 12)",
+        "(square 4294967296)",
+        "'(1 (2 . 3) #t sym)",
+        "(< 1 2)",
+        "'sym",
+        "(cdr '(1))",
+        "(square 12)",
+    };
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter reference(engine);
+        Interpreter interpreter(engine);
+        BatchResult result;
+        interpreter.RunBatch(expressions, &result);
+        REQUIRE(result.items.size() == expressions.size());
+        for (size_t i = 0; i < expressions.size(); ++i) {
+            REQUIRE(result.IsOk(i));
+            REQUIRE(result.Get(i) == reference.Run(std::string(expressions[i])));
+        }
+        // повторная партия идёт из кэша форм
+        interpreter.RunBatch(std::span(expressions).subspan(1, 1), &result);
+        REQUIRE(result.items.size() == 1);
+        REQUIRE(result.Get(0) == "144");
+        REQUIRE(result.output == "144");
+    }
+}
+
+TEST_CASE("RunBatchReportsErrorsPerItem") {
+    const std::vector<std::string_view> expressions = {
+        "(define x 1)",
+        "(+ x",
+        "undefined-name",
+        "(car '())",
+        "(set! x (+ x 1))",
+        "(1 2",
+        "x",
+    };
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        BatchResult result;
+        interpreter.RunBatch(expressions, &result);
+        REQUIRE(result.items.size() == expressions.size());
+        using Status = BatchResult::Status;
+        REQUIRE(result.items[1].status == Status::SYNTAX_ERROR);
+        REQUIRE(result.items[2].status == Status::NAME_ERROR);
+        REQUIRE(result.items[3].status == Status::RUNTIME_ERROR);
+        REQUIRE(result.items[5].status == Status::SYNTAX_ERROR);
+        REQUIRE_FALSE(result.Get(2).empty());
+        // ошибки не мешают следующим выражениям
+        REQUIRE(result.IsOk(4));
+        REQUIRE(result.Get(6) == "2");
+        REQUIRE(interpreter.Run("x") == "2");
+
+        interpreter.RunBatch({}, &result);
+        REQUIRE(result.items.empty());
+        REQUIRE(result.output.empty());
+    }
+}
@@ -0,0 +1,422 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parser.h"
+#include "pool.h"
+#include "scheduler.h"
+#include "scheme_test.h"
+#include "serialize.h"
+#include "tokenizer.h"
+
+/// Замеры времени, по умолчанию не запускаются: ./test_scheme_advanced "[bench]"
+
+namespace {
+
+constexpr int kIterations = 1000000;
+
+template <class F>
+double NanosecondsPerCall(F&& call) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        call();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kIterations;
+}
+
+void ReportPrimitive(const std::string& name, const std::vector<std::shared_ptr<Object>>& args) {
+    auto function = name_to_function.at(name);
+    std::shared_ptr<Object> result;
+    double ns = NanosecondsPerCall([&] { result = function->Apply(args); });
+    WARN(name << ": " << ns << " ns per call");
+    if (args.size() == 1) {
+        ns = NanosecondsPerCall([&] { result = function->Apply1(args[0]); });
+        WARN(name << " (Apply1): " << ns << " ns per call");
+    } else if (args.size() == 2) {
+        ns = NanosecondsPerCall([&] { result = function->Apply2(args[0], args[1]); });
+        WARN(name << " (Apply2): " << ns << " ns per call");
+    }
+}
+
+}  // namespace
+
+TEST_CASE("PrimitiveCallCost", "[.][bench]") {
+    std::vector<std::shared_ptr<Object>> numbers = {std::make_shared<Number>(3),
+                                                    std::make_shared<Number>(4)};
+    std::vector<std::shared_ptr<Object>> pair = {
+        std::make_shared<Cell>(std::make_shared<Number>(1), std::make_shared<Number>(2))};
+
+    ReportPrimitive("+", numbers);
+    ReportPrimitive("<", numbers);
+    ReportPrimitive("=", numbers);
+    ReportPrimitive("car", pair);
+    ReportPrimitive("pair?", pair);
+    ReportPrimitive("number?", {numbers[0]});
+}
+
+TEST_CASE("InterpreterCallCost", "[.][bench]") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define (fib x) (if (< x 3) 1 (+ (fib (- x 1)) (fib (- x 2)))))");
+        auto start = std::chrono::steady_clock::now();
+        interpreter.Run("(fib 25)");
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        WARN((engine == Engine::ANALYZER ? "analyzer" : "bytecode") << " (fib 25): "
+                                                                     << elapsed.count() << " s");
+    }
+}
+
+namespace {
+
+double TokenizerMegabytesPerSecond(Tokenizer* tokenizer, size_t size) {
+    auto start = std::chrono::steady_clock::now();
+    for (; !tokenizer->IsEnd(); tokenizer->Next()) {
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return size / elapsed.count() / (1 << 20);
+}
+
+}  // namespace
+
+TEST_CASE("TokenizerThroughput", "[.][bench]") {
+    std::string compact;
+    std::string indented;
+    while (compact.size() < (8 << 20)) {
+        compact += "(define (fib-helper x acc) (if (< x 3) acc (fib-helper (- x 1) (+ acc x))))\n";
+        indented += "(define (configuration-entry-with-long-name value)\n"
+                    "                (list 'configuration-option-name value 1234567))\n";
+    }
+    for (const auto& [name, source] : {std::pair{"compact", &compact},
+                                       std::pair{"indented", &indented}}) {
+        std::stringstream stream{*source};
+        Tokenizer from_stream{&stream};
+        Tokenizer from_buffer{std::string_view(*source)};
+        WARN(name << " stream: " << TokenizerMegabytesPerSecond(&from_stream, source->size())
+                  << " MiB/s, buffer: "
+                  << TokenizerMegabytesPerSecond(&from_buffer, source->size()) << " MiB/s");
+    }
+}
+
+TEST_CASE("ParserLongAndDeepInputs", "[.][bench]") {
+    std::string long_list = "(";
+    for (int i = 0; i < 10000000; ++i) {
+        long_list += "1 ";
+    }
+    long_list += ")";
+    std::string deep = std::string(100000, '(') + std::string(100000, ')');
+
+    for (const auto& [name, source] : {std::pair{"10M-element list", &long_list},
+                                       std::pair{"100k-deep nesting", &deep}}) {
+        auto start = std::chrono::steady_clock::now();
+        Tokenizer tokenizer{std::string_view(*source)};
+        auto form = Read(&tokenizer);
+        std::chrono::duration<double> parsed = std::chrono::steady_clock::now() - start;
+        form.reset();
+        std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+        WARN(name << ": parse " << parsed.count() << " s, free " << (total - parsed).count()
+                  << " s");
+    }
+}
+
+TEST_CASE("BinaryProgramLoading", "[.][bench]") {
+    std::string source;
+    for (int i = 0; i < 200000; ++i) {
+        source += "(define (function-" + std::to_string(i % 1000) +
+                  " n) (if (< n 2) 'small (+ n (other-function (- n 1)))))\n";
+    }
+    auto binary = CompileSource(source);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t text_forms = 0;
+    for (Tokenizer tokenizer{std::string_view(source)}; !tokenizer.IsEnd(); ++text_forms) {
+        Read(&tokenizer);
+    }
+    std::chrono::duration<double> text = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    size_t binary_forms = 0;
+    for (ProgramLoader loader(binary); !loader.IsEnd(); ++binary_forms) {
+        loader.Next();
+    }
+    std::chrono::duration<double> loaded = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(text_forms == binary_forms);
+    WARN("text " << source.size() << " bytes, " << text.count() << " s; binary "
+                 << binary.size() << " bytes, " << loaded.count() << " s");
+}
+
+TEST_CASE("HeapImageStartup", "[.][bench]") {
+    std::vector<std::string> library;
+    for (int i = 0; i < 5000; ++i) {
+        auto name = "function-" + std::to_string(i);
+        library.push_back("(define (" + name + " n) (if (< n 2) n (+ (" + name +
+                          " (- n 1)) (* n 2))))");
+        library.push_back("(define value-" + std::to_string(i) + " '(" + std::to_string(i) +
+                          " (a b c) #t))");
+    }
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            Interpreter interpreter(engine);
+            for (const auto& form : library) {
+                interpreter.Run(form);
+            }
+            std::chrono::duration<double> cold = std::chrono::steady_clock::now() - start;
+            WARN((engine == Engine::ANALYZER ? "analyzer" : "bytecode")
+                 << ": cold start " << cold.count() << " s");
+            interpreter.SaveImage("bench_image.scmi");
+        }
+
+        start = std::chrono::steady_clock::now();
+        {
+            Interpreter interpreter(engine);
+            interpreter.LoadImage("bench_image.scmi");
+            std::chrono::duration<double> warm = std::chrono::steady_clock::now() - start;
+            WARN("image start " << warm.count() << " s");
+            REQUIRE(interpreter.Run("(function-4999 3)") == "11");
+        }
+    }
+    std::remove("bench_image.scmi");
+}
+
+TEST_CASE("BigIntegerArithmetic", "[.][bench]") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define (fact n acc) (if (< n 2) acc (fact (- n 1) (* n acc))))");
+        interpreter.Run("(define (fib n a b) (if (= n 0) a (fib (- n 1) b (+ a b))))");
+        for (const auto& [name, expression] :
+             {std::pair{"factorial 5000", "(fact 5000 1)"},
+              std::pair{"fibonacci 50000", "(fib 50000 0 1)"}}) {
+            auto start = std::chrono::steady_clock::now();
+            auto digits = interpreter.Run(expression).size();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            WARN((engine == Engine::ANALYZER ? "analyzer " : "bytecode ")
+                 << name << ": " << digits << " digits, " << elapsed.count() << " s");
+        }
+    }
+
+    std::string digits(200000, '7');
+    auto a = BigInteger::Parse(digits);
+    auto start = std::chrono::steady_clock::now();
+    auto square = a * a;
+    std::chrono::duration<double> multiplied = std::chrono::steady_clock::now() - start;
+    auto printed = square.ToString();
+    std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+    WARN("200k-digit square: multiply " << multiplied.count() << " s, print "
+                                         << (total - multiplied).count() << " s");
+}
+
+TEST_CASE("RepeatedRunCalls", "[.][bench]") {
+    std::vector<std::string> lines;
+    for (int i = 0; i < 300; ++i) {
+        lines.push_back("(if (< " + std::to_string(i) + " 150) (+ x " + std::to_string(i) +
+                        ") (max x (* 2 " + std::to_string(i) + ")))");
+    }
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        for (size_t capacity : {size_t{0}, size_t{1024}}) {
+            Interpreter interpreter(engine);
+            interpreter.SetFormCacheCapacity(capacity);
+            interpreter.Run("(define x 7)");
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < 1000; ++round) {
+                for (const auto& line : lines) {
+                    interpreter.Run(line);
+                }
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            WARN((engine == Engine::ANALYZER ? "analyzer" : "bytecode")
+                 << (capacity == 0 ? " without" : " with") << " form cache: "
+                 << elapsed.count() * 1e9 / (1000 * lines.size()) << " ns per Run");
+        }
+    }
+}
+
+TEST_CASE("BatchedRunCalls", "[.][bench]") {
+    // 10^5 коротких выражений за такт, как у движка правил
+    std::vector<std::string> lines;
+    for (int i = 0; i < 100000; ++i) {
+        int k = i % 300;
+        lines.push_back("(if (< " + std::to_string(k) + " 150) (+ x " + std::to_string(k) +
+                        ") (max x (* 2 " + std::to_string(k) + ")))");
+    }
+    std::vector<std::string_view> views(lines.begin(), lines.end());
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        for (size_t capacity : {size_t{0}, size_t{1024}}) {
+            Interpreter interpreter(engine);
+            interpreter.SetFormCacheCapacity(capacity);
+            interpreter.Run("(define x 7)");
+            BatchResult result;
+            double seconds[2];
+            for (int batched : {0, 1}) {
+                auto start = std::chrono::steady_clock::now();
+                for (int tick = 0; tick < 5; ++tick) {
+                    if (batched) {
+                        interpreter.RunBatch(views, &result);
+                    } else {
+                        // у движка правил тексты - string_view в свои буферы, Run нужна строка
+                        for (auto view : views) {
+                            interpreter.Run(std::string(view));
+                        }
+                    }
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                seconds[batched] = elapsed.count() * 1e9 / (5 * lines.size());
+            }
+            WARN((engine == Engine::ANALYZER ? "analyzer" : "bytecode")
+                 << (capacity == 0 ? " without" : " with") << " form cache: Run " << seconds[0]
+                 << " ns, RunBatch " << seconds[1] << " ns per expression");
+        }
+    }
+}
+
+TEST_CASE("ThreadScaling", "[.][bench]") {
+    unsigned max_threads = std::max(4u, std::thread::hardware_concurrency());
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        double single = 0;
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+            constexpr int kRunsPerThread = 20;
+            std::vector<std::thread> workers;
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back([engine] {
+                    Interpreter interpreter(engine);
+                    interpreter.Run(
+                        "(define (fib x) (if (< x 3) 1 (+ (fib (- x 1)) (fib (- x 2)))))");
+                    for (int i = 0; i < kRunsPerThread; ++i) {
+                        interpreter.Run("(fib 18)");
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            double throughput = threads * kRunsPerThread / elapsed.count();
+            if (threads == 1) {
+                single = throughput;
+            }
+            WARN((engine == Engine::ANALYZER ? "analyzer " : "bytecode ")
+                 << threads << " threads: " << throughput << " runs/s, x"
+                 << throughput / single << " (" << std::thread::hardware_concurrency()
+                 << " cores)");
+        }
+    }
+}
+
+TEST_CASE("InterpreterPoolLoad", "[.][bench]") {
+    constexpr size_t kRequests = 20000;
+    unsigned max_workers = std::max(4u, std::thread::hardware_concurrency());
+    for (unsigned workers = 1; workers <= max_workers; workers *= 2) {
+        std::vector<double> latencies(kRequests);
+        std::atomic<size_t> done = 0;
+        auto start = std::chrono::steady_clock::now();
+        {
+            InterpreterPool pool(workers, 256, Engine::BYTECODE, [](Interpreter* interpreter) {
+                interpreter->Run("(define (fib x) (if (< x 3) 1 (+ (fib (- x 1)) (fib (- x 2)))))");
+            });
+            for (size_t i = 0; i < kRequests; ++i) {
+                pool.Submit("(fib " + std::to_string(8 + i % 5) + ")",
+                            [&latencies, &done, i](PoolResponse response) {
+                                latencies[i] = std::chrono::duration<double, std::micro>(
+                                                   response.wait_time + response.run_time)
+                                                   .count();
+                                done.fetch_add(1);
+                            });
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE(done.load() == kRequests);
+        std::sort(latencies.begin(), latencies.end());
+        WARN(workers << " workers: " << kRequests / elapsed.count() << " requests/s, p50 "
+                     << latencies[kRequests / 2] << " us, p99 " << latencies[kRequests * 99 / 100]
+                     << " us (" << std::thread::hardware_concurrency() << " cores)");
+    }
+}
+
+TEST_CASE("ParallelMapSpeedup", "[.][bench]") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run(
+            "(define (range a b acc) (if (>= a b) acc (range a (- b 1) (cons (- b 1) acc))))");
+        interpreter.Run("(define records (range 0 200000 '()))");
+        interpreter.Run("(define (spin n x) (if (= n 0) x (spin (- n 1) (+ x 1))))");
+        interpreter.Run("(define (work x) (spin 50 x))");
+        interpreter.Run(
+            "(define (map-acc f l acc) (if (null? l) acc (map-acc f (cdr l) (cons (f (car l)) "
+            "acc))))");
+        // Пул создаётся заранее: пока в процессе один поток, libstdc++ считает ссылки
+        // shared_ptr без атомарных операций, и последовательный замер был бы нечестным
+        interpreter.Run("(par-map work '(1))");
+
+        double seconds[2];
+        for (const auto& [i, expression] :
+             {std::pair{0, "(car (map-acc work records '()))"},
+              std::pair{1, "(car (par-map work records))"}}) {
+            auto start = std::chrono::steady_clock::now();
+            interpreter.Run(expression);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            seconds[i] = elapsed.count();
+        }
+        WARN((engine == Engine::ANALYZER ? "analyzer" : "bytecode")
+             << " 200k records: sequential " << seconds[0] << " s, par-map " << seconds[1]
+             << " s, x" << seconds[0] / seconds[1] << " ("
+             << WorkStealingPool::Global().GetWorkerCount() + 1 << " threads)");
+    }
+}
+
+TEST_CASE("FutureFibSpeedup", "[.][bench]") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+        interpreter.Run(
+            "(define (pfib n) (if (< n 18) (fib n) ((lambda (f) (+ (pfib (- n 1)) (touch f))) "
+            "(future (pfib (- n 2))))))");
+        // как и в ParallelMapSpeedup, воркеры запускаются до последовательного замера
+        interpreter.Run("(touch (future 1))");
+
+        double seconds[2];
+        for (const auto& [i, expression] :
+             {std::pair{0, "(fib 25)"}, std::pair{1, "(pfib 25)"}}) {
+            auto start = std::chrono::steady_clock::now();
+            interpreter.Run(expression);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            seconds[i] = elapsed.count();
+        }
+        WARN((engine == Engine::ANALYZER ? "analyzer" : "bytecode")
+             << " fib 25: sequential " << seconds[0] << " s, futures " << seconds[1] << " s, x"
+             << seconds[0] / seconds[1] << " (" << WorkStealingPool::Global().GetWorkerCount() + 1
+             << " threads)");
+    }
+}
+
+TEST_CASE("SlicedEvaluationLatency", "[.][bench]") {
+    Interpreter interpreter(Engine::BYTECODE);
+    interpreter.Run("(define (fib x) (if (< x 3) 1 (+ (fib (- x 1)) (fib (- x 2)))))");
+    auto start = std::chrono::steady_clock::now();
+    interpreter.Run("(fib 25)");
+    std::chrono::duration<double> whole = std::chrono::steady_clock::now() - start;
+    WARN("Run (fib 25): " << whole.count() << " s");
+
+    for (uint64_t fuel : {1000, 10000, 100000}) {
+        auto evaluation = interpreter.Start("(fib 25)");
+        int slices = 0;
+        std::chrono::duration<double, std::micro> longest{0};
+        start = std::chrono::steady_clock::now();
+        for (bool done = false; !done; ++slices) {
+            auto slice_start = std::chrono::steady_clock::now();
+            done = evaluation.Resume(fuel);
+            longest = std::max<std::chrono::duration<double, std::micro>>(
+                longest, std::chrono::steady_clock::now() - slice_start);
+        }
+        std::chrono::duration<double> sliced = std::chrono::steady_clock::now() - start;
+        WARN("fuel " << fuel << ": " << sliced.count() << " s in " << slices
+                     << " slices, longest slice " << longest.count() << " us");
+    }
+}
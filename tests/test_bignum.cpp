@@ -0,0 +1,176 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bignum.h"
+#include "scheme_test.h"
+#include "tokenizer.h"
+
+namespace {
+
+std::string RandomDigits(std::mt19937_64* random, size_t length) {
+    std::string digits(1, '1' + (*random)() % 9);
+    while (digits.size() < length) {
+        digits += '0' + (*random)() % 10;
+    }
+    return digits;
+}
+
+/// умножение столбиком по основанию 10 - медленная, но очевидно верная сверка
+std::string MultiplyDecimal(const std::string& lhs, const std::string& rhs) {
+    std::vector<int> product(lhs.size() + rhs.size(), 0);
+    for (size_t i = lhs.size(); i > 0; --i) {
+        for (size_t j = rhs.size(); j > 0; --j) {
+            product[i + j - 1] += (lhs[i - 1] - '0') * (rhs[j - 1] - '0');
+        }
+    }
+    for (size_t k = product.size() - 1; k > 0; --k) {
+        product[k - 1] += product[k] / 10;
+        product[k] %= 10;
+    }
+    std::string result;
+    for (int digit : product) {
+        if (!result.empty() || digit != 0) {
+            result += '0' + digit;
+        }
+    }
+    return result.empty() ? "0" : result;
+}
+
+}  // namespace
+
+TEST_CASE("BigIntegerMatchesMachineArithmetic") {
+    std::mt19937_64 random(17);
+    for (int i = 0; i < 10000; ++i) {
+        auto lhs = static_cast<int64_t>(random()) >> (random() % 64);
+        auto rhs = static_cast<int64_t>(random()) >> (random() % 64);
+        BigInteger a(lhs), b(rhs);
+        REQUIRE(a.FitsInt64());
+        REQUIRE(a.ToInt64() == lhs);
+        REQUIRE(a.ToString() == std::to_string(lhs));
+        REQUIRE(BigInteger::Parse(std::to_string(lhs)).Compare(a) == 0);
+        REQUIRE(a.Compare(b) == (lhs > rhs) - (lhs < rhs));
+
+        __int128 sum = __int128{lhs} + rhs;
+        __int128 product = __int128{lhs} * rhs;
+        REQUIRE((a + b - a).ToInt64() == rhs);
+        if (sum >= INT64_MIN && sum <= INT64_MAX) {
+            REQUIRE((a + b).ToInt64() == static_cast<int64_t>(sum));
+        }
+        if (product >= INT64_MIN && product <= INT64_MAX) {
+            REQUIRE((a * b).ToInt64() == static_cast<int64_t>(product));
+        }
+        if (rhs != 0 && !(lhs == INT64_MIN && rhs == -1)) {
+            REQUIRE((a / b).ToInt64() == lhs / rhs);
+        }
+    }
+    REQUIRE(!(BigInteger(INT64_MAX) + BigInteger(1)).FitsInt64());
+    REQUIRE((BigInteger(INT64_MIN) - BigInteger(1)).ToString() == "-9223372036854775809");
+    REQUIRE(BigInteger::Parse("-0").ToString() == "0");
+    REQUIRE(BigInteger::Parse("+000000000000000000001000000000").ToString() == "1000000000");
+}
+
+TEST_CASE("BigIntegerLongMultiplicationAndDivision") {
+    std::mt19937_64 random(23);
+    // длины по обе стороны от порога Карацубы и сильно разные длины множителей
+    for (auto [lhs_length, rhs_length] : std::vector<std::pair<size_t, size_t>>{
+             {1, 30}, {20, 20}, {360, 370}, {1000, 1000}, {2500, 400}, {3000, 20}, {1999, 2001}}) {
+        auto lhs = RandomDigits(&random, lhs_length);
+        auto rhs = RandomDigits(&random, rhs_length);
+        auto a = BigInteger::Parse(lhs);
+        auto b = BigInteger::Parse(rhs);
+        REQUIRE(a.ToString() == lhs);
+        REQUIRE((a * b).ToString() == MultiplyDecimal(lhs, rhs));
+        REQUIRE((-a * b).ToString() == "-" + MultiplyDecimal(lhs, rhs));
+
+        // a = q b + r, 0 <= r < b
+        auto quotient = a / b;
+        auto remainder = a - quotient * b;
+        REQUIRE(!remainder.IsNegative());
+        REQUIRE(remainder.Compare(b) < 0);
+        REQUIRE(((a * b + remainder) / b).Compare(a) == 0);
+        REQUIRE((-a / b).Compare(-quotient) == 0);
+    }
+}
+
+TEST_CASE("BigIntegerDivisionEdgeDigits") {
+    // разряды у краёв основания - там, где оценка цифры частного ошибается
+    std::mt19937_64 random(29);
+    const uint32_t edges[] = {0, 1, 2, BigInteger::kBase / 2 - 1, BigInteger::kBase / 2,
+                              BigInteger::kBase - 2, BigInteger::kBase - 1};
+    auto make = [&](size_t length) {
+        std::vector<uint32_t> digits(length);
+        for (auto& digit : digits) {
+            digit = random() % 2 ? edges[random() % std::size(edges)]
+                                 : random() % BigInteger::kBase;
+        }
+        digits.back() = std::max<uint32_t>(digits.back(), 1);
+        return BigInteger(false, std::move(digits));
+    };
+    for (int i = 0; i < 50000; ++i) {
+        auto b = make(2 + random() % 3);
+        auto a = make(2 + random() % 6);
+        auto quotient = a / b;
+        auto remainder = a - quotient * b;
+        REQUIRE(!remainder.IsNegative());
+        REQUIRE(remainder.Compare(b) < 0);
+    }
+}
+
+TEST_CASE("BigLiteralsAreTokenized") {
+    Tokenizer tokenizer{std::string_view("123456789012345678901234567890 -9223372036854775808")};
+    REQUIRE(tokenizer.GetToken() == Token{ConstantToken::Big("123456789012345678901234567890")});
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{ConstantToken{INT64_MIN}});
+}
+
+TEST_CASE("ExactIntegerArithmetic") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        SchemeTest test(engine);
+        test.ExpectEq("123456789012345678901234567890", "123456789012345678901234567890");
+        test.ExpectEq("+123456789012345678901234567890", "123456789012345678901234567890");
+        test.ExpectEq("(number? 123456789012345678901234567890)", "#t");
+
+        // переполнение int64_t переходит в BigInteger и обратно
+        test.ExpectEq("(+ 9223372036854775807 1)", "9223372036854775808");
+        test.ExpectEq("(- -9223372036854775808 1)", "-9223372036854775809");
+        test.ExpectEq("(* 4294967296 4294967296)", "18446744073709551616");
+        test.ExpectEq("(* 4294967296 4294967296 4294967296 4294967296)",
+                      "340282366920938463463374607431768211456");
+        test.ExpectEq("(+ 1 2 9223372036854775807 -10)", "9223372036854775800");
+        test.ExpectEq("(- (+ 9223372036854775807 1) 1)", "9223372036854775807");
+        test.ExpectEq("(/ -9223372036854775808 -1)", "9223372036854775808");
+        test.ExpectEq("(/ 340282366920938463463374607431768211456 18446744073709551616 2)",
+                      "9223372036854775808");
+        test.ExpectEq("(abs -9223372036854775808)", "9223372036854775808");
+        test.ExpectEq("(abs -340282366920938463463374607431768211456)",
+                      "340282366920938463463374607431768211456");
+        test.ExpectRuntimeError("(/ 1 0)");
+        test.ExpectRuntimeError("(/ 18446744073709551616 0)");
+
+        test.ExpectEq("(< 9223372036854775807 9223372036854775808)", "#t");
+        test.ExpectEq("(< -9223372036854775809 -9223372036854775808 0)", "#t");
+        test.ExpectEq("(= 18446744073709551616 (* 4294967296 4294967296))", "#t");
+        test.ExpectEq("(eq? 18446744073709551616 (* 4294967296 4294967296))", "#t");
+        test.ExpectEq("(max 1 18446744073709551616 -18446744073709551616)",
+                      "18446744073709551616");
+        test.ExpectEq("(min 1 18446744073709551616 -18446744073709551616)",
+                      "-18446744073709551616");
+        test.ExpectEq("(list-tail '(1 2) 0)", "(1 2)");
+        test.ExpectRuntimeError("(list-tail '(1 2) 18446744073709551616)");
+        test.ExpectRuntimeError("(list-tail '(1 2) -18446744073709551616)");
+
+        test.ExpectNoError("(define (fact n) (if (< n 2) 1 (* n (fact (- n 1)))))");
+        test.ExpectEq("(fact 30)", "265252859812191058636308480000000");
+        test.ExpectEq("(fact 100)",
+                      "9332621544394415268169923885626670049071596826438162146859296389521759999"
+                      "3229915608941463976156518286253697920827223758251185210916864000000000000"
+                      "000000000000");
+        test.ExpectNoError(
+            "(define (fib n) (define (loop i a b) (if (= i n) a (loop (+ i 1) b (+ a b))))"
+            " (loop 0 0 1))");
+        test.ExpectEq("(fib 100)", "354224848179261915075");
+        test.ExpectEq("(fib 90)", "2880067194370816120");
+    }
+}
@@ -0,0 +1,51 @@
+#include "scheme_test.h"
+
+class BytecodeTest : public SchemeTest {
+public:
+    BytecodeTest() : SchemeTest(Engine::BYTECODE) {
+    }
+};
+
+TEST_CASE_METHOD(BytecodeTest, "BytecodeBasics") {
+    ExpectEq("(+ 1 (* 2 3) 4)", "11");
+    ExpectEq("(< 1 2)", "#t");
+    ExpectEq("'(1 2 . 3)", "(1 2 . 3)");
+    ExpectEq("(if #f 0)", "()");
+    ExpectEq("(and 1 2 'c '(f g))", "(f g)");
+    ExpectEq("(or #f 1)", "1");
+    ExpectRuntimeError("(())");
+    ExpectRuntimeError("(1 2)");
+    ExpectRuntimeError("(+ 1 #t)");
+    ExpectNameError("x");
+    ExpectNameError("(set! x 1)");
+    ExpectSyntaxError("(if)");
+    ExpectSyntaxError("(lambda (x))");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "BytecodeClosures") {
+    ExpectNoError("(define (range x) (lambda () (set! x (+ x 1)) x))");
+    ExpectNoError("(define my-range (range 10))");
+    ExpectEq("(my-range)", "11");
+    ExpectEq("(my-range)", "12");
+
+    ExpectNoError("(define (foo x) (define (bar) (set! x (+ (* x 2) 2)) x) bar)");
+    ExpectNoError("(define my-foo (foo 20))");
+    ExpectEq("(my-foo)", "42");
+    ExpectRuntimeError("(my-foo 1)");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "BytecodeRecursion") {
+    ExpectNoError("(define (fib x) (if (< x 3) 1 (+ (fib (- x 1)) (fib (- x 2)))))");
+    ExpectEq("(fib 20)", "6765");
+
+    // хвостовой вызов не растит ни стек VM, ни стек C++
+    ExpectNoError("(define (slow-add x y) (if (= x 0) y (slow-add (- x 1) (+ y 1))))");
+    ExpectEq("(slow-add 100000 100000)", "200000");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "BytecodeInlineArithmeticRespectsRedefinition") {
+    ExpectNoError("(define (add x y) (+ x y))");
+    ExpectEq("(add 1 2)", "3");
+    ExpectNoError("(define + -)");
+    ExpectEq("(add 1 2)", "-1");
+}
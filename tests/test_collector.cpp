@@ -0,0 +1,33 @@
+#include "scheme_test.h"
+
+TEST_CASE("SelfReferencingClosuresAreCollected") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define (make) (define (self) self) self)");
+        interpreter.Run("(define kept (make))");
+        interpreter.Run("(define (churn n) (if (= n 0) 0 (begin (make) (churn (- n 1)))))");
+        interpreter.Run("(churn 2000)");
+        REQUIRE(interpreter.CollectGarbage() == 1);
+        REQUIRE(interpreter.Run("(eq? (kept) kept)") == "#t");
+    }
+}
+
+TEST_CASE("CollectionKeepsRunningClosures") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run(R"EOF(
+            (define (make-counter)
+                (define n 0)
+                (define (next) (set! n (+ n 1)) n)
+                next)
+        )EOF");
+        interpreter.Run(R"EOF(
+            (define (run k counter)
+                (if (= k 0)
+                    (counter)
+                    (begin (make-counter) (counter) (run (- k 1) counter))))
+        )EOF");
+        // по ходу дела сборщик срабатывает несколько раз, а counter живёт только в кадрах run
+        REQUIRE(interpreter.Run("(run 3000 (make-counter))") == "3001");
+    }
+}
@@ -21,3 +21,28 @@ TEST_CASE_METHOD(SchemeTest, "IfSyntax") {
     ExpectSyntaxError("(if)");
     ExpectSyntaxError("(if 1 2 3 4)");
 }
+
+TEST_CASE_METHOD(SchemeTest, "CondReturnValue") {
+    ExpectEq("(cond)", "()");
+    ExpectEq("(cond (#f 1))", "()");
+    ExpectEq("(cond (#f 1) (#t 2) (#t 3))", "2");
+    ExpectEq("(cond ((= 1 2) 1) (else 2 3))", "3");
+    ExpectEq("(cond (#f 1) (5))", "5");
+    ExpectEq("(cond ((+ 1 2) 1 2))", "2");
+}
+
+TEST_CASE_METHOD(SchemeTest, "CondEvaluation") {
+    ExpectNoError("(define x 1)");
+
+    ExpectNoError("(cond ((begin (set! x (+ x 1)) #f) (set! x 10)) (else (set! x (+ x 1))))");
+    ExpectEq("x", "3");
+
+    ExpectNoError("(cond (#t (set! x 5)) (else (set! x 6)))");
+    ExpectEq("x", "5");
+}
+
+TEST_CASE_METHOD(SchemeTest, "CondSyntax") {
+    ExpectSyntaxError("(cond ())");
+    ExpectSyntaxError("(cond (else 1) (#t 2))");
+    ExpectSyntaxError("(cond (else))");
+}
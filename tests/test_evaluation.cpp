@@ -0,0 +1,86 @@
+#include <string>
+#include <vector>
+
+#include "scheme_test.h"
+
+TEST_CASE("EvaluationRunsInSlices") {
+    Interpreter interpreter(Engine::BYTECODE);
+    interpreter.Run("(define (count n acc) (if (= n 0) acc (count (- n 1) (+ acc 1))))");
+    interpreter.Run("(define (sum n) (if (= n 0) 0 (+ n (sum (- n 1)))))");
+
+    auto evaluation = interpreter.Start("(count 100000 0)");
+    int slices = 1;
+    while (!evaluation.Resume(1000)) {
+        REQUIRE_FALSE(evaluation.IsDone());
+        ++slices;
+    }
+    REQUIRE(evaluation.GetResult() == "100000");
+    // на каждый шаг count - вызов count и три вызова builtin-ов
+    REQUIRE(slices >= 100);
+
+    // не хвостовая рекурсия останавливается посреди глубокого стека вызовов
+    auto deep = interpreter.Start("(sum 5000)");
+    while (!deep.Resume(7)) {
+    }
+    REQUIRE(deep.GetResult() == interpreter.Run("(sum 5000)"));
+
+    auto instant = interpreter.Start("'(1 2)");
+    REQUIRE(instant.Resume(0));
+    REQUIRE(instant.GetResult() == "(1 2)");
+    REQUIRE_THROWS_AS(instant.Resume(1), RuntimeError);
+}
+
+TEST_CASE("EvaluationsInterleave") {
+    Interpreter interpreter(Engine::BYTECODE);
+    interpreter.Run("(define (count n acc) (if (= n 0) acc (count (- n 1) (+ acc 1))))");
+    interpreter.Run("(define total 0)");
+    interpreter.Run("(define (add-up n) (if (= n 0) total (begin (set! total (+ total 1)) "
+                    "(add-up (- n 1)))))");
+
+    std::vector<Evaluation> scripts;
+    for (int i = 1; i <= 20; ++i) {
+        scripts.push_back(interpreter.Start("(count " + std::to_string(i * 100) + " 0)"));
+    }
+    scripts.push_back(interpreter.Start("(add-up 1000)"));
+    for (bool busy = true; busy;) {
+        busy = false;
+        for (auto& script : scripts) {
+            if (!script.IsDone() && !script.Resume(50)) {
+                busy = true;
+            }
+        }
+        // Run между порциями видит то, что скрипты уже успели сделать
+        REQUIRE(std::stoi(interpreter.Run("total")) <= 1000);
+    }
+    for (int i = 1; i <= 20; ++i) {
+        REQUIRE(scripts[i - 1].GetResult() == std::to_string(i * 100));
+    }
+    REQUIRE(scripts.back().GetResult() == "1000");
+}
+
+TEST_CASE("EvaluationErrorsAndCancellation") {
+    Interpreter interpreter(Engine::BYTECODE);
+    interpreter.Run("(define (spin) (spin))");
+    interpreter.Run("(define (fail n) (if (= n 0) (car '()) (fail (- n 1))))");
+
+    auto runaway = interpreter.Start("(spin)");
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE_FALSE(runaway.Resume(1000));
+    }
+    runaway.Cancel();
+    REQUIRE_FALSE(runaway.IsDone());
+    REQUIRE_THROWS_AS(runaway.Resume(1000), RuntimeError);
+    REQUIRE_THROWS_AS(runaway.GetResult(), RuntimeError);
+
+    auto failing = interpreter.Start("(fail 100)");
+    REQUIRE_FALSE(failing.Resume(10));
+    REQUIRE_THROWS_AS(failing.Resume(1000), RuntimeError);
+    REQUIRE_THROWS_AS(failing.Resume(1000), RuntimeError);
+
+    REQUIRE_THROWS_AS(interpreter.Start("(1"), SyntaxError);
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+    interpreter.CollectGarbage();
+
+    Interpreter analyzer(Engine::ANALYZER);
+    REQUIRE_THROWS_AS(analyzer.Start("(+ 1 2)"), RuntimeError);
+}
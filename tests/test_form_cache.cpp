@@ -0,0 +1,91 @@
+#include <string>
+
+#include "scheme_test.h"
+
+TEST_CASE("FormCacheCountsHitsAndMisses") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+        REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+        REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+        REQUIRE(interpreter.Run("(* 2 3)") == "6");
+
+        const auto& stats = interpreter.GetFormCacheStats();
+        REQUIRE(stats.hits == 2);
+        REQUIRE(stats.misses == 2);
+        REQUIRE(stats.evictions == 0);
+    }
+}
+
+TEST_CASE("FormCacheEvictsLeastRecentlyUsed") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.SetFormCacheCapacity(2);
+        interpreter.Run("1");
+        interpreter.Run("2");
+        interpreter.Run("1");
+        interpreter.Run("3");
+
+        const auto& stats = interpreter.GetFormCacheStats();
+        REQUIRE(stats.evictions == 1);
+        interpreter.Run("1");
+        REQUIRE(stats.hits == 2);
+        interpreter.Run("2");
+        REQUIRE(stats.hits == 2);
+        REQUIRE(stats.evictions == 2);
+
+        interpreter.SetFormCacheCapacity(0);
+        REQUIRE(stats.evictions == 4);
+        REQUIRE(interpreter.Run("2") == "2");
+        REQUIRE(interpreter.Run("2") == "2");
+        REQUIRE(stats.hits == 2);
+    }
+}
+
+TEST_CASE("FormCacheSeesRedefinitions") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        REQUIRE_THROWS_AS(interpreter.Run("(f 1)"), NameError);
+        interpreter.Run("(define (f x) (+ x 1))");
+        REQUIRE(interpreter.Run("(f 1)") == "2");
+        interpreter.Run("(define (f x) (* x 10))");
+        REQUIRE(interpreter.Run("(f 1)") == "10");
+        interpreter.Run("(set! f (lambda (x) x))");
+        REQUIRE(interpreter.Run("(f 1)") == "1");
+
+        // встроенная арифметика байткода, закэшированная до переопределения +
+        REQUIRE(interpreter.Run("(+ 2 3)") == "5");
+        interpreter.Run("(define + -)");
+        REQUIRE(interpreter.Run("(+ 2 3)") == "-1");
+
+        interpreter.Run("(define x 1)");
+        interpreter.Run("(set! x (* x 2))");
+        interpreter.Run("(set! x (* x 2))");
+        REQUIRE(interpreter.Run("x") == "4");
+    }
+}
+
+TEST_CASE("FormCacheKeepsQuotedListsFresh") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define l '(1 2))");
+        interpreter.Run("(set-car! l 5)");
+        REQUIRE(interpreter.Run("l") == "(5 2)");
+        interpreter.Run("(define l '(1 2))");
+        REQUIRE(interpreter.Run("l") == "(1 2)");
+    }
+}
+
+TEST_CASE("FormCacheSkipsInvalidForms") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        REQUIRE_THROWS_AS(interpreter.Run("(+ 1"), SyntaxError);
+        REQUIRE_THROWS_AS(interpreter.Run("(+ 1"), SyntaxError);
+        REQUIRE(interpreter.GetFormCacheStats().hits == 0);
+
+        // ошибка исполнения - не повод выбрасывать готовый код
+        REQUIRE_THROWS_AS(interpreter.Run("(car '())"), RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(car '())"), RuntimeError);
+        REQUIRE(interpreter.GetFormCacheStats().hits == 1);
+    }
+}
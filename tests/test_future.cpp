@@ -0,0 +1,126 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "scheme_test.h"
+
+TEST_CASE("FuturesComputeInParallel") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        REQUIRE(interpreter.Run("(touch (future (+ 1 2)))") == "3");
+        REQUIRE(interpreter.Run("(touch 5)") == "5");
+        REQUIRE(interpreter.Run("(future 1)") == "#<future>");
+        REQUIRE(interpreter.Run("(touch (make-future (lambda () 'ok)))") == "ok");
+
+        interpreter.Run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+        interpreter.Run(R"EOF(
+            (define (pfib n)
+              (if (< n 12)
+                  (fib n)
+                  ((lambda (f) (+ (pfib (- n 1)) (touch f))) (future (pfib (- n 2))))))
+        )EOF");
+        REQUIRE(interpreter.Run("(pfib 20)") == "6765");
+
+        // future видит локальные переменные и может быть тронут несколько раз
+        interpreter.Run("(define (delayed x) (future (* x x)))");
+        interpreter.Run("(define f (delayed 12))");
+        REQUIRE(interpreter.Run("(touch f)") == "144");
+        REQUIRE(interpreter.Run("(touch f)") == "144");
+
+        // слияние отсортированных половин, каждая половина - своя future
+        interpreter.Run(R"EOF(
+            (define (merge a b)
+              (cond ((null? a) b)
+                    ((null? b) a)
+                    ((< (car a) (car b)) (cons (car a) (merge (cdr a) b)))
+                    (else (cons (car b) (merge a (cdr b))))))
+        )EOF");
+        interpreter.Run(R"EOF(
+            (define (split l a b)
+              (if (null? l) (cons a b) (split (cdr l) (cons (car l) b) a)))
+        )EOF");
+        interpreter.Run(R"EOF(
+            (define (msort l)
+              (if (or (null? l) (null? (cdr l)))
+                  l
+                  ((lambda (halves)
+                     ((lambda (left right) (merge (touch left) (touch right)))
+                      (future (msort (car halves)))
+                      (future (msort (cdr halves)))))
+                   (split l '() '()))))
+        )EOF");
+        REQUIRE(interpreter.Run("(msort '(5 3 9 1 7 2 8 6 4 0))") == "(0 1 2 3 4 5 6 7 8 9)");
+        interpreter.CollectGarbage();
+    }
+}
+
+TEST_CASE("UntouchedFuturesHandFramesToCollector") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define (make) (define (self) self) self)");
+        size_t baseline = interpreter.CollectGarbage();
+
+        // результат держит кадр с циклом; touch не будет, сборщик узнаёт о кадре сам
+        interpreter.Run("(define f (future (make)))");
+        size_t live = baseline;
+        for (int i = 0; i < 1000 && live == baseline; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            live = interpreter.CollectGarbage();
+        }
+        REQUIRE(live == baseline + 1);
+        interpreter.Run("(define f 0)");
+        REQUIRE(interpreter.CollectGarbage() == baseline);
+    }
+}
+
+TEST_CASE("FuturesReportErrors") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define x 1)");
+        interpreter.Run("(define f (future (car '())))");
+        REQUIRE_THROWS_AS(interpreter.Run("(touch f)"), RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(touch f)"), RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(touch (future (set! x 2)))"), RuntimeError);
+        REQUIRE(interpreter.Run("x") == "1");
+
+        // кадр и пары создателя future только читает: их в это же время видит он сам
+        interpreter.Run("(define (g) (define acc 0) (touch (future (set! acc 1))))");
+        REQUIRE_THROWS_AS(interpreter.Run("(g)"), RuntimeError);
+        interpreter.Run("(define shared (list 0))");
+        REQUIRE_THROWS_AS(interpreter.Run("(touch (future (set-car! shared 1)))"), RuntimeError);
+        REQUIRE(interpreter.Run("shared") == "(0)");
+        REQUIRE(interpreter.Run("(touch (future ((lambda (acc) (set! acc (+ acc 1)) acc) 1)))") ==
+                "2");
+        REQUIRE_THROWS_AS(interpreter.Run("(future)"), SyntaxError);
+        REQUIRE_THROWS_AS(interpreter.Run("(future 1 2)"), SyntaxError);
+        REQUIRE_THROWS_AS(interpreter.Run("(make-future 1)"), RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(touch (make-future car))"), RuntimeError);
+    }
+}
+
+TEST_CASE("FuturesInHeapImage") {
+    constexpr const char* kImagePath = "test_future_image.scmi";
+    constexpr const char* kBrokenImagePath = "test_future_broken.scmi";
+    for (auto saved_with : {Engine::ANALYZER, Engine::BYTECODE}) {
+        for (auto loaded_with : {Engine::ANALYZER, Engine::BYTECODE}) {
+            {
+                Interpreter interpreter(saved_with);
+                interpreter.Run(
+                    "(define (both f g) ((lambda (x) (cons (touch x) (g))) (future (f))))");
+                interpreter.SaveImage(kImagePath);
+            }
+            {
+                // сам future - незавершённое вычисление, в образ его не записать
+                Interpreter interpreter(saved_with);
+                interpreter.Run("(define pending (future 1))");
+                REQUIRE_THROWS_AS(interpreter.SaveImage(kBrokenImagePath), RuntimeError);
+            }
+            Interpreter interpreter(loaded_with);
+            interpreter.LoadImage(kImagePath);
+            REQUIRE(interpreter.Run("(both (lambda () 1) (lambda () 2))") == "(1 . 2)");
+        }
+    }
+    std::remove(kImagePath);
+    std::remove(kBrokenImagePath);
+}
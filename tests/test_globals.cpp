@@ -0,0 +1,95 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "hamt.h"
+#include "scheme_test.h"
+
+TEST_CASE("PersistentMapKeepsOldVersions") {
+    PersistentMap<int> empty;
+    std::vector<PersistentMap<int>> versions = {empty};
+    // ключи как у адресов binding-ов: выровненные и близкие друг к другу
+    auto key = [](int i) { return uint64_t{0x7f0000001000} + 16 * uint64_t(i); };
+    for (int i = 0; i < 5000; ++i) {
+        versions.push_back(versions.back().Set(key(i), i));
+    }
+    REQUIRE(versions.back().GetSize() == 5000);
+    for (int i = 0; i < 5000; ++i) {
+        REQUIRE(*versions.back().Find(key(i)) == i);
+        REQUIRE(versions[i].Find(key(i)) == nullptr);
+        REQUIRE(*versions[i + 1].Find(key(i)) == i);
+    }
+    REQUIRE(versions.back().Find(key(5000)) == nullptr);
+    REQUIRE(versions.back().Find(key(1) + 8) == nullptr);
+
+    auto updated = versions.back().Set(key(7), -7);
+    REQUIRE(updated.GetSize() == 5000);
+    REQUIRE(*updated.Find(key(7)) == -7);
+    REQUIRE(*versions.back().Find(key(7)) == 7);
+    REQUIRE(empty.GetSize() == 0);
+    REQUIRE(empty.Find(key(0)) == nullptr);
+
+    // правка меняет на месте только свои узлы: копии, отданные до новой правки, целы
+    PersistentMap<int> edited;
+    std::vector<PersistentMap<int>> copies;
+    for (int i = 0; i < 2000; ++i) {
+        edited.SetInPlace(key(i % 500), i, 1 + i / 100);
+        if (i % 100 == 99) {
+            copies.push_back(edited);
+        }
+    }
+    REQUIRE(edited.GetSize() == 500);
+    for (int i = 0; i < 500; ++i) {
+        REQUIRE(*edited.Find(key(i)) == 1500 + i);
+        REQUIRE(*copies[0].Find(key(i % 100)) == i % 100);
+        REQUIRE((copies[0].Find(key(i)) == nullptr) == (i >= 100));
+        REQUIRE(*copies[9].Find(key(i)) == 500 + i);
+    }
+}
+
+TEST_CASE("ParallelTasksReadGlobalSnapshot") {
+    constexpr const char* kImagePath = "test_globals_image.scmi";
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        {
+            Interpreter interpreter(engine);
+            interpreter.Run("(define x 100)");
+            interpreter.SaveImage(kImagePath);
+        }
+        Interpreter interpreter(engine);
+        interpreter.Run("(define x 1)");
+        interpreter.Run("(define (sum-x n acc) (if (= n 0) acc (sum-x (- n 1) (+ acc x))))");
+
+        // future видит x таким, каким он был при запуске, что бы владелец ни делал потом
+        interpreter.Run("(define f (future (sum-x 10000 0)))");
+        for (int i = 2; i < 50; ++i) {
+            interpreter.Run("(set! x " + std::to_string(i) + ")");
+        }
+        interpreter.Run("(define (sum-x n acc) 0)");
+        REQUIRE(interpreter.Run("(touch f)") == "10000");
+
+        // и имена, определённые позже, ему не видны
+        interpreter.Run("(define g (future (later)))");
+        interpreter.Run("(define (later) 1)");
+        REQUIRE_THROWS_AS(interpreter.Run("(touch g)"), NameError);
+        REQUIRE(interpreter.Run("(touch (future (later)))") == "1");
+
+        // перезагрузка образа не задевает вычисление, которое уже идёт
+        interpreter.Run("(define (sum-x n acc) (if (= n 0) acc (sum-x (- n 1) (+ acc x))))");
+        interpreter.Run("(set! x 1)");
+        interpreter.Run("(define h (future (sum-x 1000 0)))");
+        interpreter.LoadImage(kImagePath);
+        REQUIRE(interpreter.Run("(touch h)") == "1000");
+        REQUIRE(interpreter.Run("(touch (future (sum-x 10 0)))") == "1000");
+
+        // inline-арифметика байткода тоже смотрит в снимок
+        interpreter.Run("(define (add-up a b) (+ a b))");
+        interpreter.Run("(define k (future (add-up 2 3)))");
+        interpreter.Run("(define (+ a b) 'redefined)");
+        REQUIRE(interpreter.Run("(touch k)") == "5");
+        REQUIRE(interpreter.Run("(add-up 2 3)") == "redefined");
+        REQUIRE(interpreter.Run("(par-map (lambda (a) (add-up a 1)) '(1 2))") ==
+                "(redefined redefined)");
+    }
+    std::remove(kImagePath);
+}
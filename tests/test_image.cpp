@@ -0,0 +1,198 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "scheme_test.h"
+
+namespace {
+
+constexpr const char* kImagePath = "test_image.scmi";
+
+const std::vector<std::string> kLibrary = {
+    "(define (fact n) (if (< n 2) 1 (* n (fact (- n 1)))))",
+    "(define (make-counter) (define count 0) (lambda () (set! count (+ count 1)) count))",
+    "(define counter (make-counter))",
+    "(counter)",
+    "(define (even? n) (if (= n 0) #t (odd? (- n 1))))",
+    "(define (odd? n) (if (= n 0) #f (even? (- n 1))))",
+    "(define (adder x) (lambda (y) (+ x y)))",
+    "(define add5 (adder 5))",
+    "(define data '(1 (2 . 3) #t sym))",
+    "(define ring '(a b c))",
+    "(set-cdr! (cdr (cdr ring)) ring)",
+    "(define plus +)",
+    "(define big (* 4294967296 4294967296 -4294967296))",
+};
+
+}  // namespace
+
+TEST_CASE("HeapImageRestoresGlobals") {
+    for (auto saved_with : {Engine::ANALYZER, Engine::BYTECODE}) {
+        for (auto loaded_with : {Engine::ANALYZER, Engine::BYTECODE}) {
+            {
+                Interpreter interpreter(saved_with);
+                for (const auto& form : kLibrary) {
+                    interpreter.Run(form);
+                }
+                interpreter.SaveImage(kImagePath);
+            }
+            Interpreter interpreter(loaded_with);
+            interpreter.LoadImage(kImagePath);
+            REQUIRE(interpreter.Run("(fact 10)") == "3628800");
+            REQUIRE(interpreter.Run("(counter)") == "2");
+            REQUIRE(interpreter.Run("(counter)") == "3");
+            REQUIRE(interpreter.Run("((make-counter))") == "1");
+            REQUIRE(interpreter.Run("(odd? 1001)") == "#t");
+            REQUIRE(interpreter.Run("(add5 10)") == "15");
+            REQUIRE(interpreter.Run("data") == "(1 (2 . 3) #t sym)");
+            REQUIRE(interpreter.Run("(car (cdr (cdr (cdr ring))))") == "a");
+            REQUIRE(interpreter.Run("(plus 1 2)") == "3");
+            REQUIRE(interpreter.Run("big") == "-79228162514264337593543950336");
+            // глобальные имена из образа остаются обычными binding-ами
+            interpreter.Run("(define (fact n) 0)");
+            REQUIRE(interpreter.Run("(fact 10)") == "0");
+            interpreter.CollectGarbage();
+            REQUIRE(interpreter.Run("(counter)") == "4");
+        }
+    }
+    std::remove(kImagePath);
+}
+
+TEST_CASE("HeapImageKeepsSharing") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        {
+            Interpreter interpreter(engine);
+            interpreter.Run("(define (make-cell) (define value 0) (define (get) value)"
+                            " (define (put x) (set! value x)) (cons get put))");
+            interpreter.Run("(define cell (make-cell))");
+            interpreter.Run("(define shared '(1 2))");
+            interpreter.Run("(define twice (cons shared shared))");
+            interpreter.SaveImage(kImagePath);
+        }
+        Interpreter interpreter(engine);
+        interpreter.LoadImage(kImagePath);
+        // get и put по-прежнему видят один и тот же кадр
+        interpreter.Run("((cdr cell) 42)");
+        REQUIRE(interpreter.Run("((car cell))") == "42");
+        interpreter.Run("(set-car! (car twice) 7)");
+        REQUIRE(interpreter.Run("(cdr twice)") == "(7 2)");
+        REQUIRE(interpreter.Run("shared") == "(7 2)");
+    }
+    std::remove(kImagePath);
+}
+
+TEST_CASE("CorruptedHeapImagesAreRejected") {
+    std::string image;
+    {
+        Interpreter interpreter;
+        for (const auto& form : kLibrary) {
+            interpreter.Run(form);
+        }
+        interpreter.SaveImage(kImagePath);
+        std::ifstream file(kImagePath, std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    auto write = [](const std::string& data) {
+        std::ofstream file(kImagePath, std::ios::binary);
+        file << data;
+    };
+    for (size_t length : {size_t{0}, size_t{3}, size_t{10}, image.size() / 2, image.size() - 1}) {
+        write(image.substr(0, length));
+        Interpreter interpreter;
+        REQUIRE_THROWS_AS(interpreter.LoadImage(kImagePath), SyntaxError);
+        // битый образ не определяет ничего
+        REQUIRE_THROWS_AS(interpreter.Run("(fact 3)"), NameError);
+    }
+    write(image + "x");
+    Interpreter interpreter;
+    REQUIRE_THROWS_AS(interpreter.LoadImage(kImagePath), SyntaxError);
+    std::remove(kImagePath);
+    REQUIRE_THROWS_AS(interpreter.LoadImage(kImagePath), RuntimeError);
+}
+
+TEST_CASE("HeapImageWithBadOperandsIsRejected") {
+    std::string image;
+    {
+        Interpreter interpreter(Engine::BYTECODE);
+        interpreter.Run("(define (id x) x)");
+        interpreter.Run("(define (keep x) (lambda () x))");
+        interpreter.SaveImage(kImagePath);
+        std::ifstream file(kImagePath, std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    // тела прототипов: число параметров, слотов и инструкций, потом opcode, a и b каждой;
+    // id - LOAD_LOCAL 0 0 и RETURN, lambda из keep - LOAD_LOCAL 1 0 и RETURN
+    const std::string id_body("\x01\x01\x02\x01\x00\x00\x0f\x00\x00", 9);
+    const std::string lambda_body("\x00\x00\x02\x01\x01\x00\x0f\x00\x00", 9);
+    size_t id_at = image.find(id_body);
+    size_t lambda_at = image.find(lambda_body);
+    REQUIRE(id_at != std::string::npos);
+    REQUIRE(lambda_at != std::string::npos);
+
+    // смещение байта в образе и что туда записать
+    std::vector<std::pair<size_t, char>> patches = {
+        {id_at, 2},           // параметров больше, чем слотов
+        {id_at + 3, 0},       // CONST 0 без констант
+        {id_at + 3, 13},      // CALL 0 на пустом стеке
+        {id_at + 4, 1},       // кадр на глубине 1, а id его не держит
+        {id_at + 5, 1},       // слот 1 в кадре из одного слота
+        {id_at + 6, 7},       // POP вместо RETURN: исполнение сходит с конца кода
+        {lambda_at + 5, 1},   // слот 1 в кадре keep, где слот один
+    };
+    for (const auto& [offset, byte] : patches) {
+        auto patched = image;
+        patched[offset] = byte;
+        {
+            std::ofstream file(kImagePath, std::ios::binary);
+            file << patched;
+        }
+        Interpreter interpreter(Engine::BYTECODE);
+        REQUIRE_THROWS_AS(interpreter.LoadImage(kImagePath), SyntaxError);
+        REQUIRE_THROWS_AS(interpreter.Run("(id 1)"), NameError);
+    }
+
+    {
+        std::ofstream file(kImagePath, std::ios::binary);
+        file << image;
+    }
+    Interpreter interpreter(Engine::BYTECODE);
+    interpreter.LoadImage(kImagePath);
+    REQUIRE(interpreter.Run("(id 7)") == "7");
+    REQUIRE(interpreter.Run("((keep 8))") == "8");
+    std::remove(kImagePath);
+}
+
+TEST_CASE("HeapImageCutAnywhereIsRejected") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        std::string image;
+        {
+            Interpreter interpreter(engine);
+            interpreter.Run("(define (make-counter) (define n 0) (lambda () (set! n (+ n 1)) n))");
+            interpreter.Run("(define counter (make-counter))");
+            interpreter.SaveImage(kImagePath);
+            std::ifstream file(kImagePath, std::ios::binary);
+            image.assign(std::istreambuf_iterator<char>(file), {});
+        }
+        auto load = [&](const std::string& data) {
+            {
+                std::ofstream file(kImagePath, std::ios::binary);
+                file << data;
+            }
+            Interpreter interpreter(engine);
+            try {
+                interpreter.LoadImage(kImagePath);
+            } catch (const SyntaxError&) {
+                return false;
+            }
+            return true;
+        };
+        // обрыв где угодно, в том числе посреди таблицы размеров кадров, - SyntaxError
+        for (size_t length = 0; length < image.size(); ++length) {
+            REQUIRE_FALSE(load(image.substr(0, length)));
+        }
+        REQUIRE(load(image));
+    }
+    std::remove(kImagePath);
+}
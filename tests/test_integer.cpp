@@ -83,6 +83,16 @@ TEST_CASE_METHOD(SchemeTest, "IntegerArithmeticsEdgeCases") {
     ExpectRuntimeError("(-)");
 }
 
+TEST_CASE_METHOD(SchemeTest, "IntegersAroundSharedRange") {
+    ExpectEq("(- -128 1)", "-129");
+    ExpectEq("(+ -129 1)", "-128");
+    ExpectEq("(+ 1023 1)", "1024");
+    ExpectEq("(- 1024 1)", "1023");
+    ExpectEq("(* 1000000 1000000)", "1000000000000");
+    ExpectEq("(eq? (+ 2 2) 4)", "#t");
+    ExpectEq("(eq? (< 1 2) #t)", "#t");
+}
+
 TEST_CASE_METHOD(SchemeTest, "IntegerMaxMin") {
     ExpectEq("(max 0)", "0");
     ExpectEq("(min 0)", "0");
@@ -112,3 +122,26 @@ TEST_CASE_METHOD(SchemeTest, "IntegerAbsEdgeCases") {
     ExpectRuntimeError("(abs #t)");
     ExpectRuntimeError("(abs 1 2)");
 }
+
+TEST_CASE_METHOD(SchemeTest, "IntegerNestedVariadicCalls") {
+    ExpectEq("(+ 1 2 (+ 3 4 (max 5 6 7)) (* 1 2 3))", "23");
+    ExpectEq("(- 10 (+) (min 1 2 3) (abs -4))", "5");
+    ExpectRuntimeError("(+ 1 2 (max) 3)");
+    // после ошибки аргументы не остаются на стеке
+    ExpectEq("(+ 1 2 3)", "6");
+}
+
+TEST_CASE("FixedArityEntryPointsMatchApply") {
+    std::vector<std::shared_ptr<Object>> pair = {Number::Make(-3), Number::Make(4)};
+    for (const auto& name : {"+", "-", "*", "=", "<", ">", "<=", ">=", "max", "cons", "eq?"}) {
+        auto function = name_to_function.at(name);
+        REQUIRE(function->Apply2(pair[0], pair[1])->ToString() ==
+                function->Apply(pair)->ToString());
+    }
+    for (const auto& name : {"-", "abs", "number?", "not", "null?", "list"}) {
+        auto function = name_to_function.at(name);
+        REQUIRE(function->Apply1(pair[0])->ToString() ==
+                function->Apply(Arguments(pair).first(1))->ToString());
+    }
+    REQUIRE_THROWS_AS(name_to_function.at("<")->Apply2(pair[0], Bool::Make(true)), RuntimeError);
+}
@@ -135,3 +135,19 @@ TEST_CASE_METHOD(SchemeTest, "Redefinition and scoping") {
     ExpectEq("((foobar) 1 2)", "3");
     ExpectEq("(+ 1 2 -3)", "0");
 }
+
+TEST_CASE_METHOD(SchemeTest, "NestedFramesAndShadowing") {
+    ExpectNoError(R"EOF(
+        (define (outer a b)
+            (define c (* a 10))
+            (lambda (b)
+                (lambda (d)
+                    (set! a (+ a 1))
+                    (list a b c d))))
+    )EOF");
+    ExpectNoError("(define f ((outer 1 2) 3))");
+    ExpectEq("(f 4)", "(2 3 10 4)");
+    ExpectEq("(f 5)", "(3 3 10 5)");
+    ExpectEq("((lambda (x) ((lambda (x) x) (+ x 1))) 1)", "2");
+    ExpectNameError("((lambda () (define y y) y))");
+}
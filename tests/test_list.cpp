@@ -78,3 +78,11 @@ TEST_CASE_METHOD(SchemeTest, "ListOperations") {
     ExpectRuntimeError("(list-ref '(1 2 3) 10)");
     ExpectRuntimeError("(list-tail '(1 2 3) 10)");
 }
+
+TEST_CASE_METHOD(SchemeTest, "ListTailSharesStructure") {
+    ExpectNoError("(define l '(1 2 3))");
+    ExpectNoError("(set-car! (list-tail l 1) 5)");
+    ExpectEq("l", "(1 5 3)");
+    ExpectEq("(car (cdr (list 1 (list 2 3))))", "(2 3)");
+    ExpectEq("'(quote x)", "(quote x)");
+}
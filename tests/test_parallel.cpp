@@ -0,0 +1,140 @@
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "scheduler.h"
+#include "scheme_test.h"
+
+TEST_CASE("TaskGroupRunsNestedTasks") {
+    WorkStealingPool pool(3);
+    std::atomic<int> sum = 0;
+    std::atomic<bool> inside_task = true;
+    {
+        TaskGroup group(&pool);
+        for (int i = 0; i < 16; ++i) {
+            group.Run([&pool, &sum, &inside_task, i] {
+                // вложенная группа ждёт, выполняя задачи пула, и не вешает воркер
+                TaskGroup inner(&pool);
+                for (int j = 0; j < 16; ++j) {
+                    inner.Run([&sum, i, j] { sum.fetch_add(i * 16 + j); });
+                }
+                inner.Wait();
+                if (!WorkStealingPool::IsInsideTask()) {
+                    inside_task = false;
+                }
+            });
+        }
+        group.Wait();
+    }
+    REQUIRE(sum.load() == 255 * 256 / 2);
+    REQUIRE(inside_task.load());
+    REQUIRE_FALSE(WorkStealingPool::IsInsideTask());
+
+    TaskGroup failing(&pool);
+    for (int i = 0; i < 8; ++i) {
+        failing.Run([i] {
+            if (i == 3) {
+                throw std::runtime_error("task failed");
+            }
+        });
+    }
+    REQUIRE_THROWS_WITH(failing.Wait(), "task failed");
+    failing.Run([] {});
+    failing.Wait();
+}
+
+TEST_CASE("ParallelListPrimitives") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define (range a b) (if (>= a b) '() (cons a (range (+ a 1) b))))");
+        interpreter.Run("(define numbers (range 0 2000))");
+        interpreter.Run("(define (square x) (* x x))");
+
+        REQUIRE(interpreter.Run("(par-map square '(1 2 3))") == "(1 4 9)");
+        REQUIRE(interpreter.Run("(par-map square '())") == "()");
+        REQUIRE(interpreter.Run("(list-ref (par-map square numbers) 1999)") == "3996001");
+        REQUIRE(interpreter.Run("(par-reduce + 0 (par-map square numbers))") == "2664667000");
+        REQUIRE(interpreter.Run("(par-reduce + 7 '())") == "7");
+        REQUIRE(interpreter.Run("(par-reduce max 0 numbers)") == "1999");
+        // порядок кусков сохраняется, хотя считаются они где попало
+        REQUIRE(interpreter.Run("(par-reduce (lambda (a b) (if (< a b) b -1)) -2 numbers)") ==
+                "1999");
+        REQUIRE(interpreter.Run("(par-for-each car '((1) (2)))") == "()");
+
+        // кадры из рабочих потоков: замыкание, которое держит свой кадр
+        interpreter.Run(R"EOF(
+            (define (make-counter start)
+              (define (next) (set! start (+ start 1)) start)
+              next))EOF");
+        REQUIRE(interpreter.Run("(par-reduce + 0 (par-map (lambda (x) ((make-counter x))) "
+                                "numbers))") == "2001000");
+        interpreter.CollectGarbage();
+    }
+}
+
+TEST_CASE("NestedParallelPrimitivesKeepTheirArguments") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define (range a b) (if (>= a b) '() (cons a (range (+ a 1) b))))");
+        interpreter.Run("(define (deep n a b) (if (= n 0) (+ a b) (deep2 (- n 1) a b 0)))");
+        interpreter.Run("(define (deep2 n a b c) (+ c (deep n a b)))");
+        interpreter.Run("(define rows (par-map (lambda (i) (range 0 (+ i 50))) (range 0 64)))");
+
+        // пока внешний par-map ждёт, в том же потоке считаются другие его куски, и стек
+        // аргументов под внутренним par-reduce успевает перевыделиться
+        REQUIRE(interpreter.Run("(par-reduce + 0 (par-map (lambda (row) "
+                                "(par-reduce (lambda (a b) (deep 40 a b)) 1000 row)) rows))") ==
+                "284864");
+    }
+}
+
+TEST_CASE("ParallelPrimitivesReportErrors") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define x 0)");
+        REQUIRE_THROWS_AS(interpreter.Run("(par-map car '((1) 2 (3)))"), RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(par-map car '(1 . 2))"), RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(par-map 1 '(1 2))"), RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(par-reduce + '(1 2))"), RuntimeError);
+
+        // глобальное окружение задачи только читают
+        REQUIRE_THROWS_AS(interpreter.Run("(par-for-each (lambda (y) (set! x y)) '(1 2))"),
+                          RuntimeError);
+        REQUIRE(interpreter.Run("x") == "0");
+        REQUIRE_THROWS_AS(interpreter.Run("(par-for-each (lambda (y) (set! w y)) '(1 2))"),
+                          NameError);
+        REQUIRE(interpreter.Run("(par-map (lambda (y) (define z (+ x y)) z) '(1 2))") == "(1 2)");
+        REQUIRE(interpreter.Run("(set! x 5)") == "set!");
+    }
+}
+
+TEST_CASE("ParallelTasksChangeOnlyTheirOwnData") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define (range a b) (if (>= a b) '() (cons a (range (+ a 1) b))))");
+        interpreter.Run("(define numbers (range 0 2000))");
+
+        // кадры и пары, созданные вне задачи, в это же время читают её соседи
+        interpreter.Run("(define (f lst) (define acc 0) "
+                        "(par-for-each (lambda (x) (set! acc (list x acc))) lst) 1)");
+        REQUIRE_THROWS_AS(interpreter.Run("(f numbers)"), RuntimeError);
+        interpreter.Run("(define shared (list 0))");
+        REQUIRE_THROWS_AS(interpreter.Run("(par-for-each (lambda (x) (set-car! shared x)) "
+                                          "numbers)"),
+                          RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(par-for-each (lambda (x) (set-cdr! shared x)) "
+                                          "numbers)"),
+                          RuntimeError);
+        REQUIRE(interpreter.Run("shared") == "(0)");
+
+        // своё задача меняет как угодно
+        REQUIRE(interpreter.Run("(par-map (lambda (x) (define acc 0) "
+                                "((lambda () (set! acc (+ acc x)))) acc) '(1 2 3))") ==
+                "(1 2 3)");
+        REQUIRE(interpreter.Run("(par-map (lambda (x) (define p (list 0)) (set-car! p x) "
+                                "(set-cdr! p x) p) '(1 2))") == "((1 . 1) (2 . 2))");
+        REQUIRE(interpreter.Run("(f '())") == "1");
+        interpreter.CollectGarbage();
+    }
+}
@@ -154,3 +154,56 @@ TEST_CASE("Invalid") {
     REQUIRE_THROWS_AS(ReadFull("(1 . )"), SyntaxError);
     REQUIRE_THROWS_AS(ReadFull("(1 . 2 3)"), SyntaxError);
 }
+
+TEST_CASE("Long and deep inputs") {
+    constexpr int kLength = 1000000;
+    constexpr int kDepth = 100000;
+
+    SECTION("Long list") {
+        std::string input = "(";
+        for (int i = 0; i < kLength; ++i) {
+            input += "1 ";
+        }
+        input += ". 2)";
+        auto list = ReadFull(input);
+        int length = 0;
+        while (Is<Cell>(list)) {
+            ++length;
+            list = As<Cell>(list)->GetSecond();
+        }
+        REQUIRE(length == kLength);
+        REQUIRE(As<Number>(list)->GetValue() == 2);
+    }
+
+    SECTION("Deep nesting") {
+        std::string input(kDepth, '(');
+        input += "x";
+        input += std::string(kDepth, ')');
+        auto node = ReadFull(input);
+        int depth = 0;
+        while (Is<Cell>(node) && As<Cell>(node)->GetSecond() == nullptr) {
+            ++depth;
+            node = As<Cell>(node)->GetFirst();
+        }
+        REQUIRE(depth == kDepth);
+        REQUIRE(node == Symbol::Intern("x"));
+    }
+
+    SECTION("Deep quotes") {
+        std::string input(kDepth, '\'');
+        input += "()";
+        auto node = ReadFull(input);
+        auto quote = Symbol::Intern("quote");
+        int depth = 0;
+        while (Is<Cell>(node) && As<Cell>(node)->GetFirst() == quote) {
+            ++depth;
+            node = As<Cell>(As<Cell>(node)->GetSecond())->GetFirst();
+        }
+        REQUIRE(depth == kDepth);
+        REQUIRE(node == nullptr);
+    }
+
+    SECTION("Unfinished deep input") {
+        REQUIRE_THROWS_AS(ReadFull(std::string(kDepth, '(')), SyntaxError);
+    }
+}
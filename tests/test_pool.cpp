@@ -0,0 +1,172 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pool.h"
+#include "queue.h"
+#include "scheme_test.h"
+
+TEST_CASE("MpmcQueueIsBoundedFifo") {
+    MpmcQueue<std::string> queue(4);
+    REQUIRE_FALSE(queue.TryPop().has_value());
+    for (int i = 0; i < 4; ++i) {
+        std::string value = std::to_string(i);
+        REQUIRE(queue.TryPush(value));
+    }
+    std::string extra = "extra";
+    REQUIRE_FALSE(queue.TryPush(extra));
+    REQUIRE(extra == "extra");
+
+    // несколько кругов по кольцу
+    for (int i = 4; i < 20; ++i) {
+        REQUIRE(queue.TryPop() == std::to_string(i - 4));
+        std::string value = std::to_string(i);
+        REQUIRE(queue.TryPush(value));
+    }
+    for (int i = 16; i < 20; ++i) {
+        REQUIRE(queue.TryPop() == std::to_string(i));
+    }
+    REQUIRE_FALSE(queue.TryPop().has_value());
+    REQUIRE_THROWS_AS(MpmcQueue<int>(6), std::invalid_argument);
+}
+
+TEST_CASE("MpmcQueueDeliversEachItemOnce") {
+    constexpr int kProducers = 3;
+    constexpr int kConsumers = 3;
+    constexpr int kItems = 20000;
+    MpmcQueue<int> queue(64);
+    std::vector<std::atomic<int>> delivered(kProducers * kItems);
+    std::atomic<int> consumed = 0;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < kProducers; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < kItems; ++i) {
+                int value = p * kItems + i;
+                while (!queue.TryPush(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < kConsumers; ++c) {
+        threads.emplace_back([&] {
+            while (consumed.load() < kProducers * kItems) {
+                if (auto value = queue.TryPop()) {
+                    delivered[*value].fetch_add(1);
+                    consumed.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& count : delivered) {
+        REQUIRE(count.load() == 1);
+    }
+}
+
+namespace {
+
+/// собирает ответы пула и ждёт, пока их наберётся count
+class Responses {
+public:
+    std::function<void(PoolResponse)> Add(size_t index) {
+        return [this, index](PoolResponse response) {
+            std::lock_guard lock{mutex_};
+            responses_.resize(std::max(responses_.size(), index + 1));
+            responses_[index] = std::move(response);
+            ++count_;
+            changed_.notify_all();
+        };
+    }
+
+    const std::vector<PoolResponse>& Wait(size_t count) {
+        std::unique_lock lock{mutex_};
+        changed_.wait(lock, [&] { return count_ >= count; });
+        return responses_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<PoolResponse> responses_;
+    size_t count_ = 0;
+};
+
+}  // namespace
+
+TEST_CASE("InterpreterPoolAnswersEveryRequest") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        constexpr size_t kRequests = 300;
+        Responses responses;
+        InterpreterPool pool(3, 8, engine, [](Interpreter* interpreter) {
+            interpreter->Run("(define (square x) (* x x))");
+        });
+        REQUIRE(pool.GetWorkerCount() == 3);
+        for (size_t i = 0; i < kRequests; ++i) {
+            auto expression = i % 10 == 9 ? std::string("(car '())")
+                                          : "(square " + std::to_string(i) + ")";
+            pool.Submit(expression, responses.Add(i));
+        }
+
+        const auto& results = responses.Wait(kRequests);
+        for (size_t i = 0; i < kRequests; ++i) {
+            if (i % 10 == 9) {
+                REQUIRE_FALSE(results[i].ok);
+            } else {
+                REQUIRE(results[i].ok);
+                REQUIRE(results[i].output == std::to_string(i * i));
+            }
+            REQUIRE(results[i].run_time.count() >= 0);
+            REQUIRE(results[i].wait_time.count() >= 0);
+        }
+    }
+}
+
+TEST_CASE("InterpreterPoolAppliesBackPressure") {
+    std::mutex mutex;
+    std::condition_variable released;
+    bool release = false;
+    Responses responses;
+
+    InterpreterPool pool(1, 2, Engine::ANALYZER);
+    // первый ответ держит единственный воркер, пока тест не отпустит
+    auto first = responses.Add(0);
+    REQUIRE(pool.TrySubmit("1", [&](PoolResponse response) {
+        std::unique_lock lock{mutex};
+        released.wait(lock, [&] { return release; });
+        first(std::move(response));
+    }));
+    // воркер забрал первый запрос или заберёт его: в очереди максимум ещё два
+    size_t accepted = 1;
+    while (pool.TrySubmit(std::to_string(accepted + 1), responses.Add(accepted))) {
+        ++accepted;
+        REQUIRE(accepted <= 3);
+    }
+    REQUIRE(accepted >= 2);
+
+    {
+        std::lock_guard lock{mutex};
+        release = true;
+    }
+    released.notify_all();
+    pool.Submit("(+ 1 1)", responses.Add(accepted));
+    const auto& results = responses.Wait(accepted + 1);
+    for (size_t i = 0; i < accepted; ++i) {
+        REQUIRE(results[i].output == std::to_string(i + 1));
+    }
+    REQUIRE(results[accepted].output == "2");
+}
+
+TEST_CASE("InterpreterPoolReportsWarmUpFailure") {
+    REQUIRE_THROWS_AS(InterpreterPool(2, 4, Engine::BYTECODE,
+                                      [](Interpreter* interpreter) { interpreter->Run("(+"); }),
+                      SyntaxError);
+}
@@ -0,0 +1,88 @@
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "scheme_test.h"
+
+namespace {
+
+std::vector<std::string> RunAll(Interpreter* interpreter, const std::string& source) {
+    std::stringstream stream{source};
+    std::vector<std::string> results;
+    interpreter->RunStream(&stream, [&](const std::string& result) { results.push_back(result); });
+    return results;
+}
+
+/// Бесконечный по смыслу вход: формы (+ i 1) генерируются по мере чтения и нигде не
+/// хранятся целиком.
+class GeneratedForms : public std::streambuf {
+public:
+    explicit GeneratedForms(int count) : count_(count) {
+    }
+
+protected:
+    int_type underflow() override {
+        if (next_ == count_) {
+            return traits_type::eof();
+        }
+        form_ = "(+ " + std::to_string(next_++) + " 1)\n";
+        setg(form_.data(), form_.data(), form_.data() + form_.size());
+        return traits_type::to_int_type(form_[0]);
+    }
+
+private:
+    int count_;
+    int next_ = 0;
+    std::string form_;
+};
+
+}  // namespace
+
+TEST_CASE("RunStreamEvaluatesFormsInOrder") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        auto results = RunAll(&interpreter, R"EOF(
+            (define x 1)
+            (set! x (+ x 1))
+            x
+            '(a . b) #t
+            (if #f #f)
+        )EOF");
+        REQUIRE(results == std::vector<std::string>{"defined!", "set!", "2", "(a . b)", "#t", "()"});
+        REQUIRE(interpreter.Run("x") == "2");
+        REQUIRE(RunAll(&interpreter, "   ").empty());
+    }
+}
+
+TEST_CASE("RunStreamStopsAtFirstError") {
+    Interpreter interpreter;
+    std::stringstream stream{"(define y 5) (car '()) (set! y 6)"};
+    std::vector<std::string> results;
+    REQUIRE_THROWS_AS(interpreter.RunStream(
+                          &stream, [&](const std::string& result) { results.push_back(result); }),
+                      RuntimeError);
+    REQUIRE(results.size() == 1);
+    REQUIRE(interpreter.Run("y") == "5");
+
+    std::stringstream unfinished{"(+ 1 2) (+ 1"};
+    results.clear();
+    REQUIRE_THROWS_AS(interpreter.RunStream(
+                          &unfinished, [&](const std::string& result) { results.push_back(result); }),
+                      SyntaxError);
+    REQUIRE(results == std::vector<std::string>{"3"});
+}
+
+TEST_CASE("RunStreamReadsGeneratedInput") {
+    GeneratedForms forms(100000);
+    std::istream stream(&forms);
+    Interpreter interpreter;
+    int count = 0;
+    std::string last;
+    interpreter.RunStream(&stream, [&](const std::string& result) {
+        ++count;
+        last = result;
+    });
+    REQUIRE(count == 100000);
+    REQUIRE(last == "100000");
+}
@@ -0,0 +1,107 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "scheme_test.h"
+#include "serialize.h"
+
+namespace {
+
+std::vector<std::string> Print(const std::vector<std::shared_ptr<Object>>& forms) {
+    std::vector<std::string> printed;
+    for (const auto& form : forms) {
+        printed.push_back(form == nullptr ? "()" : form->ToString());
+    }
+    return printed;
+}
+
+constexpr std::string_view kProgram = R"EOF(
+    (define (fact n) (if (< n 2) 1 (* n (fact (- n 1)))))
+    (fact 10)
+    '(1 (2 . 3) () #t #f -5 2147483647 -2147483648 -123456789012345678901234567890 . tail)
+    '''x
+)EOF";
+
+}  // namespace
+
+TEST_CASE("SerializedFormsRoundTrip") {
+    auto binary = CompileSource(kProgram);
+    auto forms = DeserializeForms(binary);
+    REQUIRE(Print(forms) ==
+            std::vector<std::string>{
+                "(define (fact n) (if (< n 2) 1 (* n (fact (- n 1)))))", "(fact 10)",
+                "(quote (1 (2 . 3) () #t #f -5 2147483647 -2147483648 -123456789012345678901234567890 . tail))",
+                "(quote (quote (quote x)))"});
+    REQUIRE(SerializeForms(forms) == binary);
+    REQUIRE(DeserializeForms(SerializeForms({})).empty());
+    REQUIRE(Print(DeserializeForms(SerializeForms({nullptr}))) == std::vector<std::string>{"()"});
+
+    // текст ограничен int, сами числа - нет
+    std::vector<std::shared_ptr<Object>> limits{Number::Make(INT64_MAX), Number::Make(INT64_MIN)};
+    REQUIRE(Print(DeserializeForms(SerializeForms(limits))) == Print(limits));
+}
+
+TEST_CASE("SerializedLongAndDeepForms") {
+    std::string source = "(";
+    for (int i = 0; i < 1000000; ++i) {
+        source += std::to_string(i % 1000) + " ";
+    }
+    source += ")" + std::string(100000, '(') + std::string(100000, ')');
+    auto binary = CompileSource(source);
+    auto forms = DeserializeForms(binary);
+    REQUIRE(forms.size() == 2);
+    REQUIRE(SerializeForms(forms) == binary);
+}
+
+TEST_CASE("CorruptedProgramsAreRejected") {
+    auto binary = CompileSource(kProgram);
+    for (size_t length = 0; length < binary.size(); ++length) {
+        // обрезанный файл может случайно оказаться целым набором форм, но не должен ронять
+        try {
+            DeserializeForms(std::string_view(binary).substr(0, length));
+        } catch (const SyntaxError&) {
+        }
+    }
+    REQUIRE_THROWS_AS(DeserializeForms("SCHEME"), SyntaxError);
+    REQUIRE_THROWS_AS(DeserializeForms(binary.substr(0, binary.size() - 1)), SyntaxError);
+    REQUIRE_THROWS_AS(DeserializeForms(std::string("SCMB\x01\x00\x05", 7)), SyntaxError);
+    REQUIRE_THROWS_AS(DeserializeForms(std::string("SCMB\x01\x00\x04\x00", 8)), SyntaxError);
+    REQUIRE_THROWS_AS(SerializeForms({name_to_function.at("car")}), RuntimeError);
+}
+
+TEST_CASE("RunProgramMatchesRunStream") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter from_text(engine);
+        std::vector<std::string> expected;
+        std::stringstream stream{std::string(kProgram)};
+        from_text.RunStream(&stream, [&](const std::string& result) { expected.push_back(result); });
+
+        Interpreter from_binary(engine);
+        std::vector<std::string> results;
+        from_binary.RunProgram(CompileSource(kProgram),
+                               [&](const std::string& result) { results.push_back(result); });
+        REQUIRE(results == expected);
+        REQUIRE(from_binary.Run("(fact 5)") == "120");
+    }
+}
+
+TEST_CASE("RunProgramFromMappedFile") {
+    std::string path = "test_serialize_program.scmb";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << CompileSource("(define x 40) (+ x 2)");
+    }
+    std::vector<std::string> results;
+    {
+        MappedFile file(path);
+        Interpreter interpreter;
+        interpreter.RunProgram(file.GetData(),
+                               [&](const std::string& result) { results.push_back(result); });
+    }
+    std::remove(path.c_str());
+    REQUIRE(results == std::vector<std::string>{"defined!", "42"});
+    REQUIRE_THROWS_AS(MappedFile("no/such/file.scmb"), RuntimeError);
+}
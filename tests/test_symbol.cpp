@@ -14,6 +14,15 @@ TEST_CASE_METHOD(SchemeTest, "SymbolPredicate") {
     ExpectEq("(symbol? 1)", "#f");
 }
 
+TEST_CASE_METHOD(SchemeTest, "SymbolsAreInterned") {
+    ExpectEq("(eq? 'x 'x)", "#t");
+    ExpectEq("(eq? 'x 'y)", "#f");
+    ExpectEq("(eq? (car '(x y)) (car (cdr '(y x))))", "#t");
+    ExpectEq("(eq? '(1) '(1))", "#f");
+    ExpectEq("(eq? 1 1)", "#t");
+    ExpectRuntimeError("(eq? 'x)");
+}
+
 TEST_CASE_METHOD(SchemeTest, "SymbolsAreUsedAsVariableNames") {
     ExpectNoError("(define x (+ 1 2))");
     ExpectEq("x", "3");
@@ -0,0 +1,63 @@
+#include <string>
+
+#include "scheme_test.h"
+
+namespace {
+
+void DefineLoops(Interpreter* interpreter) {
+    interpreter->Run("(define (count n) (if (= n 0) 'done (count (- n 1))))");
+    interpreter->Run(R"EOF(
+        (define (count-cond n acc)
+            (cond ((= n 0) acc)
+                  ((= n -1) 'unreachable)
+                  (else (begin (count-cond (- n 1) (+ acc 1))))))
+    )EOF");
+    interpreter->Run("(define (count-and n) (and #t (if (= n 0) #t (count-and (- n 1)))))");
+    interpreter->Run("(define (count-or n) (or (= n 0) (count-or (- n 1))))");
+    // хвостовой вызов между двумя функциями
+    interpreter->Run("(define (even? n) (if (= n 0) #t (odd? (- n 1))))");
+    interpreter->Run("(define (odd? n) (if (= n 0) #f (even? (- n 1))))");
+    // вызов внутри lambda, созданной в цикле
+    interpreter->Run("(define (count-lambda n) (if (= n 0) 0 ((lambda (m) (count-lambda m)) (- n 1))))");
+}
+
+void RunLoops(Engine engine, int iterations) {
+    Interpreter interpreter(engine);
+    DefineLoops(&interpreter);
+    auto n = std::to_string(iterations);
+    REQUIRE(interpreter.Run("(count " + n + ")") == "done");
+    REQUIRE(interpreter.Run("(count-cond " + n + " 0)") == n);
+    REQUIRE(interpreter.Run("(count-and " + n + ")") == "#t");
+    REQUIRE(interpreter.Run("(count-or " + n + ")") == "#t");
+    REQUIRE(interpreter.Run("(even? " + n + ")") == (iterations % 2 == 0 ? "#t" : "#f"));
+    REQUIRE(interpreter.Run("(count-lambda " + n + ")") == "0");
+}
+
+}  // namespace
+
+TEST_CASE("TailCallsRunInConstantStack") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        RunLoops(engine, 1000000);
+    }
+}
+
+TEST_CASE("TailCallsKeepNonTailRecursion") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        Interpreter interpreter(engine);
+        interpreter.Run("(define (sum n) (if (= n 0) 0 (+ n (sum (- n 1)))))");
+        REQUIRE(interpreter.Run("(sum 100)") == "5050");
+        interpreter.Run("(define (f x) (g x))");
+        interpreter.Run("(define (g x) (+ x 1))");
+        REQUIRE(interpreter.Run("(f (f 1))") == "3");
+        REQUIRE_THROWS_AS(interpreter.Run("(f 1 2)"), RuntimeError);
+        interpreter.Run("(define (h) (g))");
+        REQUIRE_THROWS_AS(interpreter.Run("(h)"), RuntimeError);
+    }
+}
+
+/// долгий прогон, по умолчанию не запускается: ./test_scheme_advanced "[stress]"
+TEST_CASE("TailCallsTenMillionIterations", "[.][stress]") {
+    for (auto engine : {Engine::ANALYZER, Engine::BYTECODE}) {
+        RunLoops(engine, 10000000);
+    }
+}
@@ -0,0 +1,68 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "scheme_test.h"
+
+TEST_CASE("InterpretersOnSeparateThreadsAreIsolated") {
+    constexpr int kThreads = 4;
+    std::vector<std::string> errors(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t, &errors] {
+            Interpreter interpreter(t % 2 == 0 ? Engine::ANALYZER : Engine::BYTECODE);
+            auto own = std::to_string(t);
+            interpreter.Run("(define x " + own + ")");
+            interpreter.Run("(define (f n acc) (if (= n 0) acc (f (- n 1) (cons x acc))))");
+            // затенённый builtin не должен быть виден другим интерпретаторам
+            interpreter.Run("(define car (lambda (l) " + own + "))");
+            for (int i = 0; i < 200; ++i) {
+                auto name = "'name-" + std::to_string(i % 50) + "-" + std::to_string(i % 3);
+                if (interpreter.Run(name) != name.substr(1) ||
+                    interpreter.Run("(car (f 3 '()))") != own ||
+                    interpreter.Run("(cdr (f 2 '()))") != "(" + own + ")") {
+                    errors[t] = "wrong result on iteration " + std::to_string(i);
+                    return;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        REQUIRE(error.empty());
+    }
+
+    Interpreter interpreter;
+    REQUIRE_THROWS_AS(interpreter.Run("x"), NameError);
+    REQUIRE(interpreter.Run("(car '(1 2))") == "1");
+}
+
+TEST_CASE("SymbolsInternedConcurrentlyAreUnique") {
+    constexpr int kThreads = 4;
+    constexpr int kNames = 5000;
+    std::vector<std::vector<std::shared_ptr<Symbol>>> seen(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t, &seen] {
+            for (int i = 0; i < kNames; ++i) {
+                // потоки проходят одни и те же имена в разном порядке
+                int k = t % 2 == 0 ? i : kNames - 1 - i;
+                seen[t].push_back(Symbol::Intern("concurrent-" + std::to_string(k)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < kThreads; ++t) {
+        for (int i = 0; i < kNames; ++i) {
+            int k = t % 2 == 0 ? i : kNames - 1 - i;
+            const auto& symbol = seen[t][i];
+            REQUIRE(symbol == seen[0][k]);
+            REQUIRE(symbol->GetName() == "concurrent-" + std::to_string(k));
+            REQUIRE(Symbol::FromId(symbol->GetId()) == symbol);
+        }
+    }
+}
@@ -3,7 +3,10 @@
 #include <error.h>
 #include <tokenizer.h>
 
+#include <random>
 #include <sstream>
+#include <string>
+#include <vector>
 
 TEST_CASE("Tokenizer works on simple case") {
     std::stringstream ss{"4+)'."};
@@ -160,3 +163,77 @@ void ShouldThrow() {
 TEST_CASE("Exception is thrown") {
     REQUIRE_THROWS_AS(ShouldThrow(), SyntaxError);
 }
+
+TEST_CASE("Buffer tokenizer matches stream tokenizer") {
+    for (std::string input : {"4+)'.", "-2 - 2 +7 --5 -x", "foo bar zog-zog? a1 #t #f #tt",
+                              "(define (f x) (if (< x 3) 1 '(a . b)))", "12abc 1.5", "  \n\t ",
+                              ""}) {
+        std::stringstream ss{input};
+        Tokenizer from_stream{&ss};
+        Tokenizer from_buffer{std::string_view(input)};
+        while (!from_stream.IsEnd()) {
+            REQUIRE(!from_buffer.IsEnd());
+            REQUIRE(from_stream.GetToken() == from_buffer.GetToken());
+            from_stream.Next();
+            from_buffer.Next();
+        }
+        REQUIRE(from_buffer.IsEnd());
+    }
+}
+
+TEST_CASE("Buffer tokenizer does not read past its view") {
+    std::string input = "(foo 12)bar";
+    Tokenizer tokenizer{std::string_view(input).substr(0, 6)};
+    REQUIRE(tokenizer.GetToken() == Token{BracketToken::OPEN});
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{SymbolToken{"foo"}});
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{ConstantToken{1}});
+    tokenizer.Next();
+    REQUIRE(tokenizer.IsEnd());
+}
+
+TEST_CASE("Invalid input in buffer") {
+    REQUIRE_THROWS_AS(Tokenizer{std::string_view("1@")}.Next(), SyntaxError);
+    REQUIRE_THROWS_AS(Tokenizer{std::string_view("ab@")}, SyntaxError);
+}
+
+TEST_CASE("Buffer tokenizer on long runs and random input") {
+    // длинные пробелы, символы и числа пересекают границы 16-байтовых блоков
+    std::vector<std::string> pieces = {" ", "\t\n  ", std::string(37, ' '), "(", ")", "'", ".",
+                                       "abcdefghijklmnopqrstuvwxyz<=>?!#*+-/0123456789",
+                                       "ABCDEFGHIJKLMNOPQRSTUVWXYZ", "123456789", "-42", "+7",
+                                       "#t", "x", "@", "\x80", "[", "`", "{", ":", "~", ","};
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> piece(0, pieces.size() - 1);
+    std::uniform_int_distribution<size_t> length(1, 40);
+    for (int i = 0; i < 2000; ++i) {
+        std::string input;
+        for (size_t j = length(rng); j > 0; --j) {
+            input += pieces[piece(rng)];
+        }
+        std::stringstream ss{input};
+        std::vector<Token> from_stream;
+        bool stream_failed = false;
+        try {
+            for (Tokenizer tokenizer{&ss}; !tokenizer.IsEnd(); tokenizer.Next()) {
+                from_stream.push_back(tokenizer.GetToken());
+            }
+        } catch (const SyntaxError&) {
+            stream_failed = true;
+        }
+        std::vector<Token> from_buffer;
+        bool buffer_failed = false;
+        try {
+            for (Tokenizer tokenizer{std::string_view(input)}; !tokenizer.IsEnd();
+                 tokenizer.Next()) {
+                from_buffer.push_back(tokenizer.GetToken());
+            }
+        } catch (const SyntaxError&) {
+            buffer_failed = true;
+        }
+        INFO(input);
+        REQUIRE(stream_failed == buffer_failed);
+        REQUIRE(from_stream == from_buffer);
+    }
+}
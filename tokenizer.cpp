@@ -1,92 +1,297 @@
 #include <tokenizer.h>
 
-#include <cctype>
-#include <set>
+#include <array>
+#include <charconv>
 
-Tokenizer::Tokenizer(std::istream *in) : stream_(in), token_(ReadNextToken()){};
+#include "object.h"
 
-bool Tokenizer::IsEnd() {
-    return token_ == Token(EOFToken());
+// SSE2 есть на любом x86-64, так что выбирать во время исполнения нечего; на других
+// платформах буфер просматривается по байту через ту же таблицу классов
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TOKENIZER_SSE2
+#endif
+
+namespace {
+
+enum CharClass : uint8_t {
+    INVALID = 0,
+    SPACE = 1,
+    /// отдельный токен: ( ) ' .
+    SINGLE = 2,
+    DIGIT = 4,
+    /// буквы и <=>*/#+-!?
+    SYMBOL = 8,
+};
+
+constexpr std::array<uint8_t, 256> MakeCharClasses() {
+    std::array<uint8_t, 256> classes{};
+    for (unsigned char chr : std::string_view(" \t\n\v\f\r")) {
+        classes[chr] = SPACE;
+    }
+    for (unsigned char chr : std::string_view("()'.")) {
+        classes[chr] = SINGLE;
+    }
+    for (unsigned char chr = '0'; chr <= '9'; ++chr) {
+        classes[chr] = DIGIT;
+    }
+    for (unsigned char chr = 'a'; chr <= 'z'; ++chr) {
+        classes[chr] = SYMBOL;
+        classes[chr - 'a' + 'A'] = SYMBOL;
+    }
+    for (unsigned char chr : std::string_view("<=>*/#+-!?")) {
+        classes[chr] = SYMBOL;
+    }
+    return classes;
 }
 
-void Tokenizer::Next() {
-    if (IsEnd()) {
-        throw SyntaxError("fall in GetToken");
+constexpr auto kCharClasses = MakeCharClasses();
+
+bool IsClass(int chr, uint8_t char_class) {
+    return chr != EOF && (kCharClasses[static_cast<unsigned char>(chr)] & char_class) != 0;
+}
+
+#ifdef TOKENIZER_SSE2
+/// байты в [low, high]; байты от 0x80 знаковое сравнение считает отрицательными
+__m128i InRange(__m128i chunk, char low, char high) {
+    return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(low - 1)),
+                         _mm_cmplt_epi8(chunk, _mm_set1_epi8(high + 1)));
+}
+
+/// маска байтов из kClass - то же, что kCharClasses, но сразу для 16 байт
+template <uint8_t kClass>
+__m128i ClassMask(__m128i chunk) {
+    if constexpr (kClass == SPACE) {
+        return _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                            InRange(chunk, '\t', '\r'));
+    } else if constexpr (kClass == DIGIT) {
+        return InRange(chunk, '0', '9');
+    } else {
+        static_assert(kClass == (DIGIT | SYMBOL));
+        // буквы, 0-9 и / подряд, <=>? подряд, *+, - ! #
+        __m128i mask = InRange(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), 'a', 'z');
+        mask = _mm_or_si128(mask, InRange(chunk, '/', '9'));
+        mask = _mm_or_si128(mask, InRange(chunk, '<', '?'));
+        mask = _mm_or_si128(mask, InRange(chunk, '*', '+'));
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('-')));
+        mask = _mm_or_si128(mask, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('!')));
+        return _mm_or_si128(mask, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('#')));
     }
-    token_ = ReadNextToken();
 }
+#endif
 
-Token Tokenizer::GetToken() {
-    if (IsEnd()) {
-        throw SyntaxError("fall in GetToken");
+/// первый символ в [begin, end) не из kClass
+template <uint8_t kClass>
+const char* SkipClass(const char* begin, const char* end) {
+#ifdef TOKENIZER_SSE2
+    while (end - begin >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        auto outside = static_cast<uint32_t>(~_mm_movemask_epi8(ClassMask<kClass>(chunk))) & 0xFFFF;
+        if (outside != 0) {
+            return begin + __builtin_ctz(outside);
+        }
+        begin += 16;
     }
-    return token_;
+#endif
+    while (begin != end && (kCharClasses[static_cast<unsigned char>(*begin)] & kClass) != 0) {
+        ++begin;
+    }
+    return begin;
 }
 
-static std::set<char> single_symbols = {'(', ')', '\'', '.'};
-static std::set<char> legal_special_symbols = {'<', '=', '>', '*', '/', '#', '+', '-', '!', '?'};
+/// Символы по одному из потока; текст токена копится в raw_token. Читает прямо из
+/// streambuf: peek/get у istream на каждый символ заводят sentry.
+class StreamReader {
+public:
+    StreamReader(std::istream* stream, std::string* raw_token)
+        : buffer_(stream->rdbuf()), raw_token_(raw_token){};
 
-void CheckSymbolLegality(char chr) {
-    if (legal_special_symbols.contains(chr) || isalpha(chr) || isdigit(chr) ||
-        single_symbols.contains(chr)) {
-        return;
+    int Peek() {
+        return buffer_->sgetc();
+    }
+    void Skip() {
+        buffer_->sbumpc();
+    }
+    void StartToken() {
+        raw_token_->clear();
+    }
+    void Take() {
+        raw_token_->push_back(static_cast<char>(buffer_->sbumpc()));
+    }
+    void SkipSpaces() {
+        while (IsClass(Peek(), SPACE)) {
+            Skip();
+        }
+    }
+    /// char_class - DIGIT или DIGIT | SYMBOL
+    void TakeWhile(uint8_t char_class) {
+        while (IsClass(Peek(), char_class)) {
+            Take();
+        }
+    }
+    std::string_view TokenText() const {
+        return *raw_token_;
     }
-    throw SyntaxError("Invalid symbol");
-}
 
-#define ReturnTokenIf(element, target, result) \
-    if (element == target) {                   \
-        return Token(result);                  \
+protected:
+    std::streambuf* buffer_;
+    std::string* raw_token_;
+};
+
+/// символы из буфера; текст токена - кусок самого буфера
+class BufferReader {
+public:
+    BufferReader(const char** cursor, const char* end) : cursor_(cursor), end_(end){};
+
+    int Peek() const {
+        return *cursor_ == end_ ? EOF : static_cast<unsigned char>(**cursor_);
+    }
+    void Skip() {
+        ++*cursor_;
+    }
+    void StartToken() {
+        token_start_ = *cursor_;
+    }
+    void Take() {
+        ++*cursor_;
+    }
+    void SkipSpaces() {
+        *cursor_ = SkipClass<SPACE>(*cursor_, end_);
+    }
+    void TakeWhile(uint8_t char_class) {
+        if (char_class == DIGIT) {
+            *cursor_ = SkipClass<DIGIT>(*cursor_, end_);
+        } else {
+            *cursor_ = SkipClass<DIGIT | SYMBOL>(*cursor_, end_);
+        }
+    }
+    std::string_view TokenText() const {
+        return std::string_view(token_start_, *cursor_ - token_start_);
     }
 
-Token Tokenizer::ReadNextToken() {
-    while (stream_->peek() != EOF && std::isspace(stream_->peek())) {
-        stream_->get();
+protected:
+    const char** cursor_;
+    const char* end_;
+    const char* token_start_ = nullptr;
+};
+
+Token ParseConstant(std::string_view text) {
+    if (text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    int64_t value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (end != text.data() + text.size()) {
+        throw SyntaxError("Invalid number");
+    }
+    if (error == std::errc::result_out_of_range) {
+        return Token(ConstantToken::Big(text));
     }
-    if (stream_->peek() == EOF) {
+    if (error != std::errc()) {
+        throw SyntaxError("Invalid number");
+    }
+    return Token(ConstantToken(value));
+}
+
+template <class Reader>
+Token ReadToken(Reader reader) {
+    reader.SkipSpaces();
+    int chr = reader.Peek();
+    if (chr == EOF) {
         return Token(EOFToken());
     }
+    if (!IsClass(chr, SINGLE | DIGIT | SYMBOL)) {
+        throw SyntaxError("Invalid symbol");
+    }
+    switch (chr) {
+        case '(':
+            reader.Skip();
+            return Token(BracketToken::OPEN);
+        case ')':
+            reader.Skip();
+            return Token(BracketToken::CLOSE);
+        case '\'':
+            reader.Skip();
+            return Token(QuoteToken());
+        case '.':
+            reader.Skip();
+            return Token(DotToken());
+    }
 
-    std::string raw_token;
-    bool is_digit = false;
+    reader.StartToken();
+    reader.Take();
+    // число - это цифры, возможно после знака; знак без цифр остаётся символом
+    bool is_digit = IsClass(chr, DIGIT);
+    if ((chr == '+' || chr == '-') && IsClass(reader.Peek(), DIGIT)) {
+        reader.Take();
+        is_digit = true;
+    }
+    reader.TakeWhile(is_digit ? DIGIT : DIGIT | SYMBOL);
+    int next = reader.Peek();
+    if (next != EOF && !IsClass(next, SPACE | SINGLE | DIGIT | SYMBOL)) {
+        throw SyntaxError("Invalid symbol");
+    }
 
-    while (stream_->peek() != EOF && !std::isspace(stream_->peek())) {
-        if (!raw_token.empty() && single_symbols.contains(stream_->peek())) {
-            break;
-        }
-        if (is_digit && !isdigit(stream_->peek())) {
-            break;
-        }
+    std::string_view text = reader.TokenText();
+    if (is_digit) {
+        return ParseConstant(text);
+    }
+    if (text == "#t") {
+        return Token(BooleanToken::TRUE);
+    }
+    if (text == "#f") {
+        return Token(BooleanToken::FALSE);
+    }
+    return Token(SymbolToken(text));
+}
 
-        char chr = stream_->get();
-        CheckSymbolLegality(chr);
+}  // namespace
 
-        ReturnTokenIf(chr, '(', BracketToken::OPEN);
-        ReturnTokenIf(chr, ')', BracketToken::CLOSE);
-        ReturnTokenIf(chr, '\'', QuoteToken());
-        ReturnTokenIf(chr, '.', DotToken());
+Tokenizer::Tokenizer(std::istream *in) : stream_(in), token_(ReadNextToken()){};
 
-        // digit check
-        if (isdigit(chr) &&
-            (raw_token.empty() ||
-             (raw_token.size() == 1 && (raw_token.back() == '+' || raw_token.back() == '-')))) {
-            is_digit = true;
-        }
+Tokenizer::Tokenizer(std::string_view source)
+    : cursor_(source.data()), end_(source.data() + source.size()), token_(ReadNextToken()){};
+
+void Tokenizer::Reset(std::string_view source) {
+    stream_ = nullptr;
+    cursor_ = source.data();
+    end_ = source.data() + source.size();
+    token_ = ReadNextToken();
+}
 
-        raw_token.push_back(chr);
+bool Tokenizer::IsEnd() {
+    return std::holds_alternative<EOFToken>(token_);
+}
+
+void Tokenizer::Next() {
+    if (IsEnd()) {
+        throw SyntaxError("fall in GetToken");
     }
-    ReturnTokenIf(raw_token, "#t", BooleanToken::TRUE);
-    ReturnTokenIf(raw_token, "#f", BooleanToken::FALSE);
-    ReturnTokenIf(raw_token, "quote", QuoteToken());  /// TODO добавил
-    if (!is_digit) {
-        return Token(SymbolToken(raw_token));
+    token_ = ReadNextToken();
+}
+
+const Token &Tokenizer::GetToken() {
+    if (IsEnd()) {
+        throw SyntaxError("fall in GetToken");
     }
-    // Only constant token is left
-    return Token(ConstantToken(std::stoi(raw_token)));
+    return token_;
+}
+
+Token Tokenizer::ReadNextToken() {
+    if (stream_ != nullptr) {
+        return ReadToken(StreamReader(stream_, &raw_token_));
+    }
+    return ReadToken(BufferReader(&cursor_, end_));
+}
+
+SymbolToken::SymbolToken(std::string_view name) : id(Symbol::Intern(name)->GetId()){};
+
+const std::string &SymbolToken::GetName() const {
+    return Symbol::FromId(id)->GetName();
 }
 
 bool SymbolToken::operator==(const SymbolToken &other) const {
-    return name == other.name;
+    return id == other.id;
 }
 
 bool QuoteToken::operator==(const QuoteToken &) const {
@@ -97,6 +302,12 @@ bool DotToken::operator==(const DotToken &) const {
     return true;
 }
 
+ConstantToken ConstantToken::Big(std::string_view text) {
+    ConstantToken token(0);
+    token.digits = text;
+    return token;
+}
+
 bool ConstantToken::operator==(const ConstantToken &other) const {
-    return value == other.value;
+    return value == other.value && digits == other.digits;
 }
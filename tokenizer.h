@@ -1,15 +1,21 @@
 #pragma once
 
+#include <cstdint>
 #include <istream>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <variant>
 
 #include "error.h"
 
+/// хранит id интернированного символа, см. Symbol::Intern
 struct SymbolToken {
-    SymbolToken(std::string new_name) : name(new_name){};
+    SymbolToken(std::string_view name);
 
-    std::string name;
+    const std::string& GetName() const;
+
+    uint32_t id;
 
     bool operator==(const SymbolToken& other) const;
 };
@@ -24,10 +30,15 @@ struct DotToken {
 
 enum class BracketToken { OPEN, CLOSE };
 
+/// Целый литерал. Если он не помещается в int64_t, value не используется, а digits хранит
+/// его запись для BigInteger::Parse; у обычных литералов digits пуст.
 struct ConstantToken {
-    ConstantToken(int new_value) : value(new_value){};
+    ConstantToken(int64_t new_value) : value(new_value){};
+
+    static ConstantToken Big(std::string_view text);
 
-    int value;
+    int64_t value;
+    std::string digits;
 
     bool operator==(const ConstantToken& other) const;
 };
@@ -43,20 +54,32 @@ struct EOFToken {
 using Token = std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken,
                            BooleanToken, EOFToken>;
 
+/// Токены читаются либо из потока - лениво, ровно на один токен вперёд, - либо из
+/// непрерывного буфера указателями, без копирования исходника. Буфер должен жить дольше
+/// токенизатора.
 class Tokenizer {
 public:
     Tokenizer(std::istream* in);
+    explicit Tokenizer(std::string_view source);
+
+    /// начинает читать другой буфер тем же токенизатором
+    void Reset(std::string_view source);
 
     bool IsEnd();
 
     void Next();
 
-    Token GetToken();
+    const Token& GetToken();
 
 protected:
     Token ReadNextToken();
 
 protected:
-    std::istream* stream_;
+    std::istream* stream_ = nullptr;
+    /// недочитанная часть буфера, если stream_ нет
+    const char* cursor_ = nullptr;
+    const char* end_ = nullptr;
+    /// текст текущего токена при чтении из потока
+    std::string raw_token_;
     Token token_;
 };
\ No newline at end of file